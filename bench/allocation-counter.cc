@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <cstdlib>
+#include <new>
+
+#include "allocation-counter.h"
+
+static uint64_t g_allocations = 0;     // calls of operator new so far
+static uint64_t g_allocatedBytes = 0;  // bytes asked of operator new so far
+static int64_t g_liveBytes = 0;        // bytes allocated and not freed
+
+// Every block starts with its size, so that freeing it can be accounted.
+// The prefix keeps the alignment of malloc.
+static const std::size_t SIZE_PREFIX = 16;
+
+static void*
+CountedAllocate (std::size_t size)
+{
+  char* block = static_cast<char*> (std::malloc (size + SIZE_PREFIX));
+  if (block == 0)
+  {
+    return 0;
+  }
+  *reinterpret_cast<std::size_t*> (block) = size;
+  g_allocations++;
+  g_allocatedBytes += size;
+  g_liveBytes += size;
+  return block + SIZE_PREFIX;
+}
+
+static void
+CountedFree (void* memory)
+{
+  if (memory == 0)
+  {
+    return;
+  }
+  char* block = static_cast<char*> (memory) - SIZE_PREFIX;
+  g_liveBytes -= *reinterpret_cast<std::size_t*> (block);
+  std::free (block);
+}
+
+uint64_t
+GetAllocations (void)
+{
+  return g_allocations;
+}
+
+uint64_t
+GetAllocatedBytes (void)
+{
+  return g_allocatedBytes;
+}
+
+int64_t
+GetLiveBytes (void)
+{
+  return g_liveBytes;
+}
+
+void*
+operator new (std::size_t size)
+{
+  void* memory = CountedAllocate (size);
+  if (memory == 0)
+  {
+    throw std::bad_alloc ();
+  }
+  return memory;
+}
+
+void*
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void*
+operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+  return CountedAllocate (size);
+}
+
+void*
+operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+  return CountedAllocate (size);
+}
+
+void
+operator delete (void* memory) noexcept
+{
+  CountedFree (memory);
+}
+
+void
+operator delete[] (void* memory) noexcept
+{
+  CountedFree (memory);
+}
+
+void
+operator delete (void* memory, const std::nothrow_t&) noexcept
+{
+  CountedFree (memory);
+}
+
+void
+operator delete[] (void* memory, const std::nothrow_t&) noexcept
+{
+  CountedFree (memory);
+}
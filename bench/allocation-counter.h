@@ -0,0 +1,23 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef BENCH_ALLOCATION_COUNTER_H
+#define BENCH_ALLOCATION_COUNTER_H
+
+#include <stdint.h>
+
+// Allocation counts of the benchmark programs. Linking allocation-counter.cc
+// into a program replaces its global operator new and delete with ones that
+// keep these counts.
+
+/**
+ * /brief Calls of operator new so far */
+uint64_t GetAllocations (void);
+
+/**
+ * /brief Bytes asked of operator new so far */
+uint64_t GetAllocatedBytes (void);
+
+/**
+ * /brief Bytes allocated and not freed yet */
+int64_t GetLiveBytes (void);
+
+#endif /* BENCH_ALLOCATION_COUNTER_H */
@@ -0,0 +1,260 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+// Throughput of the DNSHeader codec.
+//
+// Every workload is a representative message that is round-tripped
+// through a packet, as every hop does: the header is added to a new
+// Packet and removed from it again.
+//
+//   query     a recursive query for one A record
+//   reply     the reply to it, with one answer
+//   cdn       the reply of a CDN, with cdnAnswers A records
+//   referral  a referral to a zone, with its NS records in the authority
+//             section and their glue in the additional section
+//
+// Each workload runs until minTime has passed or maxMessages messages are
+// done. Allocations are counted by allocation-counter.cc. One CSV line is
+// written per workload:
+//
+//   workload,message_bytes,messages,ns_per_msg,msgs_per_s,bytes_per_s,allocs_per_msg
+//
+// where bytes_per_s is counted in serialized message bytes.
+
+#include <stdint.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/core-module.h"
+#include "ns3/packet.h"
+
+#include "ns3/dns-module.h"
+
+#include "allocation-counter.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DnsHeaderBench");
+
+class DnsHeaderBench
+{
+public:
+  DnsHeaderBench (double minTime, uint64_t maxMessages, uint32_t cdnAnswers, uint32_t referralServers);
+
+  /**
+   * /brief Time the round trip of a workload
+   * /returns false if there is no such workload */
+  bool Run (const std::string& workload, std::ostream& os);
+
+private:
+  static QuestionSectionHeader Question (const std::string& qName, uint16_t qType);
+  static ResourceRecordHeader ARecord (const std::string& name, uint32_t address);
+
+  DNSHeader Query (void) const;
+  DNSHeader Reply (void) const;
+  DNSHeader CdnReply (void) const;
+  DNSHeader Referral (void) const;
+
+  double m_minTime;            //!< seconds each workload runs at least
+  uint64_t m_maxMessages;      //!< messages each workload runs at most
+  uint32_t m_cdnAnswers;       //!< answers of the CDN reply
+  uint32_t m_referralServers;  //!< name servers of the referral
+};
+
+DnsHeaderBench::DnsHeaderBench (double minTime, uint64_t maxMessages, uint32_t cdnAnswers, uint32_t referralServers)
+  : m_minTime (minTime),
+    m_maxMessages (maxMessages),
+    m_cdnAnswers (cdnAnswers),
+    m_referralServers (referralServers)
+{
+}
+
+QuestionSectionHeader
+DnsHeaderBench::Question (const std::string& qName, uint16_t qType)
+{
+  QuestionSectionHeader question;
+  question.SetqName (qName);
+  question.SetqType (qType);
+  question.SetqClass (RR_CLASS_IN);
+  return question;
+}
+
+ResourceRecordHeader
+DnsHeaderBench::ARecord (const std::string& name, uint32_t address)
+{
+  ResourceRecordHeader record;
+  record.SetName (name);
+  record.SetClass (RR_CLASS_IN);
+  record.SetTimeToLive (300);
+  record.SetRData<RR_TYPE_A> (Ipv4Address (address));
+  return record;
+}
+
+DNSHeader
+DnsHeaderBench::Query (void) const
+{
+  DNSHeader header;
+  header.SetId (4711);
+  header.SetQRbit (1);
+  header.SetRDbit (1);
+  header.AddQuestion (Question ("www.example.com", RR_TYPE_A));
+  return header;
+}
+
+DNSHeader
+DnsHeaderBench::Reply (void) const
+{
+  DNSHeader header;
+  header.SetId (4711);
+  header.SetQRbit (0);
+  header.SetRDbit (1);
+  header.SetRAbit (1);
+  header.AddQuestion (Question ("www.example.com", RR_TYPE_A));
+  header.AddAnswer (ARecord ("www.example.com", 0xc0000201));  // 192.0.2.1
+  return header;
+}
+
+DNSHeader
+DnsHeaderBench::CdnReply (void) const
+{
+  DNSHeader header;
+  header.SetId (4711);
+  header.SetQRbit (0);
+  header.SetAAbit (1);
+  header.AddQuestion (Question ("video.cdn.example.net", RR_TYPE_A));
+  for (uint32_t n = 0; n < m_cdnAnswers; n++)
+  {
+    header.AddAnswer (ARecord ("video.cdn.example.net", 0xc6336400 + n));  // 198.51.100.0/24
+  }
+  return header;
+}
+
+DNSHeader
+DnsHeaderBench::Referral (void) const
+{
+  DNSHeader header;
+  header.SetId (4711);
+  header.SetQRbit (0);
+  header.AddQuestion (Question ("www.example.com", RR_TYPE_A));
+  for (uint32_t n = 0; n < m_referralServers; n++)
+  {
+    std::ostringstream serverName;
+    serverName << "ns" << n + 1 << ".example.com";
+
+    ResourceRecordHeader nsRecord;
+    nsRecord.SetName ("example.com");
+    nsRecord.SetClass (RR_CLASS_IN);
+    nsRecord.SetTimeToLive (172800);
+    nsRecord.SetRData<RR_TYPE_NS> (serverName.str ());
+    header.AddNsRecord (nsRecord);
+    header.AddARecord (ARecord (serverName.str (), 0xcb007100 + n));  // 203.0.113.0/24
+  }
+  return header;
+}
+
+bool
+DnsHeaderBench::Run (const std::string& workload, std::ostream& os)
+{
+  DNSHeader message;
+  if (workload == "query")
+  {
+    message = Query ();
+  }
+  else if (workload == "reply")
+  {
+    message = Reply ();
+  }
+  else if (workload == "cdn")
+  {
+    message = CdnReply ();
+  }
+  else if (workload == "referral")
+  {
+    message = Referral ();
+  }
+  else
+  {
+    return false;
+  }
+
+  // A message that does not survive the round trip is not worth timing
+  {
+    Ptr<Packet> packet = Create<Packet> ();
+    packet->AddHeader (message);
+    DNSHeader decoded;
+    packet->RemoveHeader (decoded);
+    NS_ABORT_MSG_UNLESS (decoded.GetQdCount () == message.GetQdCount () &&
+                             decoded.GetAnCount () == message.GetAnCount () &&
+                             decoded.GetNsCount () == message.GetNsCount () &&
+                             decoded.GetArCount () == message.GetArCount () && packet->GetSize () == 0,
+                         "The " << workload << " message does not round-trip");
+  }
+
+  // Doubling batches, so that reading the clock does not weigh on small
+  // messages
+  uint64_t messages = 0;
+  double nanoSeconds = 0;
+  uint64_t allocations = GetAllocations ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+
+  uint64_t batch = 1;
+  while (messages < m_maxMessages && nanoSeconds < m_minTime * 1e9)
+  {
+    for (uint64_t n = 0; n < batch && messages < m_maxMessages; n++)
+    {
+      Ptr<Packet> packet = Create<Packet> ();
+      packet->AddHeader (message);
+      DNSHeader decoded;
+      packet->RemoveHeader (decoded);
+      messages++;
+    }
+    batch *= 2;
+    nanoSeconds = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+  }
+  allocations = GetAllocations () - allocations;
+
+  uint32_t size = message.GetSerializedSize ();
+  double count = messages == 0 ? 1 : messages;
+  double perSecond = nanoSeconds == 0 ? 0 : messages * 1e9 / nanoSeconds;
+  os << workload << "," << size << "," << messages << "," << nanoSeconds / count << "," << perSecond << ","
+     << perSecond * size << "," << allocations / count << std::endl;
+  return true;
+}
+
+int
+main (int argc, char* argv[])
+{
+  std::string workloads = "query,reply,cdn,referral";
+  double minTime = 0.5;
+  uint64_t maxMessages = 10000000;
+  uint32_t cdnAnswers = 50;
+  uint32_t referralServers = 4;
+
+  CommandLine cmd;
+  cmd.AddValue ("workloads", "Comma-separated workloads: query, reply, cdn, referral", workloads);
+  cmd.AddValue ("minTime", "Seconds each workload runs at least", minTime);
+  cmd.AddValue ("maxMessages", "Messages each workload runs at most", maxMessages);
+  cmd.AddValue ("cdnAnswers", "Answers of the CDN reply (at most 65535)", cdnAnswers);
+  cmd.AddValue ("referralServers", "Name servers, each with its glue, of the referral (at most 65535)", referralServers);
+  cmd.Parse (argc, argv);
+
+  // The section counts of a message are 16 bits wide
+  NS_ABORT_MSG_IF (cdnAnswers > 0xffff || referralServers > 0xffff, "More records than a message section holds");
+
+  DnsHeaderBench bench (minTime, maxMessages, cdnAnswers, referralServers);
+
+  std::cout << "workload,message_bytes,messages,ns_per_msg,msgs_per_s,bytes_per_s,allocs_per_msg" << std::endl;
+  std::istringstream list (workloads);
+  std::string workload;
+  while (std::getline (list, workload, ','))
+  {
+    if (!workload.empty () && !bench.Run (workload, std::cout))
+    {
+      NS_ABORT_MSG ("Unknown workload " << workload);
+    }
+  }
+  return 0;
+}
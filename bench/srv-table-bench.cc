@@ -0,0 +1,302 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+// Microbenchmark of SRVTable.
+//
+// For every table size from minRecords to maxRecords (in powers of ten) a
+// table is filled with zone records and every operation is timed on it:
+//
+//   populate  AddZone, filling the table to its size
+//   find      FindARecord of an existing name
+//   suffix    FindARecordMatches of a name below an existing one
+//   subtree   FindAllRecordsHas of a zone, and ReleaseInstance
+//   add       AddRecord, which also schedules the expiry of the record
+//   rotate    SwitchServersRoundRobin
+//   expire    expiry of the added records by the simulator
+//   delete    DeleteRecord of an existing record
+//
+// Each operation runs until minTime has passed or maxOps operations are
+// done. Allocations are counted by allocation-counter.cc.
+// One CSV line is written per size and operation:
+//
+//   records,operation,ops,ns_per_op,allocs_per_op,bytes_per_op,bytes_per_record
+//
+// where bytes_per_op is the memory the operations allocated, and
+// bytes_per_record the memory the table holds per record once populated.
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/core-module.h"
+
+#include "ns3/dns-module.h"
+
+#include "allocation-counter.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SrvTableBench");
+
+/// Query names drawn by the operations, prepared before the timing starts
+static const uint32_t QUERY_NAMES = 1024;
+
+class SrvTableBench
+{
+public:
+  SrvTableBench (uint32_t records, uint32_t zones, double minTime, uint64_t maxOps);
+  ~SrvTableBench ();
+
+  void Run (std::ostream& os);
+
+private:
+  typedef void (SrvTableBench::*Operation) (uint64_t n);
+
+  /// Cost of running an operation a number of times
+  struct Sample
+  {
+    uint64_t ops;
+    double nanoSeconds;
+    uint64_t allocations;
+    uint64_t bytes;
+  };
+
+  std::string RecordName (uint32_t index) const;
+  std::string ZoneName (uint32_t zone) const;
+  uint32_t Pick (uint64_t n) const;
+  Sample Measure (Operation operation, uint64_t maxOps, double minTime);
+  void Write (std::ostream& os, const std::string& name, const Sample& sample) const;
+
+  void Populate (uint64_t n);
+  void Find (uint64_t n);
+  void Suffix (uint64_t n);
+  void Subtree (uint64_t n);
+  void Add (uint64_t n);
+  void Rotate (uint64_t n);
+  void Delete (uint64_t n);
+
+  uint32_t m_records;                      //!< size of the table
+  uint32_t m_zones;                        //!< zones the records are spread over
+  double m_minTime;                        //!< seconds each operation runs at least
+  uint64_t m_maxOps;                       //!< operations each operation runs at most
+  SRVTable m_table;                        //!< the table under test
+  std::vector<uint8_t> m_rData;            //!< encoded RDATA of every record
+  std::vector<std::string> m_names;        //!< names of existing records
+  std::vector<std::string> m_belowNames;   //!< names below existing records
+  std::vector<std::string> m_zoneNames;    //!< zones of existing records
+  std::vector<std::string> m_newNames;     //!< names of added records
+  std::vector<SRVRecordEntry*> m_victims;  //!< copies of records to delete
+  SRVTable::SRVRecordInstance m_subtree;   //!< records of the last subtree
+  double m_bytesPerRecord;                 //!< memory held by the table per record
+};
+
+SrvTableBench::SrvTableBench (uint32_t records, uint32_t zones, double minTime, uint64_t maxOps)
+  : m_records (records),
+    m_zones (zones),
+    m_minTime (minTime),
+    m_maxOps (maxOps),
+    m_bytesPerRecord (0)
+{
+  RDataFromString (RR_TYPE_A, "192.0.2.1", m_rData);
+
+  // Every operation gets distinct names, spread over the whole table
+  for (uint32_t n = 0; n < QUERY_NAMES; n++)
+  {
+    uint32_t index = Pick (n);
+    m_names.push_back (RecordName (index));
+    m_belowNames.push_back ("www." + RecordName (index));
+    m_zoneNames.push_back ("." + ZoneName (index % m_zones));
+
+    std::ostringstream added;
+    added << "n" << n << "." << ZoneName (n % m_zones);
+    m_newNames.push_back (added.str ());
+
+    m_victims.push_back (new SRVRecordEntry (RecordName (index), 3600, 1, RR_TYPE_A, m_rData));
+  }
+}
+
+SrvTableBench::~SrvTableBench ()
+{
+  m_table.ReleaseInstance (m_subtree);
+  m_table.DoDispose ();
+  for (std::vector<SRVRecordEntry*>::iterator it = m_victims.begin (); it != m_victims.end (); it++)
+  {
+    delete *it;
+  }
+}
+
+std::string
+SrvTableBench::RecordName (uint32_t index) const
+{
+  std::ostringstream os;
+  os << "r" << index << "." << ZoneName (index % m_zones);
+  return os.str ();
+}
+
+std::string
+SrvTableBench::ZoneName (uint32_t zone) const
+{
+  std::ostringstream os;
+  os << "z" << zone << ".bench";
+  return os.str ();
+}
+
+// A record index for the n-th operation, spread evenly over the table
+uint32_t
+SrvTableBench::Pick (uint64_t n) const
+{
+  return static_cast<uint32_t> ((n * 2654435761u) % m_records);
+}
+
+// Run an operation in doubling batches until it took minTime seconds or
+// maxOps operations are done, so that reading the clock does not weigh on
+// fast operations.
+SrvTableBench::Sample
+SrvTableBench::Measure (Operation operation, uint64_t maxOps, double minTime)
+{
+  Sample sample;
+  sample.ops = 0;
+  sample.nanoSeconds = 0;
+
+  uint64_t allocations = GetAllocations ();
+  uint64_t bytes = GetAllocatedBytes ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+
+  uint64_t batch = 1;
+  while (sample.ops < maxOps && sample.nanoSeconds < minTime * 1e9)
+  {
+    for (uint64_t n = 0; n < batch && sample.ops < maxOps; n++)
+    {
+      (this->*operation) (sample.ops);
+      sample.ops++;
+    }
+    batch *= 2;
+    sample.nanoSeconds = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+  }
+
+  sample.allocations = GetAllocations () - allocations;
+  sample.bytes = GetAllocatedBytes () - bytes;
+  return sample;
+}
+
+void
+SrvTableBench::Write (std::ostream& os, const std::string& name, const Sample& sample) const
+{
+  double ops = sample.ops == 0 ? 1 : sample.ops;
+  os << m_records << "," << name << "," << sample.ops << "," << sample.nanoSeconds / ops << ","
+     << sample.allocations / ops << "," << sample.bytes / ops << "," << m_bytesPerRecord << std::endl;
+}
+
+void
+SrvTableBench::Run (std::ostream& os)
+{
+  int64_t liveBytes = GetLiveBytes ();
+  // Populate has to fill the table whatever the time it takes
+  Sample populate = Measure (&SrvTableBench::Populate, m_records, std::numeric_limits<double>::infinity ());
+  m_bytesPerRecord = double (GetLiveBytes () - liveBytes) / m_records;
+  Write (os, "populate", populate);
+
+  Write (os, "find", Measure (&SrvTableBench::Find, m_maxOps, m_minTime));
+  Write (os, "suffix", Measure (&SrvTableBench::Suffix, m_maxOps, m_minTime));
+  Write (os, "subtree", Measure (&SrvTableBench::Subtree, m_maxOps, m_minTime));
+
+  // The added records expire after one to six seconds. Rotating moves them
+  // towards the tail, where the oldest records of a table are.
+  Sample add = Measure (&SrvTableBench::Add, m_maxOps, m_minTime);
+  Write (os, "add", add);
+  Write (os, "rotate", Measure (&SrvTableBench::Rotate, m_maxOps, m_minTime));
+
+  Sample expire;
+  uint64_t evictions = m_table.GetEvictions ();
+  uint64_t allocations = GetAllocations ();
+  uint64_t bytes = GetAllocatedBytes ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Stop (Seconds (7));
+  Simulator::Run ();
+  expire.nanoSeconds = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+  expire.ops = m_table.GetEvictions () - evictions;
+  expire.allocations = GetAllocations () - allocations;
+  expire.bytes = GetAllocatedBytes () - bytes;
+  Write (os, "expire", expire);
+
+  Write (os, "delete", Measure (&SrvTableBench::Delete, std::min<uint64_t> (m_maxOps, QUERY_NAMES), m_minTime));
+}
+
+void
+SrvTableBench::Populate (uint64_t n)
+{
+  m_table.AddZone (RecordName (n), 1, RR_TYPE_A, 3600, "192.0.2.1");
+}
+
+void
+SrvTableBench::Find (uint64_t n)
+{
+  bool found = false;
+  m_table.FindARecord (m_names[n % QUERY_NAMES], found);
+  NS_ABORT_MSG_UNLESS (found, "Missing record " << m_names[n % QUERY_NAMES]);
+}
+
+void
+SrvTableBench::Suffix (uint64_t n)
+{
+  bool found = false;
+  m_table.FindARecordMatches (m_belowNames[n % QUERY_NAMES], found);
+  NS_ABORT_MSG_UNLESS (found, "No record above " << m_belowNames[n % QUERY_NAMES]);
+}
+
+void
+SrvTableBench::Subtree (uint64_t n)
+{
+  m_table.ReleaseInstance (m_subtree);
+  m_table.FindAllRecordsHas (m_zoneNames[n % QUERY_NAMES], m_subtree);
+}
+
+void
+SrvTableBench::Add (uint64_t n)
+{
+  m_table.AddRecord (m_newNames[n % QUERY_NAMES], 1, RR_TYPE_A, 1, m_rData);
+}
+
+void
+SrvTableBench::Rotate (uint64_t /* n */)
+{
+  m_table.SwitchServersRoundRobin ();
+}
+
+void
+SrvTableBench::Delete (uint64_t n)
+{
+  m_table.DeleteRecord (m_victims[n % QUERY_NAMES]);
+}
+
+int
+main (int argc, char* argv[])
+{
+  uint32_t minRecords = 1000;
+  uint32_t maxRecords = 10000000;
+  uint32_t zones = 1000;
+  double minTime = 0.2;
+  uint64_t maxOps = 1000000;
+
+  CommandLine cmd;
+  cmd.AddValue ("minRecords", "Smallest table size", minRecords);
+  cmd.AddValue ("maxRecords", "Largest table size", maxRecords);
+  cmd.AddValue ("zones", "Zones the records are spread over", zones);
+  cmd.AddValue ("minTime", "Seconds each operation runs at least", minTime);
+  cmd.AddValue ("maxOps", "Operations each operation runs at most", maxOps);
+  cmd.Parse (argc, argv);
+
+  std::cout << "records,operation,ops,ns_per_op,allocs_per_op,bytes_per_op,bytes_per_record" << std::endl;
+  for (uint64_t records = minRecords; records <= maxRecords; records *= 10)
+  {
+    SrvTableBench bench (records, zones, minTime, maxOps);
+    bench.Run (std::cout);
+    Simulator::Destroy ();
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+// Print the event traces dumped by BindServer::WriteEventTrace, one event
+// per line, e.g.,
+//
+//   ./waf --run "dns-scale-example --eventTraceFile=dns.evt"
+//   ./waf --run "dns-event-trace-decode --input=dns.evt"
+//
+// Names are recorded as hashes; with --name the hash of a name is printed
+// first, to find its events.
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "ns3/core-module.h"
+
+#include "ns3/dns-module.h"
+
+using namespace ns3;
+NS_LOG_COMPONENT_DEFINE ("DnsEventTraceDecode");
+
+int
+main (int argc, char *argv[])
+{
+  std::string input;
+  std::string name;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "File holding the event trace dumps", input);
+  cmd.AddValue ("name", "Name whose hash is printed", name);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (input.empty (), "No input file given");
+  std::ifstream is (input.c_str (), std::ios::binary);
+  NS_ABORT_MSG_UNLESS (is, "Cannot open " << input);
+
+  if (!name.empty ())
+  {
+    std::cout << "# " << name << " " << std::hex << std::setw (8) << std::setfill ('0')
+              << DnsEventTrace::Hash (name) << std::dec << std::setfill (' ') << std::endl;
+  }
+  if (!DnsEventTrace::Decode (is, std::cout))
+  {
+    std::cerr << input << " is not a complete event trace" << std::endl;
+    return 1;
+  }
+  return 0;
+}
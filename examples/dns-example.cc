@@ -40,9 +40,9 @@ RecvDnsQuery (Ptr<Socket> socket)
   DNSHeader header;
   packet->RemoveHeader (header);
 
-  std::list<ResourceRecordHeader> answers = header.GetAnswerList ();
+  const std::list<ResourceRecordHeader>& answers = header.GetAnswerList ();
 
-  std::string qName = answers.begin ()->GetName ();
+  const std::string& qName = answers.begin ()->GetName ();
   std::string rData = answers.begin ()->GetRData ();
 
   NS_LOG_INFO ("RecvDnsQuery:" << qName << ":" << rData);
@@ -183,11 +183,12 @@ main (int argc, char *argv[])
     BindServerHelper bindServer (BindServer::ROOT_SERVER);
     bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (getAddress (rootServer)));
     ApplicationContainer apps = bindServer.Install (rootServer);
+    bindServer.AddNSRecord (apps.Get (0), "jp", 86400, RR_CLASS_IN, RR_TYPE_NS, "ns1.jp");
     bindServer.AddNSRecord (apps.Get (0),
-                            ".jp",
+                            "ns1.jp",
                             86400,
-                            1,
-                            1,
+                            RR_CLASS_IN,
+                            RR_TYPE_A,
                             getAddressString (tldServer));
     apps.Start (Seconds (2.0));
     apps.Stop (Seconds (60.0));
@@ -198,11 +199,12 @@ main (int argc, char *argv[])
     BindServerHelper bindServer (BindServer::TLD_SERVER);
     bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (getAddress (tldServer)));
     ApplicationContainer apps = bindServer.Install (tldServer);
+    bindServer.AddNSRecord (apps.Get (0), "co.jp", 86400, RR_CLASS_IN, RR_TYPE_NS, "ns1.co.jp");
     bindServer.AddNSRecord (apps.Get (0),
-                            ".co.jp",
+                            "ns1.co.jp",
                             86400,
-                            1,
-                            1,
+                            RR_CLASS_IN,
+                            RR_TYPE_A,
                             getAddressString (ispServer));
     apps.Start (Seconds (2.0));
     apps.Stop (Seconds (60.0));
@@ -213,11 +215,12 @@ main (int argc, char *argv[])
     BindServerHelper bindServer (BindServer::ISP_SERVER);
     bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (getAddress (ispServer)));
     ApplicationContainer apps = bindServer.Install (ispServer);
+    bindServer.AddNSRecord (apps.Get (0), "example.co.jp", 86400, RR_CLASS_IN, RR_TYPE_NS, "ns1.example.co.jp");
     bindServer.AddNSRecord (apps.Get (0),
-                            ".example.co.jp",
+                            "ns1.example.co.jp",
                             86400,
-                            1,
-                            1,
+                            RR_CLASS_IN,
+                            RR_TYPE_A,
                             getAddressString (authServer));
     apps.Start (Seconds (2.0));
     apps.Stop (Seconds (60.0));
@@ -231,8 +234,8 @@ main (int argc, char *argv[])
     bindServer.AddNSRecord (apps.Get (0),
                             "www.example.co.jp",
                             86400,
-                            1,
-                            1,
+                            RR_CLASS_IN,
+                            RR_TYPE_A,
                             getAddressString (server));
     apps.Start (Seconds (2.0));
     apps.Stop (Seconds (60.0));
@@ -0,0 +1,373 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+// Generated DNS hierarchy, to find how far the module scales.
+//
+// Every node hangs off one core router by a point-to-point link:
+//
+//   clients       DnsClient applications sending Poisson queries, each to
+//                 one of the local resolvers
+//   resolvers     Local servers, resolving iteratively from the root
+//   root servers  replicas of the root zone, delegating every TLD to all
+//                 TLD servers
+//   TLD servers   replicas serving every TLD, delegating every zone to its
+//                 authoritative server
+//   auth servers  Authoritative servers, each holding the hosts of every
+//                 authServers-th zone
+//
+// The zone tree is synthetic: zone z is "zone<z>.tld<z % tlds>" and holds
+// the names "host<h>.zone<z>.tld<z % tlds>". The clients ask for the first
+// names of the tree, spread over all zones and ranked by a Zipf law.
+//
+// After the run the wall-clock time of the setup and of the simulation is
+// written together with the events and the queries simulated per second of
+// wall-clock time. Further settings of the servers and clients are set on
+// the command line as defaults, e.g.,
+//
+//   --ns3::BindServer::EnablePacketCache=true --ns3::DnsClient::ZipfExponent=0.9
+//
+// The memory the resolvers and servers use is summed up at the end; with
+// memoryReport the memory of every server is written as well.
+//
+// With eventTraceFile set, and the module configured with
+// --enable-dns-event-trace, the event traces of all servers are dumped to
+// that file, to be read with dns-event-trace-decode.
+
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "ns3/dns-module.h"
+
+using namespace ns3;
+NS_LOG_COMPONENT_DEFINE ("DnsScaleExample");
+
+// Connect a node to the core router and return the address of the node
+static Ipv4Address
+Connect (Ptr<Node> core, Ptr<Node> node, PointToPointHelper& p2p, Ipv4AddressHelper& address)
+{
+  Ipv4InterfaceContainer interfaces = address.Assign (p2p.Install (node, core));
+  address.NewNetwork ();
+  return interfaces.GetAddress (0);
+}
+
+// Create nodes with the Internet stack, connected to the core router
+static NodeContainer
+CreateNodes (uint32_t count,
+             Ptr<Node> core,
+             PointToPointHelper& p2p,
+             Ipv4AddressHelper& address,
+             std::vector<Ipv4Address>& addresses)
+{
+  NodeContainer nodes;
+  nodes.Create (count);
+  InternetStackHelper stack;
+  stack.Install (nodes);
+  for (uint32_t n = 0; n < count; n++)
+  {
+    addresses.push_back (Connect (core, nodes.Get (n), p2p, address));
+  }
+  return nodes;
+}
+
+static std::string
+TldName (uint32_t tld)
+{
+  std::ostringstream os;
+  os << "tld" << tld;
+  return os.str ();
+}
+
+static std::string
+ZoneName (uint32_t zone, uint32_t tlds)
+{
+  std::ostringstream os;
+  os << "zone" << zone << "." << TldName (zone % tlds);
+  return os.str ();
+}
+
+static std::string
+HostName (uint32_t host, uint32_t zone, uint32_t tlds)
+{
+  std::ostringstream os;
+  os << "host" << host << "." << ZoneName (zone, tlds);
+  return os.str ();
+}
+
+static std::string
+AddressString (Ipv4Address address)
+{
+  std::ostringstream os;
+  os << address;
+  return os.str ();
+}
+
+static uint64_t
+Counter (Ptr<Application> app, const std::string& name)
+{
+  UintegerValue value;
+  app->GetAttribute (name, value);
+  return value.Get ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t clients = 100;
+  uint32_t resolvers = 4;
+  uint32_t rootServers = 3;
+  uint32_t tldServers = 2;
+  uint32_t tlds = 10;
+  uint32_t authServers = 20;
+  uint32_t zones = 200;
+  uint32_t hostsPerZone = 50;
+  uint32_t names = 1000;
+  double queryRate = 1.0;
+  double duration = 60.0;
+  std::string eventTraceFile;
+  uint32_t eventTraceSize = 65536;
+  bool memoryReport = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("clients", "Number of clients", clients);
+  cmd.AddValue ("resolvers", "Number of local resolvers", resolvers);
+  cmd.AddValue ("rootServers", "Number of root server replicas", rootServers);
+  cmd.AddValue ("tldServers", "Number of TLD server replicas", tldServers);
+  cmd.AddValue ("tlds", "Number of top level domains", tlds);
+  cmd.AddValue ("authServers", "Number of authoritative servers", authServers);
+  cmd.AddValue ("zones", "Number of zones below the TLDs", zones);
+  cmd.AddValue ("hostsPerZone", "Number of names in every zone", hostsPerZone);
+  cmd.AddValue ("names", "Number of names the clients ask for", names);
+  cmd.AddValue ("queryRate", "Queries per second of every client", queryRate);
+  cmd.AddValue ("duration", "Seconds of simulated time the clients send queries", duration);
+  cmd.AddValue ("memoryReport", "Write the memory taken by every server", memoryReport);
+  cmd.AddValue ("eventTraceFile", "File the event traces of the servers are dumped to", eventTraceFile);
+  cmd.AddValue ("eventTraceSize", "Events kept per server when eventTraceFile is set", eventTraceSize);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_UNLESS (clients > 0 && resolvers > 0 && rootServers > 0 && tldServers > 0 && tlds > 0 &&
+                           authServers > 0 && zones > 0 && hostsPerZone > 0,
+                       "Every part of the hierarchy needs at least one member");
+  names = std::min (names, zones * hostsPerZone);
+  if (!eventTraceFile.empty ())
+  {
+    Config::SetDefault ("ns3::BindServer::EventTraceSize", UintegerValue (eventTraceSize));
+  }
+
+  SystemWallClockMs setupClock;
+  setupClock.Start ();
+
+  // Topology: a star around the core router, one /30 per link
+  Ptr<Node> core = CreateObject<Node> ();
+  {
+    InternetStackHelper stack;
+    stack.Install (core);
+  }
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+
+  std::vector<Ipv4Address> rootAddresses, tldAddresses, authAddresses, resolverAddresses, clientAddresses;
+  NodeContainer rootNodes = CreateNodes (rootServers, core, p2p, address, rootAddresses);
+  NodeContainer tldNodes = CreateNodes (tldServers, core, p2p, address, tldAddresses);
+  NodeContainer authNodes = CreateNodes (authServers, core, p2p, address, authAddresses);
+  NodeContainer resolverNodes = CreateNodes (resolvers, core, p2p, address, resolverAddresses);
+  NodeContainer clientNodes = CreateNodes (clients, core, p2p, address, clientAddresses);
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  Time stop = Seconds (2.0 + duration + 5.0);
+  ApplicationContainer serverApps;
+
+  // Root servers: every TLD is served by every TLD server
+  for (uint32_t n = 0; n < rootServers; n++)
+  {
+    BindServerHelper bindServer (BindServer::ROOT_SERVER);
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (rootAddresses[n]));
+    ApplicationContainer apps = bindServer.Install (rootNodes.Get (n));
+    for (uint32_t tld = 0; tld < tlds; tld++)
+    {
+      for (uint32_t replica = 0; replica < tldServers; replica++)
+      {
+        bindServer.AddNSRecord (apps.Get (0),
+                                "." + TldName (tld),
+                                86400,
+                                RR_CLASS_IN,
+                                RR_TYPE_A,
+                                AddressString (tldAddresses[replica]));
+      }
+    }
+    apps.Start (Seconds (1.0));
+    apps.Stop (stop);
+    serverApps.Add (apps);
+  }
+
+  // TLD servers: every zone is served by one authoritative server
+  for (uint32_t n = 0; n < tldServers; n++)
+  {
+    BindServerHelper bindServer (BindServer::TLD_SERVER);
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (tldAddresses[n]));
+    ApplicationContainer apps = bindServer.Install (tldNodes.Get (n));
+    for (uint32_t zone = 0; zone < zones; zone++)
+    {
+      bindServer.AddNSRecord (apps.Get (0),
+                              "." + ZoneName (zone, tlds),
+                              86400,
+                              RR_CLASS_IN,
+                              RR_TYPE_A,
+                              AddressString (authAddresses[zone % authServers]));
+    }
+    apps.Start (Seconds (1.0));
+    apps.Stop (stop);
+    serverApps.Add (apps);
+  }
+
+  // Authoritative servers: the hosts of their zones
+  for (uint32_t n = 0; n < authServers; n++)
+  {
+    BindServerHelper bindServer (BindServer::AUTH_SERVER);
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (authAddresses[n]));
+    ApplicationContainer apps = bindServer.Install (authNodes.Get (n));
+    for (uint32_t zone = n; zone < zones; zone += authServers)
+    {
+      for (uint32_t host = 0; host < hostsPerZone; host++)
+      {
+        std::ostringstream rData;
+        rData << "198.51." << (host >> 8) % 256 << "." << host % 256;
+        bindServer.AddNSRecord (apps.Get (0), HostName (host, zone, tlds), 3600, RR_CLASS_IN, RR_TYPE_A, rData.str ());
+      }
+    }
+    apps.Start (Seconds (1.0));
+    apps.Stop (stop);
+    serverApps.Add (apps);
+  }
+
+  // Local resolvers: every root replica is known
+  ApplicationContainer resolverApps;
+  for (uint32_t n = 0; n < resolvers; n++)
+  {
+    BindServerHelper bindServer (BindServer::LOCAL_SERVER);
+    bindServer.SetAttribute ("SetRecursiveSupport", EnumValue (BindServer::RA_AVAILABLE));
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (resolverAddresses[n]));
+    bindServer.SetAttribute ("RootServerAddress", Ipv4AddressValue (rootAddresses[0]));
+    ApplicationContainer apps = bindServer.Install (resolverNodes.Get (n));
+    for (uint32_t replica = 1; replica < rootServers; replica++)
+    {
+      bindServer.AddRootServer (apps.Get (0), rootAddresses[replica]);
+    }
+    apps.Start (Seconds (1.0));
+    apps.Stop (stop);
+    serverApps.Add (apps);
+    resolverApps.Add (apps);
+  }
+
+  // Clients: spread over the resolvers, asking for names of every zone
+  ApplicationContainer clientApps;
+  for (uint32_t n = 0; n < resolvers; n++)
+  {
+    DnsClientHelper dnsClient;
+    dnsClient.SetAttribute ("QueryRate", DoubleValue (queryRate));
+    dnsClient.AddResolver (resolverAddresses[n]);
+    for (uint32_t name = 0; name < names; name++)
+    {
+      dnsClient.AddName (HostName ((name / zones) % hostsPerZone, name % zones, tlds));
+    }
+
+    NodeContainer nodes;
+    for (uint32_t client = n; client < clients; client += resolvers)
+    {
+      nodes.Add (clientNodes.Get (client));
+    }
+    ApplicationContainer apps = dnsClient.Install (nodes);
+    apps.Start (Seconds (2.0));
+    apps.Stop (Seconds (2.0 + duration));
+    clientApps.Add (apps);
+  }
+
+  int64_t setupMs = setupClock.End ();
+
+  SystemWallClockMs runClock;
+  runClock.Start ();
+  Simulator::Stop (stop);
+  Simulator::Run ();
+  int64_t runMs = runClock.End ();
+
+  uint64_t sent = 0, answered = 0, failed = 0;
+  for (uint32_t n = 0; n < clientApps.GetN (); n++)
+  {
+    sent += Counter (clientApps.Get (n), "QueriesSent");
+    answered += Counter (clientApps.Get (n), "QueriesAnswered");
+    failed += Counter (clientApps.Get (n), "QueriesFailed");
+  }
+  uint64_t upstream = 0;
+  for (uint32_t n = 0; n < resolverApps.GetN (); n++)
+  {
+    upstream += Counter (resolverApps.Get (n), "UpstreamQueries");
+  }
+  // The resolvers were installed last. Caches count with their peak.
+  uint64_t resolverMemory = 0, serverMemory = 0;
+  for (uint32_t n = 0; n < serverApps.GetN (); n++)
+  {
+    Ptr<Application> app = serverApps.Get (n);
+    uint64_t memory = Counter (app, "CacheMemoryPeak") + Counter (app, "DelegationCacheMemoryPeak") +
+                      Counter (app, "PendingQueryMemory") + Counter (app, "HeaderMemory");
+    if (n < serverApps.GetN () - resolvers)
+    {
+      serverMemory += memory;
+    }
+    else
+    {
+      resolverMemory += memory;
+    }
+  }
+  uint64_t events = Simulator::GetEventCount ();
+
+  double runSeconds = std::max<int64_t> (runMs, 1) / 1000.0;
+  std::cout << "nodes " << 1 + rootServers + tldServers + authServers + resolvers + clients << std::endl
+            << "records " << uint64_t (rootServers) * tlds * tldServers + uint64_t (tldServers) * zones +
+                                 uint64_t (zones) * hostsPerZone
+            << std::endl
+            << "setup wall-clock (s) " << setupMs / 1000.0 << std::endl
+            << "run wall-clock (s) " << runMs / 1000.0 << std::endl
+            << "simulated time (s) " << stop.GetSeconds () << std::endl
+            << "events " << events << std::endl
+            << "events per second " << events / runSeconds << std::endl
+            << "queries sent " << sent << " answered " << answered << " failed " << failed << std::endl
+            << "upstream queries " << upstream << std::endl
+            << "simulated queries per second " << sent / runSeconds << std::endl
+            << "resolver memory (bytes) " << resolverMemory << std::endl
+            << "server memory (bytes) " << serverMemory << std::endl;
+
+  if (memoryReport)
+  {
+    for (uint32_t n = 0; n < serverApps.GetN (); n++)
+    {
+      DynamicCast<BindServer> (serverApps.Get (n))->WriteMemoryReport (std::cout);
+    }
+  }
+
+  if (!eventTraceFile.empty ())
+  {
+    std::ofstream trace (eventTraceFile.c_str (), std::ios::binary);
+    NS_ABORT_MSG_UNLESS (trace, "Cannot open " << eventTraceFile);
+    for (uint32_t n = 0; n < serverApps.GetN (); n++)
+    {
+      DynamicCast<BindServer> (serverApps.Get (n))->WriteEventTrace (trace);
+    }
+  }
+
+  Simulator::Destroy ();
+  return 0;
+}
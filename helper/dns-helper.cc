@@ -25,6 +25,31 @@ BindServerHelper::AddNSRecord (Ptr<Application> app, std::string name, uint32_t
   app->GetObject<BindServer> ()->AddZone (name, TTL, nsClass, type, rData);
 }
 
+void
+BindServerHelper::AddRootServer (Ptr<Application> app, Ipv4Address address)
+{
+  app->GetObject<BindServer> ()->AddRootServer (address);
+}
+
+int64_t
+BindServerHelper::AssignStreams (NodeContainer c, int64_t stream)
+{
+  int64_t currentStream = stream;
+  for (NodeContainer::Iterator it = c.Begin (); it != c.End (); it++)
+  {
+    Ptr<Node> node = *it;
+    for (uint32_t n = 0; n < node->GetNApplications (); n++)
+    {
+      Ptr<BindServer> server = DynamicCast<BindServer> (node->GetApplication (n));
+      if (server)
+      {
+        currentStream += server->AssignStreams (currentStream);
+      }
+    }
+  }
+  return currentStream - stream;
+}
+
 ApplicationContainer
 BindServerHelper::Install (Ptr<Node> node) const
 {
@@ -58,4 +83,75 @@ BindServerHelper::InstallPriv (Ptr<Node> node) const
 
   return app;
 }
+
+DnsClientHelper::DnsClientHelper ()
+{
+  m_factory.SetTypeId (DnsClient::GetTypeId ());
+}
+
+void
+DnsClientHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+void
+DnsClientHelper::AddResolver (Ipv4Address address)
+{
+  m_resolvers.push_back (address);
+}
+
+void
+DnsClientHelper::AddName (std::string name)
+{
+  m_names.push_back (name);
+}
+
+void
+DnsClientHelper::AddScheduledQuery (Ptr<Application> app, Time at, std::string name)
+{
+  app->GetObject<DnsClient> ()->AddScheduledQuery (at, name);
+}
+
+ApplicationContainer
+DnsClientHelper::Install (Ptr<Node> node) const
+{
+  return ApplicationContainer (InstallPriv (node));
+}
+
+ApplicationContainer
+DnsClientHelper::Install (std::string nodeName) const
+{
+  Ptr<Node> node = Names::Find<Node> (nodeName);
+  return ApplicationContainer (InstallPriv (node));
+}
+
+ApplicationContainer
+DnsClientHelper::Install (NodeContainer c) const
+{
+  ApplicationContainer apps;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+  {
+    apps.Add (InstallPriv (*i));
+  }
+
+  return apps;
+}
+
+Ptr<Application>
+DnsClientHelper::InstallPriv (Ptr<Node> node) const
+{
+  Ptr<DnsClient> client = m_factory.Create<DnsClient> ();
+  for (std::vector<Ipv4Address>::const_iterator it = m_resolvers.begin (); it != m_resolvers.end (); it++)
+  {
+    client->AddResolver (*it);
+  }
+  for (std::vector<std::string>::const_iterator it = m_names.begin (); it != m_names.end (); it++)
+  {
+    client->AddName (*it);
+  }
+  node->AddApplication (client);
+
+  return client;
+}
 }
@@ -11,6 +11,7 @@
 
 //#include "ns3/dns.h"
 #include "ns3/bind-server.h"
+#include "ns3/dns-client.h"
 namespace ns3
 {
 class BindServerHelper
@@ -27,10 +28,44 @@ public:
                     uint16_t nsClass,
                     uint16_t type,
                     std::string rData);
+  void AddRootServer (Ptr<Application> app, Ipv4Address address);
+
+  /**
+   * /brief Assign fixed random variable streams to the servers installed on the nodes
+   * /returns the number of streams used */
+  int64_t AssignStreams (NodeContainer c, int64_t stream);
 
 private:
   Ptr<Application> InstallPriv (Ptr<Node> node) const;
   ObjectFactory m_factory;  //!< Object factory.
 };
+
+class DnsClientHelper
+{
+public:
+  DnsClientHelper ();
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * /brief Add a resolver to every client installed afterwards */
+  void AddResolver (Ipv4Address address);
+
+  /**
+   * /brief Add a name to the population of every client installed afterwards.
+   * Names are ranked by popularity in the order they are added. */
+  void AddName (std::string name);
+
+  void AddScheduledQuery (Ptr<Application> app, Time at, std::string name);
+
+  ApplicationContainer Install (Ptr<Node> node) const;
+  ApplicationContainer Install (std::string nodeName) const;
+  ApplicationContainer Install (NodeContainer c) const;
+
+private:
+  Ptr<Application> InstallPriv (Ptr<Node> node) const;
+  ObjectFactory m_factory;                //!< Object factory.
+  std::vector<Ipv4Address> m_resolvers;  //!< resolvers of the clients
+  std::vector<std::string> m_names;      //!< name population of the clients
+};
 }
 #endif /* DNS_HELPER_H */
@@ -1,17 +1,25 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
 #include "bind-server.h"
 #include "ns3/abort.h"
 #include "ns3/address-utils.h"
+#include "ns3/boolean.h"
 #include "ns3/dns-header.h"
 #include "ns3/dns.h"
+#include "ns3/double.h"
 #include "ns3/enum.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/log.h"
+#include "ns3/node.h"
 #include "ns3/nstime.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/socket-factory.h"
 #include "ns3/socket.h"
+#include "ns3/tcp-socket-factory.h"
 #include "ns3/udp-socket.h"
 #include "ns3/uinteger.h"
 
@@ -54,7 +62,314 @@ BindServer::GetTypeId (void)
                                        EnumValue (BindServer::RA_UNAVAILABLE),
                                        MakeEnumAccessor (&BindServer::m_raType),
                                        MakeEnumChecker (BindServer::RA_UNAVAILABLE, "Does not support",
-                                                        BindServer::RA_AVAILABLE, "Support"));
+                                                        BindServer::RA_AVAILABLE, "Support"))
+                        .AddAttribute ("MaxBatchSize",
+                                       "Maximum number of datagrams drained from the socket and served as one batch.",
+                                       UintegerValue (16),
+                                       MakeUintegerAccessor (&BindServer::m_maxBatchSize),
+                                       MakeUintegerChecker<uint32_t> (1))
+                        .AddAttribute ("EnablePacketCache",
+                                       "Keep the encoded responses of the Root, TLD and Authoritative roles and "
+                                       "answer repeated questions by patching the ID and flags of a cached "
+                                       "response. Where answers are rotated, those of a cached response are "
+                                       "rotated on every hit.",
+                                       BooleanValue (true),
+                                       MakeBooleanAccessor (&BindServer::m_enablePacketCache),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("KeepAnswerTrail",
+                                       "Move the answers found in a query to the additional section of the "
+                                       "response at the ISP and Authoritative roles, to track recursive "
+                                       "resolutions (a debugging aid; it grows the responses at every hop).",
+                                       BooleanValue (false),
+                                       MakeBooleanAccessor (&BindServer::m_keepAnswerTrail),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("PacketCacheSize",
+                                       "Maximum number of responses kept in the packet cache.",
+                                       UintegerValue (1024),
+                                       MakeUintegerAccessor (&BindServer::m_packetCacheSize),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("EnableTcp",
+                                       "Accept queries over TCP on the DNS port in addition to UDP.",
+                                       BooleanValue (true),
+                                       MakeBooleanAccessor (&BindServer::m_enableTcp),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("UpstreamTransport",
+                                       "Transport used by the resolver roles to contact upstream name servers. "
+                                       "TCP connections are pooled per server and reused for later queries.",
+                                       EnumValue (BindServer::TRANSPORT_UDP),
+                                       MakeEnumAccessor (&BindServer::m_upstreamTransport),
+                                       MakeEnumChecker (BindServer::TRANSPORT_UDP, "UDP",
+                                                        BindServer::TRANSPORT_TCP, "TCP"))
+                        .AddAttribute ("MaxUdpPayloadSize",
+                                       "UDP replies larger than this are sent with the TC bit set and "
+                                       "their record sections removed (0 disables truncation).",
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_maxUdpPayloadSize),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("MaxPendingQueries",
+                                       "Maximum number of recursive resolutions in progress. "
+                                       "Further client queries are answered with SERVFAIL.",
+                                       UintegerValue (1024),
+                                       MakeUintegerAccessor (&BindServer::m_maxPendingQueries),
+                                       MakeUintegerChecker<uint32_t> (1))
+                        .AddAttribute ("QueryTimeout",
+                                       "Time to wait for an upstream reply before the first retransmission. "
+                                       "The timeout doubles with every retransmission.",
+                                       TimeValue (MilliSeconds (800)),
+                                       MakeTimeAccessor (&BindServer::m_queryTimeout),
+                                       MakeTimeChecker ())
+                        .AddAttribute ("MaxRetransmissions",
+                                       "Retransmissions of an upstream query before the client gets SERVFAIL.",
+                                       UintegerValue (3),
+                                       MakeUintegerAccessor (&BindServer::m_maxRetransmissions),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("MaxReferrals",
+                                       "Referrals followed by one resolution before the client gets SERVFAIL.",
+                                       UintegerValue (16),
+                                       MakeUintegerAccessor (&BindServer::m_maxReferrals),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("EnableQueryCoalescing",
+                                       "Let queries for a question that is already being resolved wait for "
+                                       "that resolution instead of starting their own.",
+                                       BooleanValue (true),
+                                       MakeBooleanAccessor (&BindServer::m_enableCoalescing),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("SrttDecay",
+                                       "Factor applied to the smoothed RTT of the upstream servers that were "
+                                       "not chosen, so that slower servers are retried after a while.",
+                                       DoubleValue (0.98),
+                                       MakeDoubleAccessor (&BindServer::m_srttDecay),
+                                       MakeDoubleChecker<double> (0, 1))
+                        .AddAttribute ("ProbeProbability",
+                                       "Probability of sending a query to a slower upstream server to refresh "
+                                       "its smoothed RTT.",
+                                       DoubleValue (0.05),
+                                       MakeDoubleAccessor (&BindServer::m_probeProbability),
+                                       MakeDoubleChecker<double> (0, 1))
+                        .AddAttribute ("EnableHedging",
+                                       "Send a pending upstream query to a second replica of the zone if no "
+                                       "answer arrived after the hedge delay. The first answer is used.",
+                                       BooleanValue (false),
+                                       MakeBooleanAccessor (&BindServer::m_enableHedging),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("HedgeDelayFactor",
+                                       "The hedge delay is this multiple of the smoothed RTT of the first server.",
+                                       DoubleValue (1.5),
+                                       MakeDoubleAccessor (&BindServer::m_hedgeDelayFactor),
+                                       MakeDoubleChecker<double> (0))
+                        .AddAttribute ("MinHedgeDelay",
+                                       "Lower bound of the hedge delay.",
+                                       TimeValue (MilliSeconds (5)),
+                                       MakeTimeAccessor (&BindServer::m_minHedgeDelay),
+                                       MakeTimeChecker ())
+                        .AddAttribute ("HedgeTopNames",
+                                       "Number of most queried names that are hedged without delay (0: none).",
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_hedgeTopNames),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("HedgedQueries",
+                                       "Number of upstream queries duplicated to a second server.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_hedgedQueries),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("HedgeWins",
+                                       "Number of hedged queries answered first by the second server.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_hedgeWins),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("EnableProcessingModel",
+                                       "Serve messages through a bounded input queue and a pool of simulated "
+                                       "workers with a service time per message, instead of instantly.",
+                                       BooleanValue (false),
+                                       MakeBooleanAccessor (&BindServer::m_enableProcessingModel),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("WorkerThreads",
+                                       "Number of simulated workers serving the input queue.",
+                                       UintegerValue (1),
+                                       MakeUintegerAccessor (&BindServer::m_workerCount),
+                                       MakeUintegerChecker<uint32_t> (1))
+                        .AddAttribute ("MaxQueueLength",
+                                       "Maximum number of messages waiting for a worker.",
+                                       UintegerValue (1024),
+                                       MakeUintegerAccessor (&BindServer::m_maxQueueLength),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("QueueOverflowAction",
+                                       "What happens to a message that finds the input queue full.",
+                                       EnumValue (BindServer::OVERFLOW_DROP),
+                                       MakeEnumAccessor (&BindServer::m_overflowAction),
+                                       MakeEnumChecker (BindServer::OVERFLOW_DROP, "Drop",
+                                                        BindServer::OVERFLOW_SERVFAIL, "ServFail"))
+                        .AddAttribute ("CacheHitServiceTime",
+                                       "Service time of a query answered from the record or packet cache, "
+                                       "or rejected without a lookup.",
+                                       TimeValue (MicroSeconds (20)),
+                                       MakeTimeAccessor (&BindServer::m_cacheHitServiceTime),
+                                       MakeTimeChecker ())
+                        .AddAttribute ("CacheMissServiceTime",
+                                       "Service time of a query that starts a resolution or whose response is "
+                                       "built from the zone data.",
+                                       TimeValue (MicroSeconds (100)),
+                                       MakeTimeAccessor (&BindServer::m_cacheMissServiceTime),
+                                       MakeTimeChecker ())
+                        .AddAttribute ("ResponseServiceTime",
+                                       "Service time of an upstream response received by the Local server.",
+                                       TimeValue (MicroSeconds (50)),
+                                       MakeTimeAccessor (&BindServer::m_responseServiceTime),
+                                       MakeTimeChecker ())
+                        .AddTraceSource ("QueueLength",
+                                         "Number of messages waiting in the input queue.",
+                                         MakeTraceSourceAccessor (&BindServer::m_queueLength),
+                                         "ns3::TracedValueCallback::Uint32")
+                        .AddTraceSource ("QueueSojourn",
+                                         "Time a message spent in the server, from its arrival in the input "
+                                         "queue to the end of its service.",
+                                         MakeTraceSourceAccessor (&BindServer::m_sojournTrace),
+                                         "ns3::Time::TracedCallback")
+                        .AddTraceSource ("QueueDrop",
+                                         "A message that found the input queue full.",
+                                         MakeTraceSourceAccessor (&BindServer::m_queueDropTrace),
+                                         "ns3::Packet::AddressTracedCallback")
+                        .AddAttribute ("EventTraceSize",
+                                       "Number of events kept in the binary event trace of the server "
+                                       "(0: disabled). Only used when the module is configured with "
+                                       "--enable-dns-event-trace; see WriteEventTrace.",
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_eventTraceSize),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("Queries",
+                                       "Number of questions received in client queries.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_queries),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("CacheHits",
+                                       "Number of questions answered from the record cache (Local server) "
+                                       "or the packet cache (other roles).",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_cacheHitCount),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("CacheMisses",
+                                       "Number of questions that missed the record cache (Local server) "
+                                       "or the packet cache (other roles).",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_cacheMissCount),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("UpstreamQueries",
+                                       "Number of queries sent to upstream servers, including retransmissions "
+                                       "and hedged queries.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_upstreamQueries),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("Replies",
+                                       "Number of replies sent to clients.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_replies),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("UnmatchedResponses",
+                                       "Number of upstream responses dropped because they matched no "
+                                       "pending resolution.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_unmatchedResponses),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("QueueDrops",
+                                       "Number of messages that found the input queue full.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_queueDrops),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("CacheEvictions",
+                                       "Number of records removed from the cache because their TTL expired.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_cacheEvictions),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("CacheMemory",
+                                       "Bytes taken by the records of the cache (the zone data of the "
+                                       "authoritative roles).",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::GetCacheMemory),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("CacheMemoryPeak",
+                                       "Largest CacheMemory so far.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::GetCacheMemoryPeak),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("DelegationCacheMemory",
+                                       "Bytes taken by the NS records and glue learned from referrals.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::GetDelegationCacheMemory),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("DelegationCacheMemoryPeak",
+                                       "Largest DelegationCacheMemory so far.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::GetDelegationCacheMemoryPeak),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("PendingQueryMemory",
+                                       "Bytes taken by the table of pending resolutions (Local server).",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::GetPendingQueryMemory),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("HeaderMemory",
+                                       "Bytes taken by the parsed message headers kept for the next batches.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::GetHeaderMemory),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("HeaderMemoryPeak",
+                                       "Largest memory taken by one message header parsed or built by the server.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&BindServer::m_headerMemoryPeak),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddTraceSource ("Query",
+                                         "A question of a client query was received.",
+                                         MakeTraceSourceAccessor (&BindServer::m_queryTrace),
+                                         "ns3::BindServer::QuestionTracedCallback")
+                        .AddTraceSource ("CacheHit",
+                                         "A question was answered from the record or packet cache.",
+                                         MakeTraceSourceAccessor (&BindServer::m_cacheHitTrace),
+                                         "ns3::BindServer::NameTracedCallback")
+                        .AddTraceSource ("CacheMiss",
+                                         "A question missed the record or packet cache.",
+                                         MakeTraceSourceAccessor (&BindServer::m_cacheMissTrace),
+                                         "ns3::BindServer::NameTracedCallback")
+                        .AddTraceSource ("UpstreamQuery",
+                                         "A query was sent to an upstream server.",
+                                         MakeTraceSourceAccessor (&BindServer::m_upstreamTrace),
+                                         "ns3::BindServer::UpstreamTracedCallback")
+                        .AddTraceSource ("Reply",
+                                         "A reply was sent to a client.",
+                                         MakeTraceSourceAccessor (&BindServer::m_replyTrace),
+                                         "ns3::Packet::AddressTracedCallback")
+                        .AddTraceSource ("Resolution",
+                                         "A resolution of the Local server finished. Reports the number of "
+                                         "upstream queries it took.",
+                                         MakeTraceSourceAccessor (&BindServer::m_resolutionTrace),
+                                         "ns3::BindServer::ResolutionTracedCallback")
+                        .AddTraceSource ("PendingQueries",
+                                         "Number of resolutions in progress.",
+                                         MakeTraceSourceAccessor (&BindServer::m_pendingSize),
+                                         "ns3::TracedValueCallback::Uint32")
+                        .AddTraceSource ("CacheSize",
+                                         "Number of records in the cache.",
+                                         MakeTraceSourceAccessor (&BindServer::m_cacheSize),
+                                         "ns3::TracedValueCallback::Uint32")
+                        .AddTraceSource ("CacheEviction",
+                                         "A record expired from the cache.",
+                                         MakeTraceSourceAccessor (&BindServer::m_evictionTrace),
+                                         "ns3::BindServer::QuestionTracedCallback");
   return tid;
 }
 
@@ -63,6 +378,28 @@ BindServer::BindServer (void)
   m_localAddress = Ipv4Address ();
   m_netMask = Ipv4Mask ();
   m_socket = 0;
+  m_tcpSocket = 0;
+  m_holdOutput = false;
+  m_messageTagged = false;
+  m_service = 0;
+  m_nextTransactionId = 0;
+  m_nextRequestId = 1;
+  m_cacheMisses = 0;
+  m_queries = 0;
+  m_cacheHitCount = 0;
+  m_cacheMissCount = 0;
+  m_upstreamQueries = 0;
+  m_replies = 0;
+  m_unmatchedResponses = 0;
+  m_queueDrops = 0;
+  m_cacheEvictions = 0;
+  m_headerMemoryPeak = 0;
+  m_hedgedQueries = 0;
+  m_hedgeWins = 0;
+#ifdef DNS_EVENT_TRACE
+  m_nsCache.SetEventTrace (&m_eventTrace);
+  m_delegationCache.SetEventTrace (&m_eventTrace);
+#endif
   /* cstrctr */
 }
 BindServer::~BindServer ()
@@ -77,12 +414,106 @@ BindServer::AddZone (std::string zone_name, uint32_t TTL, uint16_t ns_class, uin
   m_nsCache.AddZone (zone_name, ns_class, type, TTL, rData);
 }
 
+void
+BindServer::AddRootServer (Ipv4Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  m_rootReplicas.push_back (address);
+}
+
+int64_t
+BindServer::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (stream);
+  m_upstreamSelector.SetRandomVariable (rng);
+  return 1;
+}
+
+void
+BindServer::WriteEventTrace (std::ostream& os) const
+{
+  NS_LOG_FUNCTION (this);
+#ifdef DNS_EVENT_TRACE
+  m_eventTrace.Write (os, GetNode ()->GetId (), m_serverType);
+#else
+  NS_LOG_WARN ("The module is configured without --enable-dns-event-trace. Nothing is written.");
+  NS_UNUSED (os);
+#endif
+}
+
+static void
+WriteMemoryLine (std::ostream& os, const std::string& name, uint64_t items, uint64_t bytes, uint64_t peak)
+{
+  os << std::left << std::setw (24) << name << std::right << std::setw (10) << items << std::setw (12) << bytes
+     << std::setw (12) << peak << std::setw (12) << std::fixed << std::setprecision (1)
+     << (items == 0 ? 0.0 : double (bytes) / items) << std::endl;
+}
+
+void
+BindServer::WriteMemoryReport (std::ostream& os) const
+{
+  NS_LOG_FUNCTION (this);
+
+  os << "Memory of node " << GetNode ()->GetId () << " (role " << uint32_t (m_serverType) << ")" << std::endl;
+  os << std::left << std::setw (24) << "" << std::right << std::setw (10) << "items" << std::setw (12) << "bytes"
+     << std::setw (12) << "peak" << std::setw (12) << "bytes/item" << std::endl;
+  WriteMemoryLine (os, "cache", m_nsCache.GetSize (), GetCacheMemory (), GetCacheMemoryPeak ());
+  WriteMemoryLine (os,
+                   "delegation cache",
+                   m_delegationCache.GetSize (),
+                   GetDelegationCacheMemory (),
+                   GetDelegationCacheMemoryPeak ());
+  // Released entries keep their buffers, so the table never shrinks
+  WriteMemoryLine (os,
+                   "pending queries",
+                   m_pendingQueries.GetCapacity (),
+                   GetPendingQueryMemory (),
+                   GetPendingQueryMemory ());
+  WriteMemoryLine (os, "batch headers", m_batchHeaders.size (), GetHeaderMemory (), GetHeaderMemory ());
+  os << std::left << std::setw (24) << "largest header" << std::right << std::setw (22) << m_headerMemoryPeak
+     << std::endl;
+
+  uint64_t copies = m_nsCache.GetOutstandingCopies () + m_delegationCache.GetOutstandingCopies ();
+  // The record copies of the last zone lookup are kept until the next one
+  if (copies > m_lookupScratch.size ())
+  {
+    os << "record copies not released: " << copies - m_lookupScratch.size () << std::endl;
+  }
+}
+
+uint64_t
+BindServer::GetQueries (uint16_t qType) const
+{
+  QueryTypeCountersCI it = m_queriesByType.find (qType);
+  return it == m_queriesByType.end () ? 0 : it->second;
+}
+
 void
 BindServer::StartApplication (void)
 {
   NS_LOG_FUNCTION (this);
   // Start expiration of the DNS records after TTL values.
   m_nsCache.SynchronizeTTL ();
+  m_nsCache.SetEvictionCallback (MakeCallback (&BindServer::HandleCacheEviction, this));
+  m_cacheSize = m_nsCache.GetSize ();
+#ifdef DNS_EVENT_TRACE
+  m_eventTrace.SetCapacity (m_eventTraceSize);
+#endif
+  BindService ();
+
+  if (m_serverType == LOCAL_SERVER)
+  {
+    m_pendingQueries.SetCapacity (m_maxPendingQueries);
+    m_upstreamSelector.SetDecay (m_srttDecay);
+    m_upstreamSelector.SetProbeProbability (m_probeProbability);
+  }
+  if (m_enableProcessingModel)
+  {
+    m_workers.assign (m_workerCount, Worker ());
+    m_queueLength = 0;
+  }
 
   if (m_socket == 0)
   {
@@ -92,6 +523,15 @@ BindServer::StartApplication (void)
     m_socket->Bind (local);
   }
   m_socket->SetRecvCallback (MakeCallback (&BindServer::HandleQuery, this));
+
+  if (m_enableTcp && m_tcpSocket == 0)
+  {
+    m_tcpSocket = Socket::CreateSocket (GetNode (), TcpSocketFactory::GetTypeId ());
+    m_tcpSocket->Bind (InetSocketAddress (m_localAddress, DNS_PORT));
+    m_tcpSocket->Listen ();
+    m_tcpSocket->SetAcceptCallback (MakeCallback (&BindServer::HandleTcpConnectionRequest, this),
+                                    MakeCallback (&BindServer::HandleTcpAccept, this));
+  }
 }
 
 void
@@ -104,6 +544,16 @@ BindServer::StopApplication ()
     m_socket->Close ();
     m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
   }
+  if (m_tcpSocket != 0)
+  {
+    m_tcpSocket->Close ();
+    m_tcpSocket->SetAcceptCallback (MakeNullCallback<bool, Ptr<Socket>, const Address &> (),
+                                    MakeNullCallback<void, Ptr<Socket>, const Address &> ());
+  }
+  while (!m_tcpConnections.empty ())
+  {
+    CloseTcpConnection (m_tcpConnections.begin ()->first);
+  }
   DoDispose ();
 }
 
@@ -114,694 +564,1840 @@ BindServer::HandleQuery (Ptr<Socket> socket)
 
   Ptr<Packet> message;
   Address from;
+  std::size_t drained;
 
-  while ((message = socket->RecvFrom (from)))
+  // Drain the socket in batches of at most m_maxBatchSize datagrams so the
+  // per-message bookkeeping is paid once per batch instead of once per query.
+  do
   {
-    if (InetSocketAddress::IsMatchingType (from))
+    m_batch.clear ();
+    while (m_batch.size () < m_maxBatchSize && (message = socket->RecvFrom (from)))
     {
-      // TODO
-      // NS_LOG_INFO ()
+      m_batch.push_back (std::make_pair (message, from));
     }
+    drained = m_batch.size ();
+    ProcessBatch ();
+  } while (drained == m_maxBatchSize);
+}
 
-    message->RemoveAllPacketTags ();
-    message->RemoveAllByteTags ();
+// Process the messages collected in m_batch in three passes: parse every
+// message, serve them all while holding back the outgoing packets, then
+// emit the held packets. The header objects are recycled between batches.
+void
+BindServer::ProcessBatch (void)
+{
+  NS_LOG_FUNCTION (this << m_batch.size ());
 
-    if (m_serverType == LOCAL_SERVER)
-    {
-      LocalServerService (message, from);
-    }
-    else if (m_serverType == ROOT_SERVER)
-    {
-      RootServerService (message, from);
-    }
-    else if (m_serverType == TLD_SERVER)
-    {
-      TLDServerService (message, from);
-    }
-    else if (m_serverType == ISP_SERVER)
+  if (m_batch.empty ())
+  {
+    return;
+  }
+  if (m_enableProcessingModel)
+  {
+    for (std::size_t n = 0; n < m_batch.size (); n++)
     {
-      ISPServerService (message, from);
+      EnqueueMessage (m_batch[n].first, m_batch[n].second);
     }
-    else if (m_serverType == AUTH_SERVER)
+    m_batch.clear ();
+    StartService ();
+    return;
+  }
+  if (m_batchHeaders.size () < m_batch.size ())
+  {
+    m_batchHeaders.resize (m_batch.size ());
+  }
+
+  for (std::size_t n = 0; n < m_batch.size (); n++)
+  {
+    m_batch[n].first->RemoveHeader (m_batchHeaders[n]);
+    CountHeaderMemory (m_batchHeaders[n]);
+  }
+
+  m_holdOutput = true;
+  for (std::size_t n = 0; n < m_batch.size (); n++)
+  {
+    TakeResolutionTag (m_batch[n].first, Simulator::Now ());
+    DispatchMessage (m_batchHeaders[n], m_batch[n].second);
+  }
+  m_holdOutput = false;
+  m_messageTagged = false;
+
+  EmitOutput (m_outputQueue);
+  m_batch.clear ();
+}
+
+void
+BindServer::EmitOutput (OutputQueue& output)
+{
+  for (OutputQueueI it = output.begin (); it != output.end (); it++)
+  {
+    if (it->isReply)
     {
-      AuthServerService (message, from);
+      DoReplyQuery (it->packet, it->toAddress);
     }
     else
     {
-      NS_ABORT_MSG ("Name server should have a type. Hint: Set NameserverType. Aborting");
+      DoSendQuery (it->packet, it->toAddress, it->transport);
     }
   }
+  output.clear ();
 }
 
 void
-BindServer::LocalServerService (Ptr<Packet> nsQuery, Address toAddress)
+BindServer::EnqueueMessage (Ptr<Packet> message, Address from)
 {
-  NS_LOG_FUNCTION (this);
-
-  DNSHeader DnsHeader;
-  // uint16_t qType, qClass;
-  std::string qName;
-  bool foundInCache = false;
-  bool nsQuestion = false;
+  NS_LOG_FUNCTION (this << message << from);
 
-  nsQuery->RemoveHeader (DnsHeader);
-
-  if ((nsQuestion = DnsHeader.GetQRbit ()))  // if NS query
+  if (m_inputQueue.size () >= m_maxQueueLength)
   {
-    // retrieve the question list
-    std::list<QuestionSectionHeader> questionList;
-    questionList = DnsHeader.GetQuestionList ();
-
-    // Although the header supports multiple questions at a time
-    // the local DNS server is not yet implemented to resolve multiple questions at a time.
-    // We assume that clients generate separate DNS messages for each
-    // host that they wanted to resolve.
-
-    // NOTE
-    // We assumed that the local DNS does the recursive resolution process (i.e., in CDN networks)
-
-    qName = questionList.begin ()->GetqName ();
-    // qType = questionList.begin ()->GetqType ();
-    // qClass = questionList.begin ()->GetqClass ();
-
-    SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordHas (qName, foundInCache);
-
-    // // Find the query in the nameserver cache
-    // SRVTable::SRVRecordInstance instance;
-    // foundInCache = m_nsCache.FindRecordsFor (qName, instance);
+    NS_LOG_INFO ("Input queue full. Rejecting the message.");
+    m_queueDrops++;
+    m_queueDropTrace (message, from);
 
-    if (foundInCache)
+    if (m_overflowAction == OVERFLOW_SERVFAIL)
     {
-      NS_LOG_INFO ("Found a record in the local cache. Replying..");
-
-      // Local Server always returns the server address according to the RR manner.
-      Ptr<Packet> dnsResponse = Create<Packet> ();
-
-      ResourceRecordHeader answer;
-      answer.SetName (cachedRecord->first->GetRecordName ());
-      answer.SetClass (cachedRecord->first->GetClass ());
-      answer.SetType (cachedRecord->first->GetType ());
-      answer.SetTimeToLive (25);  //cachedRecord->first->GetTTL ());
-      answer.SetRData (cachedRecord->first->GetRData ());
-
-      DnsHeader.AddAnswer (answer);
-
-      DnsHeader.SetRAbit (1);
-
-      dnsResponse->AddHeader (DnsHeader);
-
-      // Add the DNS header to the response packet and send it to the client
-      dnsResponse->AddHeader (DnsHeader);
-      ReplyQuery (dnsResponse, toAddress);
-
-      // Toggle servers
-      m_nsCache.SwitchServersRoundRobin ();
-
-      return;
-    }  // end of query is found in cache
-    else if (!foundInCache && (m_raType == RA_AVAILABLE))
-    {
-      NS_LOG_INFO ("Initiate recursive resolution.");
-
-      Ptr<Packet> requestRR = Create<Packet> ();
-
-      std::string tld;
-      std::string::size_type found = 0;
-      bool foundTLDinCache = false;
-
-      // find the TLD of the query
-      found = qName.find_last_of ('.');
-      tld = qName.substr (found);
-
-      // Find the TLD in the nameserver cache
-      SRVTable::SRVRecordI cachedTLDRecord = m_nsCache.FindARecord (tld, foundTLDinCache);
-
-      requestRR->AddHeader (DnsHeader);
-
-      NS_LOG_INFO ("Add the recursive request in to the list");
-      m_recursiveQueryList[qName] = toAddress;
-
-      if (foundTLDinCache)
-      {
-        // Send to the TLD server
-        SendQuery (requestRR, InetSocketAddress (Ipv4Address (cachedTLDRecord->first->GetRData ().c_str ()), DNS_PORT));
-      }
-      else
+      DNSHeader DnsHeader;
+      message->RemoveHeader (DnsHeader);
+      if (DnsHeader.GetQRbit ())  // only queries are answered
       {
-        // Send to the reqiest to the Root server
-        SendQuery (requestRR, InetSocketAddress (m_rootAddress, DNS_PORT));
+        DnsHeader.SetQRbit (0);
+        DnsHeader.SetRAbit (m_raType == RA_AVAILABLE);
+        DnsHeader.SetRcode (2);
+        Ptr<Packet> reply = Create<Packet> ();
+        reply->AddHeader (DnsHeader);
+        ReplyQuery (reply, from);
       }
-      return;
-    }   // end of not found in cache and recursive resolution
-  }     // end of the NS query
-  else  // // NS response !rHeader.GetQRbit ()
-  {
-    NS_LOG_INFO ("Handle the NS responses from recursive name servers");
-
-    // NOTE
-    // In this implementation, the remaining bits of the OPCODE are used to specify the reply types.
-    // 3 for the replies from a ROOT server
-    // 4 for the replies from a TLD server
-    // 5 for the replies from a ISP's name server
-    // 6 fro the replies from a Authoritative name server (in this case the AA bit is also considered)
-
-    // All answers are append to the DNS header.
-    // However, only the relevant answer is taken according to the OPCODE value.
-    // Furthermore, we implemented the servers to add the resource record to the top of the answer section.
-
-    std::string forwardingAddress;
+    }
+    return;
+  }
 
-    // retrieve the Answer list
-    std::list<ResourceRecordHeader> answerList;
-    answerList = DnsHeader.GetAnswerList ();
+  QueuedMessage queued;
+  queued.packet = message;
+  queued.from = from;
+  queued.arrival = Simulator::Now ();
+  m_inputQueue.push_back (queued);
+  m_queueLength = m_inputQueue.size ();
+}
 
-    // Always use the most recent answer, so that the previous server is considered.
-    // However, the answer list contains all answers recursive name servers added.
-    qName = answerList.begin ()->GetName ();
-    // qType = answerList.begin ()->GetType ();
-    // qClass = answerList.begin ()->GetClass ();
-    forwardingAddress = answerList.begin ()->GetRData ();
+// Hand queued messages to the idle workers. A message is served when it
+// reaches a worker; what it sends is held until its service time has passed.
+void
+BindServer::StartService (void)
+{
+  NS_LOG_FUNCTION (this);
 
-    if (DnsHeader.GetOpcode () == 3)  // reply from the root server about a TLD server
+  for (uint32_t n = 0; n < m_workers.size () && !m_inputQueue.empty (); n++)
+  {
+    Worker& worker = m_workers[n];
+    if (worker.completion.IsRunning ())
     {
-      NS_LOG_INFO ("Add the TLD record in to the server cache");
-
-      std::string tld;
-      std::string::size_type foundAt = 0;
-      foundAt = qName.find_last_of ('.');
-      tld = qName.substr (foundAt);
+      continue;
+    }
 
-      // add the record about TLD to the Local name server cache
-      m_nsCache.AddRecord (tld,
-                           answerList.begin ()->GetClass (),
-                           answerList.begin ()->GetType (),
-                           answerList.begin ()->GetTimeToLive (),
-                           answerList.begin ()->GetRData ());
+    QueuedMessage queued = m_inputQueue.front ();
+    m_inputQueue.pop_front ();
+    m_queueLength = m_inputQueue.size ();
 
-      // create a packet to send to TLD
-      Ptr<Packet> sendToTLD = Create<Packet> ();
+    DNSHeader DnsHeader;
+    queued.packet->RemoveHeader (DnsHeader);
+    bool upstreamResponse = m_serverType == LOCAL_SERVER && !DnsHeader.GetQRbit ();
 
-      DnsHeader.ResetOpcode ();
-      DnsHeader.SetOpcode (0);
-      DnsHeader.SetQRbit (1);
-      sendToTLD->AddHeader (DnsHeader);
+    m_cacheMisses = 0;
+    m_holdOutput = true;
+    TakeResolutionTag (queued.packet, queued.arrival);
+    DispatchMessage (DnsHeader, queued.from);
+    m_holdOutput = false;
+    m_messageTagged = false;
 
-      SendQuery (sendToTLD, InetSocketAddress (Ipv4Address (forwardingAddress.c_str ()), DNS_PORT));
-    }
-    else if (DnsHeader.GetOpcode () == 4)
+    Time serviceTime = m_cacheHitServiceTime;
+    if (upstreamResponse)
     {
-      Ptr<Packet> sendToISP = Create<Packet> ();
-
-      DnsHeader.ResetOpcode ();
-      DnsHeader.SetOpcode (0);
-      DnsHeader.SetQRbit (1);
-      sendToISP->AddHeader (DnsHeader);
-
-      SendQuery (sendToISP, InetSocketAddress (Ipv4Address (forwardingAddress.c_str ()), DNS_PORT));
-      NS_LOG_INFO ("Contact ISP name server");
+      serviceTime = m_responseServiceTime;
     }
-    else if (DnsHeader.GetOpcode () == 5)
+    else if (m_cacheMisses > 0)
     {
-      // If the ISP's name server says that it has the authoritative records,
-      // cache it and pass it to the user.
-      if (DnsHeader.GetAAbit ())
-      {
-        NS_LOG_INFO ("Add the Auth records in to the server cache");
-
-        std::list<ResourceRecordHeader> answerList;
-        answerList = DnsHeader.GetAnswerList ();
-
-        // Store all answers, i.e., server records, to the Local DNS cache
-        for (std::list<ResourceRecordHeader>::iterator iter = answerList.begin ();
-             iter != answerList.end ();
-             iter++)
-        {
-          m_nsCache.AddRecord (iter->GetName (),
-                               iter->GetClass (),
-                               iter->GetType (),
-                               /*iter->GetTimeToLive ()*/ 40,
-                               iter->GetRData ());
-        }
-        // Clear the existing answer list
-        DnsHeader.ClearAnswers ();
-
-        // Get the recent query from the cache.
-        // TODO: This approach can be optimized
-        bool foundInCache = false;
-        SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordHas (qName, foundInCache);
+      serviceTime = m_cacheMissServiceTime;
+    }
 
-        // Create the Answer and reply it back to the client
+    worker.output.swap (m_outputQueue);
+    worker.arrival = queued.arrival;
+    worker.completion = Simulator::Schedule (serviceTime, &BindServer::FinishService, this, n);
+  }
+}
 
-        ResourceRecordHeader answer;
+void
+BindServer::FinishService (uint32_t worker)
+{
+  NS_LOG_FUNCTION (this << worker);
 
-        answer.SetName (cachedRecord->first->GetRecordName ());
-        answer.SetClass (cachedRecord->first->GetClass ());
-        answer.SetType (cachedRecord->first->GetType ());
-        answer.SetTimeToLive (25);  //(cachedRecord->first->GetTTL ());		// bypassed for testing purposes
-        answer.SetRData (cachedRecord->first->GetRData ());
+  EmitOutput (m_workers[worker].output);
+  m_sojournTrace (Simulator::Now () - m_workers[worker].arrival);
+  StartService ();
+}
 
-        DnsHeader.AddAnswer (answer);
+#ifdef DNS_EVENT_TRACE
+// The IPv4 address of a peer, as recorded in the event trace
+static uint32_t
+TraceAddress (const Address& address)
+{
+  return InetSocketAddress::IsMatchingType (address) ? InetSocketAddress::ConvertFrom (address).GetIpv4 ().Get () : 0;
+}
 
-        // create a packet to send to TLD
-        Ptr<Packet> replyToClient = Create<Packet> ();
+// Message sizes are recorded in 16 bits
+static uint16_t
+TraceSize (Ptr<const Packet> packet)
+{
+  return std::min<uint32_t> (packet->GetSize (), 0xffff);
+}
 
-        DnsHeader.ResetOpcode ();
-        DnsHeader.SetOpcode (0);
-        DnsHeader.SetQRbit (0);
-        DnsHeader.SetAAbit (1);
-        replyToClient->AddHeader (DnsHeader);
+// The transaction ID of an encoded message, read without decoding it
+static uint16_t
+TraceTransactionId (Ptr<const Packet> packet)
+{
+  uint8_t id[2] = {0, 0};
+  packet->CopyData (id, 2);
+  return (id[0] << 8) | id[1];
+}
 
-        // Find the actual client query that stores in recursive list
-        std::list<QuestionSectionHeader> questionList;
-        questionList = DnsHeader.GetQuestionList ();
-        qName = questionList.begin ()->GetqName ();
+// The first question of a message, as recorded in the event trace
+static uint32_t
+TraceQuestionName (const DNSHeader& header)
+{
+  return header.GetQdCount () == 0 ? 0 : DnsEventTrace::Hash (header.GetQuestionList ().front ().GetqName ());
+}
 
-        ReplyQuery (replyToClient, m_recursiveQueryList.find (qName)->second);
+static uint16_t
+TraceQuestionType (const DNSHeader& header)
+{
+  return header.GetQdCount () == 0 ? 0 : header.GetQuestionList ().front ().GetqType ();
+}
+#endif
 
-        m_recursiveQueryList.erase (qName);
-        m_nsCache.SwitchServersRoundRobin ();
-      }
-      else
-      {
-        Ptr<Packet> sendToAUTH = Create<Packet> ();
+void
+BindServer::DispatchMessage (DNSHeader& DnsHeader, Address from)
+{
+  NS_LOG_FUNCTION (this);
 
-        DnsHeader.ResetOpcode ();
-        DnsHeader.SetOpcode (0);
-        DnsHeader.SetQRbit (1);
-        sendToAUTH->AddHeader (DnsHeader);
+  DNS_TRACE_EVENT (&m_eventTrace,
+                   DnsTraceEvent::RECEIVE,
+                   TraceQuestionName (DnsHeader),
+                   TraceQuestionType (DnsHeader),
+                   TraceAddress (from),
+                   DnsHeader.GetId (),
+                   0,
+                   DnsHeader.GetQRbit ());
 
-        SendQuery (sendToAUTH, InetSocketAddress (Ipv4Address (forwardingAddress.c_str ()), DNS_PORT));
-        NS_LOG_INFO ("Contact Authoritative name server");
-      }
-    }
-    else if (DnsHeader.GetOpcode () == 6)
+  if (DnsHeader.GetQRbit ())
+  {
+    const std::list<QuestionSectionHeader>& questionList = DnsHeader.GetQuestionList ();
+    for (std::list<QuestionSectionHeader>::const_iterator it = questionList.begin (); it != questionList.end (); it++)
     {
-      NS_LOG_INFO ("Add the Auth records in to the server cache");
-
-      std::list<ResourceRecordHeader> answerList;
-      answerList = DnsHeader.GetAnswerList ();
-
-      // Store all answers, i.e., server records, to the Local DNS cache
-      for (std::list<ResourceRecordHeader>::iterator iter = answerList.begin ();
-           iter != answerList.end ();
-           iter++)
-      {
-        m_nsCache.AddRecord (iter->GetName (),
-                             iter->GetClass (),
-                             iter->GetType (),
-                             iter->GetTimeToLive () /* 40 */,
-                             iter->GetRData ());
-      }
-      // Clear the existing answer list
-      DnsHeader.ClearAnswers ();
-
-      // Get the recent query from the cache.
-      // TODO: This approach can be optimized
-      bool foundInCache = false;
-      SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordHas (qName, foundInCache);
+      m_queries++;
+      m_queriesByType[it->GetqType ()]++;
+      m_queryTrace (it->GetqName (), it->GetqType ());
+    }
+  }
+  (this->*m_service) (DnsHeader, from);
+}
 
-      // Create the Answer and reply it back to the client
+// Bind the service of the configured role. Done once, so that serving a
+// message does not depend on the server type.
+void
+BindServer::BindService (void)
+{
+  if (m_serverType == LOCAL_SERVER)
+  {
+    m_service = &BindServer::LocalServerService;
+  }
+  else if (m_serverType == ROOT_SERVER)
+  {
+    // Root name servers never create any NS requests.
+    m_service = &BindServer::ZoneServerService<RootServer>;
+  }
+  else if (m_serverType == TLD_SERVER)
+  {
+    m_service = &BindServer::ZoneServerService<TldServer>;
+  }
+  else if (m_serverType == ISP_SERVER)
+  {
+    // If the query exactly matches a record in the ISP cache, the record is
+    // treated as an Authoritative record for the client. Otherwise the ISP
+    // name server refers the client to the Authoritative name servers for
+    // the requested name.
+    m_service = &BindServer::ZoneServerService<IspServer>;
+  }
+  else if (m_serverType == AUTH_SERVER)
+  {
+    m_service = &BindServer::ZoneServerService<AuthServer>;
+  }
+  else
+  {
+    NS_ABORT_MSG ("Name server should have a type. Hint: Set NameserverType. Aborting");
+  }
+}
 
-      ResourceRecordHeader answer;
+bool
+BindServer::HandleTcpConnectionRequest (Ptr<Socket> socket, const Address& /* from */)
+{
+  NS_LOG_FUNCTION (this << socket);
+  return true;
+}
 
-      answer.SetName (cachedRecord->first->GetRecordName ());
-      answer.SetClass (cachedRecord->first->GetClass ());
-      answer.SetType (cachedRecord->first->GetType ());
-      answer.SetTimeToLive (25);  // (cachedRecord->first->GetTTL ());  // bypassed for testing purposes
-      answer.SetRData (cachedRecord->first->GetRData ());
+void
+BindServer::HandleTcpAccept (Ptr<Socket> socket, const Address& from)
+{
+  NS_LOG_FUNCTION (this << socket);
 
-      DnsHeader.AddAnswer (answer);
+  TcpConnection connection;
+  connection.peer = from;
+  connection.rxBuffer = Create<Packet> ();
+  connection.connected = true;
+  m_tcpConnections[socket] = connection;
+  m_tcpPeers[from] = socket;
+
+  socket->SetRecvCallback (MakeCallback (&BindServer::HandleTcpRead, this));
+  socket->SetSendCallback (MakeCallback (&BindServer::HandleTcpSend, this));
+  socket->SetCloseCallbacks (MakeCallback (&BindServer::HandleTcpClose, this),
+                             MakeCallback (&BindServer::HandleTcpClose, this));
+}
 
-      // create a packet to send to TLD
-      Ptr<Packet> replyToClient = Create<Packet> ();
+void
+BindServer::HandleTcpRead (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
 
-      DnsHeader.ResetOpcode ();
-      DnsHeader.SetOpcode (0);
-      DnsHeader.SetQRbit (0);
-      DnsHeader.SetAAbit (1);
-      replyToClient->AddHeader (DnsHeader);
+  TcpConnectionI connection = m_tcpConnections.find (socket);
+  if (connection == m_tcpConnections.end ())
+  {
+    return;
+  }
 
-      // Find the actual client query that stores in recursive list
-      std::list<QuestionSectionHeader> questionList;
-      questionList = DnsHeader.GetQuestionList ();
-      qName = questionList.begin ()->GetqName ();
+  Ptr<Packet> segment;
+  Address from;
+  while ((segment = socket->RecvFrom (from)))
+  {
+    if (segment->GetSize () == 0)
+    {
+      break;
+    }
+    connection->second.rxBuffer->AddAtEnd (segment);
+  }
 
-      ReplyQuery (replyToClient, m_recursiveQueryList.find (qName)->second);
+  // A stream read may end in the middle of a message or carry several
+  // pipelined ones. Serve every complete message as one batch and keep the rest.
+  Ptr<Packet> rxBuffer = connection->second.rxBuffer;
+  Address peer = connection->second.peer;
+  m_batch.clear ();
+  while (rxBuffer->GetSize () >= 2)
+  {
+    uint8_t lengthField[2];
+    rxBuffer->CopyData (lengthField, 2);
+    uint16_t messageLength = (lengthField[0] << 8) | lengthField[1];
 
-      m_recursiveQueryList.erase (qName);
-      m_nsCache.SwitchServersRoundRobin ();
-    }
-    else
+    if (rxBuffer->GetSize () < 2u + messageLength)
     {
-      // TODO
-      // Abort with a error message
+      break;
     }
+    Ptr<Packet> message = rxBuffer->CreateFragment (2, messageLength);
+    rxBuffer->RemoveAtStart (2 + messageLength);
 
-  }  // end of ns response
+    m_batch.push_back (std::make_pair (message, peer));
+  }
+  ProcessBatch ();
 }
 
 void
-BindServer::RootServerService (Ptr<Packet> nsQuery, Address toAddress)
+BindServer::HandleTcpSend (Ptr<Socket> socket, uint32_t available)
 {
-  // Assumptions made to Create the ROOT name server
-  // Root name servers never create any NS requests.
-
-  DNSHeader DnsHeader;
-  // uint16_t qType, qClass;
-  std::string qName;
-  bool foundInCache = false;
-
-  nsQuery->RemoveHeader (DnsHeader);
-
-  // Assume that only one question is attached to the DNS header
-  std::list<QuestionSectionHeader> questionList;
-  questionList = DnsHeader.GetQuestionList ();
-
-  qName = questionList.begin ()->GetqName ();
-  // qType = questionList.begin ()->GetqType ();
-  // qClass = questionList.begin ()->GetqClass ();
-
-  // Return the first record that matches the requested qName
-  // This supports the RR method
-  SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordMatches (qName, foundInCache);
-
-  if (foundInCache)
-  {
-    Ptr<Packet> rootResponse = Create<Packet> ();
-
-    ResourceRecordHeader rrHeader;
-
-    rrHeader.SetName (cachedRecord->first->GetRecordName ());
-    rrHeader.SetClass (cachedRecord->first->GetClass ());
-    rrHeader.SetType (cachedRecord->first->GetType ());
-    rrHeader.SetTimeToLive (cachedRecord->first->GetTTL ());
-    rrHeader.SetRData (cachedRecord->first->GetRData ());
+  NS_LOG_FUNCTION (this << socket << available);
+  FlushTcpQueue (socket);
+}
 
-    DnsHeader.SetQRbit (0);
-    DnsHeader.ResetOpcode ();
-    DnsHeader.SetOpcode (3);
-    DnsHeader.AddAnswer (rrHeader);
+void
+BindServer::HandleTcpClose (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+  CloseTcpConnection (socket);
+}
 
-    rootResponse->AddHeader (DnsHeader);
+void
+BindServer::HandleUpstreamConnected (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
 
-    ReplyQuery (rootResponse, toAddress);
-  }
-  else
+  TcpConnectionI connection = m_tcpConnections.find (socket);
+  if (connection != m_tcpConnections.end ())
   {
-    // TODO
-    // Send a reply contains RCODE = 3
+    connection->second.connected = true;
+    FlushTcpQueue (socket);
   }
 }
 
 void
-BindServer::TLDServerService (Ptr<Packet> nsQuery, Address toAddress)
+BindServer::HandleUpstreamConnectionFailed (Ptr<Socket> socket)
 {
-  DNSHeader DnsHeader;
-  // uint16_t qType, qClass;
-  std::string qName;
-  bool foundInCache = false;
+  NS_LOG_FUNCTION (this << socket);
+  NS_LOG_INFO ("Connection to the upstream server failed. Dropping the queued queries.");
+  CloseTcpConnection (socket);
+}
 
-  nsQuery->RemoveHeader (DnsHeader);
+// Return the pooled connection to an upstream server, opening one if needed.
+// Queries sent before the handshake completes are queued on the connection.
+Ptr<Socket>
+BindServer::GetUpstreamConnection (Address upstream)
+{
+  NS_LOG_FUNCTION (this);
 
-  // Assume that only one question is attached to the DNS header
-  std::list<QuestionSectionHeader> questionList;
-  questionList = DnsHeader.GetQuestionList ();
+  TcpSocketMapI pooled = m_upstreamPool.find (upstream);
+  if (pooled != m_upstreamPool.end ())
+  {
+    return pooled->second;
+  }
 
-  qName = questionList.begin ()->GetqName ();
-  // qType = questionList.begin ()->GetqType ();
-  // qClass = questionList.begin ()->GetqClass ();
+  Ptr<Socket> socket = Socket::CreateSocket (GetNode (), TcpSocketFactory::GetTypeId ());
+  socket->Bind ();
+
+  TcpConnection connection;
+  connection.peer = upstream;
+  connection.rxBuffer = Create<Packet> ();
+  connection.connected = false;
+  m_tcpConnections[socket] = connection;
+  m_upstreamPool[upstream] = socket;
+
+  socket->SetConnectCallback (MakeCallback (&BindServer::HandleUpstreamConnected, this),
+                              MakeCallback (&BindServer::HandleUpstreamConnectionFailed, this));
+  socket->SetRecvCallback (MakeCallback (&BindServer::HandleTcpRead, this));
+  socket->SetSendCallback (MakeCallback (&BindServer::HandleTcpSend, this));
+  socket->SetCloseCallbacks (MakeCallback (&BindServer::HandleTcpClose, this),
+                             MakeCallback (&BindServer::HandleTcpClose, this));
+  socket->Connect (upstream);
+
+  return socket;
+}
 
-  // Return the first record that matches the requested qName
-  // This supports the RR method
-  SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordMatches (qName, foundInCache);
+void
+BindServer::SendFramed (Ptr<Socket> socket, Ptr<Packet> message)
+{
+  NS_LOG_FUNCTION (this << socket << message);
 
-  if (foundInCache)
+  TcpConnectionI connection = m_tcpConnections.find (socket);
+  if (connection == m_tcpConnections.end ())
   {
-    Ptr<Packet> tldResponse = Create<Packet> ();
+    return;
+  }
 
-    ResourceRecordHeader rrHeader;
+  uint8_t lengthField[2];
+  lengthField[0] = (message->GetSize () >> 8) & 0xff;
+  lengthField[1] = message->GetSize () & 0xff;
 
-    rrHeader.SetName (cachedRecord->first->GetRecordName ());
-    rrHeader.SetClass (cachedRecord->first->GetClass ());
-    rrHeader.SetType (cachedRecord->first->GetType ());
-    rrHeader.SetTimeToLive (cachedRecord->first->GetTTL ());
-    rrHeader.SetRData (cachedRecord->first->GetRData ());
+  Ptr<Packet> framed = Create<Packet> (lengthField, 2);
+  framed->AddAtEnd (message);
 
-    DnsHeader.SetQRbit (0);
-    DnsHeader.ResetOpcode ();
-    DnsHeader.SetOpcode (4);
-    DnsHeader.AddAnswer (rrHeader);
+  connection->second.txQueue.push_back (framed);
+  FlushTcpQueue (socket);
+}
 
-    tldResponse->AddHeader (DnsHeader);
+void
+BindServer::FlushTcpQueue (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
 
-    ReplyQuery (tldResponse, toAddress);
+  TcpConnectionI connection = m_tcpConnections.find (socket);
+  if (connection == m_tcpConnections.end () || !connection->second.connected)
+  {
+    return;
   }
-  else
+
+  std::list<Ptr<Packet> >& txQueue = connection->second.txQueue;
+  while (!txQueue.empty () && socket->GetTxAvailable () >= txQueue.front ()->GetSize ())
   {
-    // TODO
-    // Send a reply contains RCODE = 3
+    socket->Send (txQueue.front ());
+    txQueue.pop_front ();
   }
 }
 
 void
-BindServer::ISPServerService (Ptr<Packet> nsQuery, Address toAddress)
+BindServer::CloseTcpConnection (Ptr<Socket> socket)
 {
-  DNSHeader DnsHeader;
-  // uint16_t qType, qClass;
-  std::string qName;
-  bool foundInCache = false, foundAuthRecordinCache = false;
+  NS_LOG_FUNCTION (this << socket);
 
-  nsQuery->RemoveHeader (DnsHeader);
+  TcpConnectionI connection = m_tcpConnections.find (socket);
+  if (connection == m_tcpConnections.end ())
+  {
+    return;
+  }
 
-  // Assume that only one question is attached to the DNS header
-  std::list<QuestionSectionHeader> questionList;
-  questionList = DnsHeader.GetQuestionList ();
+  TcpSocketMapI peer = m_tcpPeers.find (connection->second.peer);
+  if (peer != m_tcpPeers.end () && peer->second == socket)
+  {
+    m_tcpPeers.erase (peer);
+  }
+  TcpSocketMapI pooled = m_upstreamPool.find (connection->second.peer);
+  if (pooled != m_upstreamPool.end () && pooled->second == socket)
+  {
+    m_upstreamPool.erase (pooled);
+  }
+  m_tcpConnections.erase (connection);
 
-  qName = questionList.begin ()->GetqName ();
-  // qType = questionList.begin ()->GetqType ();
-  // qClass = questionList.begin ()->GetqClass ();
+  socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+  socket->SetSendCallback (MakeNullCallback<void, Ptr<Socket>, uint32_t> ());
+  socket->SetCloseCallbacks (MakeNullCallback<void, Ptr<Socket> > (),
+                             MakeNullCallback<void, Ptr<Socket> > ());
+  socket->Close ();
+}
+
+// Copy a stored record into a resource record of a message
+static ResourceRecordHeader
+MakeResourceRecord (const SRVRecordEntry& entry)
+{
+  ResourceRecordHeader record;
 
-  // Find for a record that exactly matches the query name.
-  // if the query is exactly matches for a record in the ISP cache,
-  // the record is treated as a Authoritative record for the client.
-  // In case the ISP name server could not find a auth. record for the query,
-  // the ISP name server returns IP addresses of the Authoritative name servers
-  // for the requested name.
-  // To make the load distribution, we assumed the RR implementation for authoritative records.
-  SRVTable::SRVRecordI foundAuthRecord = m_nsCache.FindARecord (qName, foundAuthRecordinCache);
+  record.SetName (entry.GetRecordName ());
+  record.SetClass (entry.GetClass ());
+  record.SetType (entry.GetType ());
+  record.SetTimeToLive (entry.GetTTL ());
+  record.SetRDataWire (entry.GetRDataWire ());
 
-  // Return the first record that matches the requested qName
-  // This supports the RR method
-  SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordMatches (qName, foundInCache);
+  return record;
+}
 
-  Ptr<Packet> ispResponse = Create<Packet> ();
+// Zones are written with or without a leading dot (".co.jp", "co.jp")
+static std::string
+CanonicalZone (const std::string& zone)
+{
+  std::string::size_type start = zone.find_first_not_of ('.');
+  return start == std::string::npos ? std::string () : zone.substr (start);
+}
 
-  if (foundAuthRecordinCache)
+// Whether one of the questions before 'question' asks the same
+static bool
+IsRepeatedQuestion (std::list<QuestionSectionHeader>::const_iterator first,
+                    std::list<QuestionSectionHeader>::const_iterator question)
+{
+  for (; first != question; first++)
   {
-    // Move the existing answer list to the Additional section.
-    // 	This feature is implemented to track the recursive operation and
-    // 	thus for debugging purposes.
-    // Assume that only one question is attached to the DNS header
-    NS_LOG_INFO ("Move the Existing recursive answer list in to additional section.");
-    std::list<ResourceRecordHeader> answerList;
-    answerList = DnsHeader.GetAnswerList ();
+    if (first->GetqType () == question->GetqType () && first->GetqClass () == question->GetqClass ()
+        && first->GetqName () == question->GetqName ())
+    {
+      return true;
+    }
+  }
+  return false;
+}
 
-    for (std::list<ResourceRecordHeader>::iterator iter = answerList.begin ();
-         iter != answerList.end ();
-         iter++)
+// Whether a name is the zone itself or below it. Every name is in the root zone.
+static bool
+IsInZone (const std::string& name, const std::string& zone)
+{
+  std::string apex = CanonicalZone (zone);
+  if (apex.empty () || name == apex)
+  {
+    return true;
+  }
+  return name.size () > apex.size () && name.compare (name.size () - apex.size (), apex.size (), apex) == 0 &&
+         name[name.size () - apex.size () - 1] == '.';
+}
+
+void
+BindServer::LocalServerService (DNSHeader& DnsHeader, Address toAddress)
+{
+  NS_LOG_FUNCTION (this);
+
+  std::string qName;
+  bool nsQuestion = false;
+
+  if ((nsQuestion = DnsHeader.GetQRbit ()))  // if NS query
+  {
+    // retrieve the question list
+    const std::list<QuestionSectionHeader>& questionList = DnsHeader.GetQuestionList ();
+
+    // NOTE
+    // We assumed that the local DNS does the recursive resolution process (i.e., in CDN networks)
+
+    if (questionList.empty ())
     {
-      ResourceRecordHeader additionalRecord;
+      return;
+    }
+    if (questionList.size () == 1)
+    {
+      std::list<ResourceRecordHeader> answers;
+      uint8_t rcode = 0;
+      if (!ResolveQuestion (*questionList.begin (), toAddress, DnsHeader.GetId (), 0, answers, rcode))
+      {
+        ReplyClient (DnsHeader, toAddress, rcode, answers);
+      }
+      return;
+    }
 
-      additionalRecord.SetName (iter->GetName ());
-      additionalRecord.SetClass (iter->GetClass ());
-      additionalRecord.SetType (iter->GetType ());
-      additionalRecord.SetTimeToLive (iter->GetTimeToLive ());
-      additionalRecord.SetRData (iter->GetRData ());
+    // Several questions in one message: every question is answered from the
+    // cache or resolved in parallel, and a single reply carries all answers
+    // once the last resolution has finished.
+    uint32_t requestId = m_nextRequestId++;
+    if (m_nextRequestId == 0)
+    {
+      m_nextRequestId = 1;
+    }
+    MultiQuestionRequest& request = m_multiQuestionRequests[requestId];
+    request.client = toAddress;
+    request.id = DnsHeader.GetId ();
+    request.questions = questionList;
+    request.distinctQuestions = 0;
+    request.outstanding = 0;
+    request.failures = 0;
+    request.rcode = 0;
+    request.tagged = m_messageTagged;
+    request.tag = m_messageTag;
+    request.arrival = m_messageArrival;
+
+    for (std::list<QuestionSectionHeader>::const_iterator question = questionList.begin ();
+         question != questionList.end ();
+         question++)
+    {
+      // A repeated question is answered once
+      if (IsRepeatedQuestion (questionList.begin (), question))
+      {
+        continue;
+      }
+      request.distinctQuestions++;
 
-      DnsHeader.AddARecord (additionalRecord);
+      std::list<ResourceRecordHeader> answers;
+      uint8_t rcode = 0;
+      if (ResolveQuestion (*question, toAddress, DnsHeader.GetId (), requestId, answers, rcode))
+      {
+        request.outstanding++;
+      }
+      else
+      {
+        AddRequestResult (request, rcode, answers);
+      }
     }
-    // Clear the existing answer list
-    DnsHeader.ClearAnswers ();
+    if (request.outstanding == 0)
+    {
+      FinishMultiQuestionRequest (requestId);
+    }
+  }     // end of the NS query
+  else  // // NS response !rHeader.GetQRbit ()
+  {
+    NS_LOG_INFO ("Handle the NS responses from recursive name servers");
 
-    ResourceRecordHeader rrHeader;
+    // Match the reply with the resolution it belongs to. Replies to queries
+    // that were already answered or given up are dropped here.
+    const std::list<QuestionSectionHeader>& questionList = DnsHeader.GetQuestionList ();
+    if (questionList.empty ())
+    {
+      NS_LOG_INFO ("Dropping a reply without a question.");
+      return;
+    }
+    Ipv4Address responder = InetSocketAddress::ConvertFrom (toAddress).GetIpv4 ();
+    uint32_t handle = m_pendingQueries.Find (DnsHeader.GetId (), questionList.begin ()->GetqName (), responder);
+    if (handle == PendingQueryTable::INVALID_HANDLE)
+    {
+      NS_LOG_INFO ("Dropping a reply that matches no pending resolution.");
+      m_unmatchedResponses++;
+      return;
+    }
+    PendingQuery& pending = m_pendingQueries.Get (handle);
+    if (m_messageTagged)
+    {
+      pending.trail.AddHops (m_messageTag);
+    }
 
-    rrHeader.SetName (foundAuthRecord->first->GetRecordName ());
-    rrHeader.SetClass (foundAuthRecord->first->GetClass ());
-    rrHeader.SetType (foundAuthRecord->first->GetType ());
-    rrHeader.SetTimeToLive (foundAuthRecord->first->GetTTL ());
-    rrHeader.SetRData (foundAuthRecord->first->GetRData ());
+    if (DnsHeader.GetTCbit ())
+    {
+      // The upstream reply did not fit in a datagram: the exchange is not
+      // over, so it neither feeds the RTT estimate nor counts as a hedge
+      // win. Repeat the query to the same server over TCP. Late datagrams
+      // of the same query are ignored once the retry is under way.
+      if (!pending.overTcp)
+      {
+        NS_LOG_INFO ("Truncated reply. Retrying the query over TCP.");
+        pending.overTcp = true;
+        pending.hedgeEvent.Cancel ();
+        m_pendingQueries.ClearUpstreams (handle);
+        m_pendingQueries.AddUpstream (handle, responder);
+        pending.sentAt = Simulator::Now ();
+        pending.timeoutEvent.Cancel ();
+        pending.timeoutEvent = Simulator::Schedule (pending.timeout, &BindServer::HandleQueryTimeout, this, handle);
+        SendUpstream (handle, pending.request->Copy (), responder);
+      }
+      return;
+    }
 
-    DnsHeader.SetQRbit (0);
-    DnsHeader.ResetOpcode ();
-    DnsHeader.SetOpcode (5);
-    DnsHeader.SetAAbit (1);
-    DnsHeader.AddAnswer (rrHeader);
+    // The query was hedged and the second server answered first
+    bool hedgeWon = pending.upstreams.size () > 1 && responder != pending.upstreams.front ();
+    if (hedgeWon)
+    {
+      m_hedgeWins++;
+    }
 
-    ispResponse->AddHeader (DnsHeader);
+    // Karn's rule: a reply to a retransmitted query cannot be attributed
+    // to one transmission, so it does not update the estimate. Neither does
+    // a reply over TCP, whose time includes the connection setup.
+    if (pending.retransmissions == 0 && !pending.overTcp)
+    {
+      m_upstreamSelector.ReportRtt (responder, Simulator::Now () - (hedgeWon ? pending.hedgedAt : pending.sentAt));
+    }
 
-    ReplyQuery (ispResponse, toAddress);
+    qName = pending.qName;
 
-    // Change the order of server according to the round robin algorithm
+    if (DnsHeader.GetRcode () == 3)
+    {
+      NS_LOG_INFO (qName << " does not exist.");
+      CompleteResolution (handle, 3, std::list<ResourceRecordHeader> ());
+      return;
+    }
+    if (DnsHeader.GetRcode () != 0)
+    {
+      NS_LOG_INFO ("Upstream error " << uint32_t (DnsHeader.GetRcode ()) << ". Replying SERVFAIL.");
+      CompleteResolution (handle, 2, std::list<ResourceRecordHeader> ());
+      return;
+    }
+
+    const std::list<ResourceRecordHeader>& answerList = DnsHeader.GetAnswerList ();
+    if (!answerList.empty ())
+    {
+      NS_LOG_INFO ("Add the answers in to the server cache");
+
+      for (std::list<ResourceRecordHeader>::const_iterator iter = answerList.begin ();
+           iter != answerList.end ();
+           iter++)
+      {
+        CacheRecord (m_nsCache, *iter);
+      }
+
+      // Local Server always returns the server address according to the RR manner.
+      std::list<ResourceRecordHeader> answers;
+      bool foundInCache = false;
+      SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordHas (qName, foundInCache);
+      if (foundInCache)
+      {
+        ResourceRecordHeader answer = MakeResourceRecord (*cachedRecord->first);
+        answer.SetTimeToLive (25);  // (cachedRecord->first->GetTTL ());  // bypassed for testing purposes
+        answers.push_back (answer);
+        m_nsCache.SwitchServersRoundRobin ();
+      }
+      else
+      {
+        answers = answerList;
+      }
+      CompleteResolution (handle, 0, answers);
+      return;
+    }
+
+    // A referral: NS records of a zone closer to the name in the authority
+    // section, and the addresses of those servers in the additional section
+    const std::list<ResourceRecordHeader>& nsList = DnsHeader.GetNsRecordList ();
+    if (!nsList.empty () && nsList.begin ()->GetType () == RR_TYPE_NS)
+    {
+      std::string zone = nsList.begin ()->GetName ();
+
+      // Only referrals that lead further down towards the name are
+      // followed, so that a lame or looping delegation cannot go on forever.
+      if (!IsInZone (qName, zone) || CanonicalZone (zone).size () <= CanonicalZone (pending.zone).size ())
+      {
+        NS_LOG_INFO ("Referral to " << zone << " does not lead closer to " << qName << ". Replying SERVFAIL.");
+        CompleteResolution (handle, 2, std::list<ResourceRecordHeader> ());
+        return;
+      }
+      if (++pending.referrals > m_maxReferrals)
+      {
+        NS_LOG_INFO ("Too many referrals for " << qName << ". Replying SERVFAIL.");
+        CompleteResolution (handle, 2, std::list<ResourceRecordHeader> ());
+        return;
+      }
+
+      // Cache the delegation so that later lookups below this zone start here
+      const std::list<ResourceRecordHeader>& arList = DnsHeader.GetArList ();
+      std::vector<Ipv4Address> servers;
+      for (std::list<ResourceRecordHeader>::const_iterator ns = nsList.begin (); ns != nsList.end (); ns++)
+      {
+        if (ns->GetType () != RR_TYPE_NS || ns->GetName () != zone)
+        {
+          continue;
+        }
+        CacheRecord (m_delegationCache, *ns);
+
+        std::string serverName = ns->GetRData<RR_TYPE_NS> ();
+        for (std::list<ResourceRecordHeader>::const_iterator ar = arList.begin (); ar != arList.end (); ar++)
+        {
+          if (ar->GetType () == RR_TYPE_A && ar->GetName () == serverName)
+          {
+            CacheRecord (m_delegationCache, *ar);
+            servers.push_back (ar->GetRData<RR_TYPE_A> ());
+          }
+        }
+      }
+      if (servers.empty ())
+      {
+        NS_LOG_INFO ("Referral to " << zone << " without glue. Replying SERVFAIL.");
+        CompleteResolution (handle, 2, std::list<ResourceRecordHeader> ());
+        return;
+      }
+
+      NS_LOG_INFO ("Referral to " << zone);
+      pending.zone = zone;
+      SendPendingQuery (handle, pending.request, servers);
+      return;
+    }
+
+    // Neither answers nor a referral: the name has no records of the type
+    NS_LOG_INFO (qName << " has no records of the requested type.");
+    CompleteResolution (handle, 0, std::list<ResourceRecordHeader> ());
+  }  // end of ns response
+}
+
+// Answer one question of a client from the cache, or resolve it.
+// Returns true if the question waits for a resolution; its outcome is then
+// delivered to the client (or to its multi-question request) later.
+// Otherwise the answers and the response code are filled in.
+bool
+BindServer::ResolveQuestion (const QuestionSectionHeader& question,
+                             Address client,
+                             uint16_t id,
+                             uint32_t request,
+                             std::list<ResourceRecordHeader>& answers,
+                             uint8_t& rcode)
+{
+  NS_LOG_FUNCTION (this << question.GetqName ());
+
+  const std::string& qName = question.GetqName ();
+  uint16_t qType = question.GetqType ();
+  uint16_t qClass = question.GetqClass ();
+  UpdateHotNames (qName);
+
+  bool foundInCache = false;
+  SRVTable::SRVRecordI cachedRecord = m_nsCache.FindARecordHas (qName, foundInCache);
+  if (foundInCache)
+  {
+    NS_LOG_INFO ("Found a record in the local cache. Replying..");
+    m_cacheHitCount++;
+    m_cacheHitTrace (qName);
+    DNS_TRACE_EVENT (&m_eventTrace, DnsTraceEvent::HIT, DnsEventTrace::Hash (qName), qType, TraceAddress (client), id, 0, 0);
+
+    // Local Server always returns the server address according to the RR manner.
+    ResourceRecordHeader answer = MakeResourceRecord (*cachedRecord->first);
+    answer.SetTimeToLive (25);  //cachedRecord->first->GetTTL ());
+    answers.push_back (answer);
+    rcode = 0;
+
+    // Toggle servers
     m_nsCache.SwitchServersRoundRobin ();
+    return false;
+  }
+
+  if (m_raType != RA_AVAILABLE)
+  {
+    NS_LOG_INFO ("Recursion is not available. Refusing " << qName);
+    rcode = 5;
+    return false;
   }
-  else if (foundInCache)
+  m_cacheMisses++;
+  m_cacheMissCount++;
+  m_cacheMissTrace (qName);
+  DNS_TRACE_EVENT (&m_eventTrace, DnsTraceEvent::MISS, DnsEventTrace::Hash (qName), qType, TraceAddress (client), id, 0, 0);
+
+  // Join a resolution of the same question that is already in flight
+  uint32_t inFlight = m_enableCoalescing ? m_pendingQueries.FindQuestion (qName, qType, qClass)
+                                         : PendingQueryTable::INVALID_HANDLE;
+  if (inFlight != PendingQueryTable::INVALID_HANDLE)
   {
-    ResourceRecordHeader rrHeader;
+    NS_LOG_INFO ("Resolution of " << qName << " already in progress. Waiting for its result.");
+    AddPendingClient (inFlight, client, id, request);
+    return true;
+  }
 
-    rrHeader.SetName (cachedRecord->first->GetRecordName ());
-    rrHeader.SetClass (cachedRecord->first->GetClass ());
-    rrHeader.SetType (cachedRecord->first->GetType ());
-    rrHeader.SetTimeToLive (cachedRecord->first->GetTTL ());
-    rrHeader.SetRData (cachedRecord->first->GetRData ());
+  NS_LOG_INFO ("Initiate iterative resolution.");
 
-    DnsHeader.SetQRbit (0);
-    DnsHeader.ResetOpcode ();
-    DnsHeader.SetOpcode (5);
-    DnsHeader.AddAnswer (rrHeader);
+  NS_LOG_INFO ("Add the recursive request in to the list");
+  uint32_t handle = m_pendingQueries.Allocate (qName, qType, qClass);
+  if (handle == PendingQueryTable::INVALID_HANDLE)
+  {
+    NS_LOG_INFO ("Too many resolutions in progress. Replying SERVFAIL.");
+    rcode = 2;
+    return false;
+  }
+  m_pendingSize = m_pendingQueries.GetSize ();
+
+  // The upstream query gets its own transaction ID; the client's ID is
+  // restored when the final answer is sent back.
+  PendingQuery& pending = m_pendingQueries.Get (handle);
+  pending.id = NextTransactionId ();
+  AddPendingClient (handle, client, id, request);
+
+  // Start from the deepest zone cut in the delegation cache. Without
+  // one, the resolution starts at the root servers.
+  std::list<ResourceRecordHeader> nsRecords;
+  std::list<ResourceRecordHeader> glue;
+  std::vector<Ipv4Address> servers;
+  if (FindZoneCut (m_delegationCache, qName, pending.zone, nsRecords, glue))
+  {
+    NS_LOG_INFO ("Starting at the cached zone cut " << pending.zone);
+    for (std::list<ResourceRecordHeader>::const_iterator iter = glue.begin (); iter != glue.end (); iter++)
+    {
+      servers.push_back (iter->GetRData<RR_TYPE_A> ());
+    }
+  }
+  else
+  {
+    pending.zone = "";
+    servers.push_back (m_rootAddress);
+    servers.insert (servers.end (), m_rootReplicas.begin (), m_rootReplicas.end ());
+  }
 
-    ispResponse->AddHeader (DnsHeader);
+  // Every server on the way is asked the bare question
+  DNSHeader upstreamQuery;
+  upstreamQuery.SetId (pending.id);
+  upstreamQuery.SetQRbit (1);
+  upstreamQuery.AddQuestion (question);
+  Ptr<Packet> upstreamRequest = Create<Packet> ();
+  upstreamRequest->AddHeader (upstreamQuery);
 
-    ReplyQuery (ispResponse, toAddress);
+  SendPendingQuery (handle, upstreamRequest, servers);
+  return true;
+}
+
+// Reply to a single-question client query that was answered at once
+void
+BindServer::ReplyClient (DNSHeader& query, Address client, uint8_t rcode, const std::list<ResourceRecordHeader>& answers)
+{
+  NS_LOG_FUNCTION (this << uint32_t (rcode));
+
+  query.SetQRbit (0);
+  query.SetRAbit (1);
+  query.SetRcode (rcode);
+  // AddAnswer prepends, so add in reverse to keep the order
+  for (std::list<ResourceRecordHeader>::const_reverse_iterator iter = answers.rbegin ();
+       iter != answers.rend ();
+       iter++)
+  {
+    query.AddAnswer (*iter);
   }
-  else
+
+  CountHeaderMemory (query);
+  Ptr<Packet> dnsResponse = Create<Packet> ();
+  dnsResponse->AddHeader (query);
+  if (m_messageTagged)
   {
-    // TODO
-    // Send a reply contains RCODE = 3
+    TagReply (dnsResponse, m_messageTag, m_messageArrival);
   }
+  ReplyQuery (dnsResponse, client);
 }
 
+// Fold the outcome of one question into a multi-question request
 void
-BindServer::AuthServerService (Ptr<Packet> nsQuery, Address toAddress)
+BindServer::AddRequestResult (MultiQuestionRequest& request,
+                              uint8_t rcode,
+                              const std::list<ResourceRecordHeader>& answers)
 {
-  DNSHeader DnsHeader;
-  // uint16_t qType, qClass;
-  std::string qName;
-  bool foundInCache = false;  //, foundAARecords = false;
+  request.answers.insert (request.answers.end (), answers.begin (), answers.end ());
+  if (rcode != 0)
+  {
+    request.failures++;
+    request.rcode = rcode;
+  }
+}
 
-  nsQuery->RemoveHeader (DnsHeader);
+// Send the combined reply of a multi-question request. The message carries
+// an error code only if none of its questions could be answered.
+void
+BindServer::FinishMultiQuestionRequest (uint32_t requestId)
+{
+  NS_LOG_FUNCTION (this << requestId);
 
-  // Assume that only one question is attached to the DNS header
-  std::list<QuestionSectionHeader> questionList;
-  questionList = DnsHeader.GetQuestionList ();
+  MultiQuestionRequestI it = m_multiQuestionRequests.find (requestId);
+  if (it == m_multiQuestionRequests.end ())
+  {
+    return;
+  }
+  const MultiQuestionRequest& request = it->second;
+
+  DNSHeader reply;
+  reply.SetId (request.id);
+  reply.SetQRbit (0);
+  reply.SetRAbit (1);
+  reply.SetRcode (request.failures == request.distinctQuestions ? request.rcode : 0);
+  // AddQuestion and AddAnswer prepend, so add in reverse to keep the order
+  for (std::list<QuestionSectionHeader>::const_reverse_iterator iter = request.questions.rbegin ();
+       iter != request.questions.rend ();
+       iter++)
+  {
+    reply.AddQuestion (*iter);
+  }
+  for (std::list<ResourceRecordHeader>::const_reverse_iterator iter = request.answers.rbegin ();
+       iter != request.answers.rend ();
+       iter++)
+  {
+    reply.AddAnswer (*iter);
+  }
 
-  qName = questionList.begin ()->GetqName ();
-  // qType = questionList.begin ()->GetqType ();
-  // qClass = questionList.begin ()->GetqClass ();
+  CountHeaderMemory (reply);
+  Ptr<Packet> replyToClient = Create<Packet> ();
+  replyToClient->AddHeader (reply);
+  if (request.tagged)
+  {
+    TagReply (replyToClient, request.tag, request.arrival);
+  }
+  ReplyQuery (replyToClient, request.client);
 
-  NS_UNUSED (foundInCache);
+  m_multiQuestionRequests.erase (it);
+}
 
-  // Find the query in the nameserver cache
-  SRVTable::SRVRecordInstance instance;
-  // foundInCache = m_nsCache.FindRecordsFor (qName, instance);
-  foundInCache = m_nsCache.FindAllRecordsHas (qName, instance);
+uint16_t
+BindServer::NextTransactionId (void)
+{
+  return m_nextTransactionId++;
+}
 
-  if (foundInCache)
+// (Re)start a pending resolution at the fastest of the given replicas.
+// Moving to the next server of the hierarchy resets the timeout and the
+// retransmission count.
+void
+BindServer::SendPendingQuery (uint32_t handle, Ptr<Packet> request, const std::vector<Ipv4Address>& servers)
+{
+  NS_LOG_FUNCTION (this << handle << servers.size ());
+
+  PendingQuery& pending = m_pendingQueries.Get (handle);
+  pending.timeoutEvent.Cancel ();
+  pending.hedgeEvent.Cancel ();
+  m_pendingQueries.ClearUpstreams (handle);
+
+  Ipv4Address upstream = m_upstreamSelector.Select (servers);
+  pending.servers = servers;
+  m_pendingQueries.AddUpstream (handle, upstream);
+
+  pending.request = request->Copy ();
+  pending.sentAt = Simulator::Now ();
+  pending.timeout = m_queryTimeout;
+  pending.retransmissions = 0;
+  pending.overTcp = false;
+  pending.timeoutEvent = Simulator::Schedule (pending.timeout, &BindServer::HandleQueryTimeout, this, handle);
+
+  if (m_enableHedging && servers.size () > 1)
   {
-    // Move the existing answer list to the Additional section.
-    // This feature is implemented to track the recursive operation and
-    // thus for debugging purposes.
-    // Assume that only one question is attached to the DNS header
-    NS_LOG_INFO ("Move the Existing recursive answer list in to additional section.");
-    std::list<ResourceRecordHeader> answerList;
-    answerList = DnsHeader.GetAnswerList ();
+    // Hedge once the first server is clearly late, or at once for the most queried names
+    Time delay = Seconds (0);
+    if (!IsHotName (pending.qName))
+    {
+      delay = std::max (MicroSeconds (m_hedgeDelayFactor * m_upstreamSelector.GetSrtt (upstream).GetMicroSeconds ()),
+                        m_minHedgeDelay);
+    }
+    if (delay < pending.timeout)
+    {
+      pending.hedgeEvent = Simulator::Schedule (delay, &BindServer::HandleHedge, this, handle);
+    }
+  }
 
-    for (std::list<ResourceRecordHeader>::iterator iter = answerList.begin ();
-         iter != answerList.end ();
-         iter++)
+  SendUpstream (handle, request, upstream);
+}
+
+// Send the pending query to the fastest replica that has not been asked yet.
+// The entry is reachable under both servers, so the first reply wins.
+void
+BindServer::HandleHedge (uint32_t handle)
+{
+  NS_LOG_FUNCTION (this << handle);
+
+  PendingQuery& pending = m_pendingQueries.Get (handle);
+
+  std::vector<Ipv4Address> others;
+  for (std::vector<Ipv4Address>::const_iterator it = pending.servers.begin (); it != pending.servers.end (); it++)
+  {
+    if (std::find (pending.upstreams.begin (), pending.upstreams.end (), *it) == pending.upstreams.end ())
     {
-      ResourceRecordHeader additionalRecord;
+      others.push_back (*it);
+    }
+  }
+  if (others.empty ())
+  {
+    return;
+  }
+
+  Ipv4Address second = m_upstreamSelector.Select (others);
+  m_pendingQueries.AddUpstream (handle, second);
+  pending.hedgedAt = Simulator::Now ();
+  m_hedgedQueries++;
+
+  NS_LOG_INFO ("Hedging the query for " << pending.qName << " to " << second);
+  SendUpstream (handle, pending.request->Copy (), second);
+}
 
-      additionalRecord.SetName (iter->GetName ());
-      additionalRecord.SetClass (iter->GetClass ());
-      additionalRecord.SetType (iter->GetType ());
-      additionalRecord.SetTimeToLive (iter->GetTimeToLive ());
-      additionalRecord.SetRData (iter->GetRData ());
+// Count a client query in the Space-Saving summary of the most queried
+// names. The summary holds at most HedgeTopNames names.
+void
+BindServer::UpdateHotNames (const std::string& qName)
+{
+  if (m_hedgeTopNames == 0)
+  {
+    return;
+  }
+
+  HotNameMapI it = m_hotNames.find (qName);
+  if (it != m_hotNames.end ())
+  {
+    it->second.count++;
+    return;
+  }
 
-      DnsHeader.AddARecord (additionalRecord);
+  HotNameCounter counter;
+  counter.count = 1;
+  counter.error = 0;
+  if (m_hotNames.size () >= m_hedgeTopNames)
+  {
+    // The new name takes over the least counted one and inherits its count as error
+    HotNameMapI least = m_hotNames.begin ();
+    for (it = m_hotNames.begin (); it != m_hotNames.end (); it++)
+    {
+      if (it->second.count < least->second.count)
+      {
+        least = it;
+      }
     }
-    // Clear the existing answer list
-    DnsHeader.ClearAnswers ();
+    counter.count = least->second.count + 1;
+    counter.error = least->second.count;
+    m_hotNames.erase (least);
+  }
+  m_hotNames[qName] = counter;
+}
 
-    // Now, add the server list as the new answer list
-    NS_LOG_INFO ("Add the content server list as the new answer list of the DNS header.");
-    // Create the response
-    Ptr<Packet> authResponse = Create<Packet> ();
+// A name is among the top names if its guaranteed count is at least the
+// count of the least counted name of the summary.
+bool
+BindServer::IsHotName (const std::string& qName) const
+{
+  HotNameMapCI it = m_hotNames.find (qName);
+  if (it == m_hotNames.end ())
+  {
+    return false;
+  }
+
+  uint64_t least = it->second.count;
+  for (HotNameMapCI other = m_hotNames.begin (); other != m_hotNames.end (); other++)
+  {
+    least = std::min (least, other->second.count);
+  }
+  return it->second.count - it->second.error >= least;
+}
 
-    // Get the found record list and add the records to the DNS header according to the Type
-    for (SRVTable::SRVRecordI it = instance.begin (); it != instance.end (); it++)
+void
+BindServer::HandleQueryTimeout (uint32_t handle)
+{
+  NS_LOG_FUNCTION (this << handle);
+
+  PendingQuery& pending = m_pendingQueries.Get (handle);
+  m_upstreamSelector.ReportTimeout (pending.upstreams.front (), pending.timeout);
+
+  if (pending.retransmissions >= m_maxRetransmissions)
+  {
+    NS_LOG_INFO ("No reply for " << pending.qName << " after " << pending.retransmissions
+                                 << " retransmissions. Replying SERVFAIL.");
+    CompleteResolution (handle, 2, std::list<ResourceRecordHeader> ());
+    return;
+  }
+
+  pending.retransmissions++;
+  pending.timeout = pending.timeout * 2;
+  pending.timeoutEvent = Simulator::Schedule (pending.timeout, &BindServer::HandleQueryTimeout, this, handle);
+
+  NS_LOG_INFO ("Retransmitting the query for " << pending.qName << " to " << pending.upstreams.front ());
+  SendUpstream (handle, pending.request->Copy (), pending.upstreams.front ());
+}
+
+void
+BindServer::SendUpstream (uint32_t handle, Ptr<Packet> request, Ipv4Address upstream)
+{
+  PendingQuery& pending = m_pendingQueries.Get (handle);
+  if (pending.traced)
+  {
+    DnsResolutionTag tag;
+    tag.SetSent (Simulator::Now ());
+    request->AddPacketTag (tag);
+  }
+  pending.upstreamQueries++;
+  m_upstreamQueries++;
+  m_upstreamTrace (request, upstream);
+  DNS_TRACE_EVENT (&m_eventTrace,
+                   DnsTraceEvent::SEND,
+                   DnsEventTrace::Hash (pending.qName),
+                   pending.qType,
+                   upstream.Get (),
+                   pending.id,
+                   TraceSize (request),
+                   0);
+  SendQuery (request, InetSocketAddress (upstream, DNS_PORT), pending.overTcp ? TRANSPORT_TCP : m_upstreamTransport);
+}
+
+void
+BindServer::AddPendingClient (uint32_t handle, Address client, uint16_t id, uint32_t request)
+{
+  NS_LOG_FUNCTION (this << handle << id << request);
+
+  std::vector<PendingClient>& clients = m_pendingQueries.Get (handle).clients;
+  for (std::vector<PendingClient>::const_iterator it = clients.begin (); it != clients.end (); it++)
+  {
+    if (it->id == id && it->address == client && it->request == 0 && request == 0)
+    {
+      // A retransmission of a query that is already waiting
+      return;
+    }
+  }
+  PendingClient waiter;
+  waiter.address = client;
+  waiter.id = id;
+  waiter.request = request;
+  waiter.tagged = m_messageTagged;
+  waiter.arrival = m_messageArrival;
+  if (m_messageTagged)
+  {
+    waiter.tag = m_messageTag;
+    m_pendingQueries.Get (handle).traced = true;
+  }
+  clients.push_back (waiter);
+}
+
+// Send the result of a resolution to every client waiting for it. The
+// message is only re-encoded to patch the transaction ID of each client.
+void
+BindServer::ReplyPendingClients (uint32_t handle, DNSHeader& reply)
+{
+  NS_LOG_FUNCTION (this << handle);
+
+  const PendingQuery& pending = m_pendingQueries.Get (handle);
+  const std::vector<PendingClient>& clients = pending.clients;
+  for (std::vector<PendingClient>::const_iterator it = clients.begin (); it != clients.end (); it++)
+  {
+    if (it->request != 0)
     {
-      // Assume that Number of DNS records will note results packet segmentation
-      if (it->first->GetType () == 1)  // A host record or a CNAME record
+      // One of the questions of a multi-question request
+      MultiQuestionRequestI request = m_multiQuestionRequests.find (it->request);
+      if (request != m_multiQuestionRequests.end ())
       {
-        ResourceRecordHeader rrHeader;
+        if (request->second.tagged)
+        {
+          request->second.tag.AddHops (pending.trail);
+        }
+        AddRequestResult (request->second, reply.GetRcode (), reply.GetAnswerList ());
+        if (--request->second.outstanding == 0)
+        {
+          FinishMultiQuestionRequest (it->request);
+        }
+      }
+      continue;
+    }
+    reply.SetId (it->id);
+    Ptr<Packet> replyToClient = Create<Packet> ();
+    replyToClient->AddHeader (reply);
+    if (it->tagged)
+    {
+      DnsResolutionTag tag = it->tag;
+      tag.AddHops (pending.trail);
+      TagReply (replyToClient, tag, it->arrival);
+    }
+    ReplyQuery (replyToClient, it->address);
+  }
+}
+
+// Answer every client of a resolution and free its entry
+void
+BindServer::CompleteResolution (uint32_t handle, uint8_t rcode, const std::list<ResourceRecordHeader>& answers)
+{
+  NS_LOG_FUNCTION (this << handle << uint32_t (rcode));
+
+  const PendingQuery& pending = m_pendingQueries.Get (handle);
+
+  QuestionSectionHeader question;
+  question.SetqName (pending.qName);
+  question.SetqType (pending.qType);
+  question.SetqClass (pending.qClass);
+
+  DNSHeader reply;
+  reply.SetQRbit (0);
+  reply.SetRAbit (1);
+  reply.SetRcode (rcode);
+  reply.AddQuestion (question);
+  // AddAnswer prepends, so add in reverse to keep the order
+  for (std::list<ResourceRecordHeader>::const_reverse_iterator iter = answers.rbegin ();
+       iter != answers.rend ();
+       iter++)
+  {
+    reply.AddAnswer (*iter);
+  }
+  CountHeaderMemory (reply);
+
+  ReplyPendingClients (handle, reply);
+  m_resolutionTrace (pending.qName, rcode, pending.upstreamQueries, Simulator::Now () - pending.startedAt);
+  m_pendingQueries.Release (handle);
+  m_pendingSize = m_pendingQueries.GetSize ();
+}
+
+void
+BindServer::HandleCacheEviction (const SRVRecordEntry& record)
+{
+  m_cacheEvictions++;
+  m_evictionTrace (record.GetRecordName (), record.GetType ());
+  // Called just before the record is removed
+  m_cacheSize = m_nsCache.GetSize () - 1;
+}
+
+uint64_t
+BindServer::GetCacheMemory (void) const
+{
+  return m_nsCache.GetMemoryUsage ();
+}
+
+uint64_t
+BindServer::GetCacheMemoryPeak (void) const
+{
+  return m_nsCache.GetPeakMemoryUsage ();
+}
+
+uint64_t
+BindServer::GetDelegationCacheMemory (void) const
+{
+  return m_delegationCache.GetMemoryUsage ();
+}
+
+uint64_t
+BindServer::GetDelegationCacheMemoryPeak (void) const
+{
+  return m_delegationCache.GetPeakMemoryUsage ();
+}
+
+uint64_t
+BindServer::GetPendingQueryMemory (void) const
+{
+  return m_pendingQueries.GetMemoryUsage ();
+}
+
+uint64_t
+BindServer::GetHeaderMemory (void) const
+{
+  uint64_t bytes = DnsMemoryUsage (m_batchHeaders) - m_batchHeaders.size () * sizeof (DNSHeader);
+  for (std::vector<DNSHeader>::const_iterator it = m_batchHeaders.begin (); it != m_batchHeaders.end (); it++)
+  {
+    bytes += it->GetMemoryUsage ();
+  }
+  return bytes;
+}
 
-        rrHeader.SetName (it->first->GetRecordName ());
-        rrHeader.SetClass (it->first->GetClass ());
-        rrHeader.SetType (it->first->GetType ());
-        rrHeader.SetTimeToLive (it->first->GetTTL ());
-        rrHeader.SetRData (it->first->GetRData ());
+void
+BindServer::CountHeaderMemory (const DNSHeader& header)
+{
+  m_headerMemoryPeak = std::max<uint64_t> (m_headerMemoryPeak, header.GetMemoryUsage ());
+}
+
+// Take the resolution tag off a received message, so that the replies to
+// the message can carry it on
+void
+BindServer::TakeResolutionTag (Ptr<Packet> message, Time arrival)
+{
+  m_messageTagged = message->RemovePacketTag (m_messageTag);
+  m_messageArrival = arrival;
+}
+
+// Tag a reply with the hops of a query and the hop of this server. The hop
+// departs when the reply is sent, see DoReplyQuery.
+void
+BindServer::TagReply (Ptr<Packet> reply, const DnsResolutionTag& tag, Time arrival)
+{
+  DnsResolutionTag replyTag = tag;
+  replyTag.AddHop (GetNode ()->GetId (), m_serverType, arrival);
+  reply->AddPacketTag (replyTag);
+}
+
+// Add a record to a cache unless the same record is already there
+void
+BindServer::CacheRecord (SRVTable& table, const ResourceRecordHeader& record)
+{
+  NS_LOG_FUNCTION (this << record.GetName ());
+
+  if (!table.HasRecord (record.GetName (), record.GetType (), record.GetRDataWire ()))
+  {
+    table.AddRecord (record.GetName (),
+                     record.GetClass (),
+                     record.GetType (),
+                     record.GetTimeToLive (),
+                     record.GetRDataWire ());
+    m_cacheSize = m_nsCache.GetSize ();
+  }
+}
+
+// Find the deepest zone cut at or above qName in a table, with the servers
+// of the zone below the cut. A cut is either
+//  - NS records, with the A records of the named servers as glue, or
+//  - the legacy form of this module: A records whose name starts with a dot
+//    (e.g., ".co.jp") and that hold the addresses of the servers of the zone.
+//    These are returned as NS records and glue with synthesized server names.
+// Cuts without any server address are skipped.
+bool
+BindServer::FindZoneCut (SRVTable& table,
+                         const std::string& qName,
+                         std::string& zone,
+                         std::list<ResourceRecordHeader>& nsRecords,
+                         std::list<ResourceRecordHeader>& glue)
+{
+  NS_LOG_FUNCTION (this << qName);
 
-        DnsHeader.AddAnswer (rrHeader);
+  // Possible cuts, from the deepest to the shallowest. Zones are written
+  // both with and without a leading dot in this module.
+  std::vector<std::string> candidates;
+  candidates.push_back (qName);
+  for (std::string::size_type pos = qName.find ('.'); pos != std::string::npos; pos = qName.find ('.', pos + 1))
+  {
+    candidates.push_back (qName.substr (pos));
+    if (pos + 1 < qName.size ())
+    {
+      candidates.push_back (qName.substr (pos + 1));
+    }
+  }
+
+  for (std::vector<std::string>::const_iterator candidate = candidates.begin ();
+       candidate != candidates.end ();
+       candidate++)
+  {
+    nsRecords.clear ();
+    glue.clear ();
+
+    SRVTable::SRVRecordInstance instance;
+    table.FindRecordsFor (*candidate, instance);
+
+    uint32_t legacyServers = 0;
+    for (SRVTable::SRVRecordCI it = instance.begin (); it != instance.end (); it++)
+    {
+      if (it->first->GetType () == RR_TYPE_NS)
+      {
+        nsRecords.push_back (MakeResourceRecord (*it->first));
+
+        SRVTable::SRVRecordInstance addresses;
+        table.FindRecordsFor (it->first->GetRData<RR_TYPE_NS> (), addresses);
+        for (SRVTable::SRVRecordCI address = addresses.begin (); address != addresses.end (); address++)
+        {
+          if (address->first->GetType () == RR_TYPE_A)
+          {
+            glue.push_back (MakeResourceRecord (*address->first));
+          }
+        }
+        table.ReleaseInstance (addresses);
       }
-      if (it->first->GetType () == 2)  // A Authoritative Name server record
+      else if (it->first->GetType () == RR_TYPE_A && (*candidate)[0] == '.')
       {
-        ResourceRecordHeader nsRecord;
+        std::ostringstream serverName;
+        serverName << "ns" << ++legacyServers << *candidate;
 
-        nsRecord.SetName (it->first->GetRecordName ());
+        ResourceRecordHeader nsRecord;
+        nsRecord.SetName (*candidate);
         nsRecord.SetClass (it->first->GetClass ());
-        nsRecord.SetType (it->first->GetType ());
         nsRecord.SetTimeToLive (it->first->GetTTL ());
-        nsRecord.SetRData (it->first->GetRData ());
+        nsRecord.SetRData<RR_TYPE_NS> (serverName.str ());
+        nsRecords.push_back (nsRecord);
 
-        DnsHeader.AddNsRecord (nsRecord);
+        ResourceRecordHeader address = MakeResourceRecord (*it->first);
+        address.SetName (serverName.str ());
+        glue.push_back (address);
       }
-      if (it->first->GetType () == 5)  // A Authoritative Name server record
-      {
-        ResourceRecordHeader rrRecord;
+    }
+    table.ReleaseInstance (instance);
+
+    if (!glue.empty ())
+    {
+      zone = *candidate;
+      return true;
+    }
+  }
+  nsRecords.clear ();
+  return false;
+}
+
+// Fill the response of an authoritative role from its zone data:
+//  - the records of the queried name go to the answer section,
+//  - otherwise the deepest zone cut above the name is returned as a
+//    referral, with the NS records in the authority section and the glue
+//    in the additional section,
+//  - otherwise the name does not exist (NXDOMAIN).
+// Returns true if the response carries answers.
+bool
+BindServer::BuildZoneResponse (DNSHeader& DnsHeader)
+{
+  NS_LOG_FUNCTION (this);
 
-        rrRecord.SetName (it->first->GetRecordName ());
-        rrRecord.SetClass (it->first->GetClass ());
-        rrRecord.SetType (it->first->GetType ());
-        rrRecord.SetTimeToLive (it->first->GetTTL ());
-        rrRecord.SetRData (it->first->GetRData ());
+  m_cacheMisses++;
+  DnsHeader.ResetOpcode ();
+  DnsHeader.SetQRbit (0);
+
+  const std::list<QuestionSectionHeader>& questionList = DnsHeader.GetQuestionList ();
+  if (questionList.empty ())
+  {
+    DnsHeader.SetRcode (1);
+    return false;
+  }
+
+  std::list<ResourceRecordHeader> answers;
+  std::list<ResourceRecordHeader> authority;
+  std::list<ResourceRecordHeader> additional;
+  std::vector<std::string> referredZones;
+  bool anyNameExists = false;
+
+  for (std::list<QuestionSectionHeader>::const_iterator question = questionList.begin ();
+       question != questionList.end ();
+       question++)
+  {
+    const std::string& qName = question->GetqName ();
+    uint16_t qType = question->GetqType ();
+
+    // Records of the name itself. An NS record at the name is a delegation
+    // and handled as a cut below.
+    m_nsCache.ReleaseInstance (m_lookupScratch);
+    m_nsCache.FindRecordsFor (qName, m_lookupScratch);
+
+    bool nameExists = false;
+    for (SRVTable::SRVRecordCI it = m_lookupScratch.begin (); it != m_lookupScratch.end (); it++)
+    {
+      if (it->first->GetType () == RR_TYPE_NS)
+      {
+        continue;
+      }
+      nameExists = true;
+      if (it->first->GetType () == qType || it->first->GetType () == RR_TYPE_CNAME)
+      {
+        answers.push_back (MakeResourceRecord (*it->first));
+      }
+    }
+    if (nameExists)
+    {
+      anyNameExists = true;
+      continue;
+    }
 
-        DnsHeader.AddNsRecord (rrRecord);
+    std::string zone;
+    std::list<ResourceRecordHeader> nsRecords;
+    std::list<ResourceRecordHeader> glue;
+    if (FindZoneCut (m_nsCache, qName, zone, nsRecords, glue))
+    {
+      // Questions below the same cut share its NS records and glue
+      if (std::find (referredZones.begin (), referredZones.end (), zone) == referredZones.end ())
+      {
+        NS_LOG_INFO ("Referral to " << zone);
+        referredZones.push_back (zone);
+        authority.insert (authority.end (), nsRecords.begin (), nsRecords.end ());
+        additional.insert (additional.end (), glue.begin (), glue.end ());
       }
+      continue;
     }
+    NS_LOG_INFO (qName << " does not exist in this server.");
+  }
 
-    DnsHeader.SetQRbit (0);
+  // The Add methods prepend, so add in reverse to keep the order
+  for (std::list<ResourceRecordHeader>::const_reverse_iterator iter = answers.rbegin (); iter != answers.rend (); iter++)
+  {
+    DnsHeader.AddAnswer (*iter);
+  }
+  for (std::list<ResourceRecordHeader>::const_reverse_iterator iter = authority.rbegin ();
+       iter != authority.rend ();
+       iter++)
+  {
+    DnsHeader.AddNsRecord (*iter);
+  }
+  for (std::list<ResourceRecordHeader>::const_reverse_iterator iter = additional.rbegin ();
+       iter != additional.rend ();
+       iter++)
+  {
+    DnsHeader.AddARecord (*iter);
+  }
+
+  if (anyNameExists)
+  {
+    DnsHeader.SetAAbit (1);
+  }
+  else if (referredZones.empty ())
+  {
+    // None of the names exists
     DnsHeader.SetAAbit (1);
-    DnsHeader.ResetOpcode ();
-    DnsHeader.SetOpcode (6);
+    DnsHeader.SetRcode (3);
+  }
+  return !answers.empty ();
+}
 
-    authResponse->AddHeader (DnsHeader);
-    ReplyQuery (authResponse, toAddress);
+// The response builder shared by the roles that answer from zone data.
+// Role describes what differs between them, and every role gets its own
+// instantiation, so none of these choices is made per message.
+template <class Role>
+void
+BindServer::ZoneServerService (DNSHeader& DnsHeader, Address toAddress)
+{
+  PacketCacheKey cacheKey;
+  bool cacheable = Role::usePacketCache && MakePacketCacheKey (DnsHeader, cacheKey);
+  if (cacheable)
+  {
+    if (ReplyFromPacketCache (cacheKey, DnsHeader, toAddress))
+    {
+      m_cacheHitCount++;
+      m_cacheHitTrace (cacheKey.qName);
+      DNS_TRACE_EVENT (&m_eventTrace,
+                       DnsTraceEvent::HIT,
+                       DnsEventTrace::Hash (cacheKey.qName),
+                       cacheKey.qType,
+                       TraceAddress (toAddress),
+                       DnsHeader.GetId (),
+                       0,
+                       0);
+      return;
+    }
+    m_cacheMissCount++;
+    m_cacheMissTrace (cacheKey.qName);
+    DNS_TRACE_EVENT (&m_eventTrace,
+                     DnsTraceEvent::MISS,
+                     DnsEventTrace::Hash (cacheKey.qName),
+                     cacheKey.qType,
+                     TraceAddress (toAddress),
+                     DnsHeader.GetId (),
+                     0,
+                     0);
+  }
+
+  if (Role::keepAnswerTrail && m_keepAnswerTrail)
+  {
+    // Move the existing answer list to the Additional section.
+    // This feature is implemented to track the recursive operation and
+    // thus for debugging purposes. DnsResolutionTag traces resolutions
+    // without growing the messages.
+    NS_LOG_INFO ("Move the Existing recursive answer list in to additional section.");
+    const std::list<ResourceRecordHeader>& answerList = DnsHeader.GetAnswerList ();
 
+    for (std::list<ResourceRecordHeader>::const_iterator iter = answerList.begin ();
+         iter != answerList.end ();
+         iter++)
+    {
+      DnsHeader.AddARecord (*iter);
+    }
+    // Clear the existing answer list
+    DnsHeader.ClearAnswers ();
+  }
+  else if (DnsHeader.GetAnCount () != 0)
+  {
+    // Answers of the query are not echoed back
+    DnsHeader.ClearAnswers ();
+  }
+
+  // Answer from the zone data or refer the resolver to the next zone
+  bool answered = BuildZoneResponse (DnsHeader);
+  CountHeaderMemory (DnsHeader);
+
+  Ptr<Packet> response = Create<Packet> ();
+  response->AddHeader (DnsHeader);
+  if (cacheable)
+  {
+    StorePacketCache (cacheKey, DnsHeader, response, Role::rotateAnswers);
+  }
+  if (m_messageTagged)
+  {
+    TagReply (response, m_messageTag, m_messageArrival);
+  }
+  ReplyQuery (response, toAddress);
+
+  if (Role::rotateAnswers && answered)
+  {
     // Change the order of server according to the round robin algorithm
     m_nsCache.SwitchServersRoundRobin ();
   }
-  else
+}
+
+bool
+BindServer::MakePacketCacheKey (const DNSHeader& query, PacketCacheKey& key) const
+{
+  if (!m_enablePacketCache || query.GetQdCount () != 1 || query.GetAnCount () != 0 ||
+      query.GetNsCount () != 0 || query.GetArCount () != 0)
+  {
+    return false;
+  }
+
+  const std::list<QuestionSectionHeader>& questionList = query.GetQuestionList ();
+
+  key.qName = questionList.begin ()->GetqName ();
+  key.qType = questionList.begin ()->GetqType ();
+  key.qClass = questionList.begin ()->GetqClass ();
+  return true;
+}
+
+// Send a cached response with the ID and the RD bit of the new query patched
+// in; the other flags of the authoritative roles depend only on the role.
+// The answers of a role that rotates them are rotated by one record after
+// every hit, as the zone data is after every answer built from it. Entries
+// built from an older generation of the zone data are rebuilt by the caller.
+bool
+BindServer::ReplyFromPacketCache (const PacketCacheKey& key, const DNSHeader& query, Address toAddress)
+{
+  NS_LOG_FUNCTION (this << key.qName << query.GetId ());
+
+  PacketCacheI cached = m_packetCache.find (key);
+  if (cached == m_packetCache.end () || cached->second.generation != m_nsCache.GetGeneration ())
+  {
+    return false;
+  }
+
+  PacketCacheEntry& entry = cached->second;
+  std::vector<uint8_t>& response = entry.response;
+  response[0] = (query.GetId () >> 8) & 0xff;
+  response[1] = query.GetId () & 0xff;
+  response[2] = (response[2] & ~0x01) | (query.GetRDbit () ? 0x01 : 0x00);
+
+  NS_LOG_INFO ("Answer " << key.qName << " from the packet cache.");
+  Ptr<Packet> reply = Create<Packet> (&response[0], response.size ());
+  if (m_messageTagged)
+  {
+    TagReply (reply, m_messageTag, m_messageArrival);
+  }
+  ReplyQuery (reply, toAddress);
+
+  if (entry.answerSizes.size () > 1)
+  {
+    std::vector<uint8_t>::iterator answers = response.begin () + entry.answerOffset;
+    uint32_t answersSize = 0;
+    for (std::vector<uint32_t>::const_iterator it = entry.answerSizes.begin (); it != entry.answerSizes.end (); it++)
+    {
+      answersSize += *it;
+    }
+    std::rotate (answers, answers + entry.answerSizes.front (), answers + answersSize);
+    std::rotate (entry.answerSizes.begin (), entry.answerSizes.begin () + 1, entry.answerSizes.end ());
+  }
+  return true;
+}
+
+// The cache is bounded: when it is full the oldest response is dropped.
+void
+BindServer::StorePacketCache (const PacketCacheKey& key,
+                              const DNSHeader& response,
+                              Ptr<const Packet> packet,
+                              bool rotateAnswers)
+{
+  NS_LOG_FUNCTION (this << key.qName);
+
+  if (m_packetCacheSize == 0)
+  {
+    return;
+  }
+
+  PacketCacheI cached = m_packetCache.find (key);
+  if (cached == m_packetCache.end ())
   {
-    // TODO
-    // Send a reply contains RCODE = 3
+    if (m_packetCache.size () >= m_packetCacheSize)
+    {
+      m_packetCache.erase (m_packetCacheOrder.front ());
+      m_packetCacheOrder.pop_front ();
+    }
+    cached = m_packetCache.insert (std::make_pair (key, PacketCacheEntry ())).first;
+    m_packetCacheOrder.push_back (cached);
+  }
+
+  PacketCacheEntry& entry = cached->second;
+  entry.response.resize (packet->GetSize ());
+  packet->CopyData (&entry.response[0], entry.response.size ());
+  entry.generation = m_nsCache.GetGeneration ();
+
+  // Where the answers are, to rotate them on the hits
+  entry.answerOffset = DNS_HEADER_SIZE;
+  entry.answerSizes.clear ();
+  if (rotateAnswers && response.GetAnCount () > 1)
+  {
+    const std::list<QuestionSectionHeader>& questionList = response.GetQuestionList ();
+    for (std::list<QuestionSectionHeader>::const_iterator it = questionList.begin (); it != questionList.end (); it++)
+    {
+      entry.answerOffset += it->GetSerializedSize ();
+    }
+    const std::list<ResourceRecordHeader>& answerList = response.GetAnswerList ();
+    for (std::list<ResourceRecordHeader>::const_iterator it = answerList.begin (); it != answerList.end (); it++)
+    {
+      entry.answerSizes.push_back (it->GetSerializedSize ());
+    }
   }
 }
 
 void
-BindServer::SendQuery (Ptr<Packet> requestRecord, Address toAddress)
+BindServer::SendQuery (Ptr<Packet> requestRecord, Address toAddress, TransportType transport)
+{
+  if (m_holdOutput)
+  {
+    m_outputQueue.push_back (OutputEntry (requestRecord, toAddress, false, transport));
+    return;
+  }
+  DoSendQuery (requestRecord, toAddress, transport);
+}
+
+void
+BindServer::ReplyQuery (Ptr<Packet> nsQuery, Address toAddress)
+{
+  if (m_holdOutput)
+  {
+    m_outputQueue.push_back (OutputEntry (nsQuery, toAddress, true));
+    return;
+  }
+  DoReplyQuery (nsQuery, toAddress);
+}
+
+void
+BindServer::DoSendQuery (Ptr<Packet> requestRecord, Address toAddress, TransportType transport)
 {
   NS_LOG_FUNCTION (this << requestRecord << InetSocketAddress::ConvertFrom (toAddress).GetIpv4 () << InetSocketAddress::ConvertFrom (toAddress).GetPort ());
 
   NS_LOG_INFO ("Server " << m_localAddress << " send a reply to " << InetSocketAddress::ConvertFrom (toAddress).GetIpv4 ());
+  if (transport == TRANSPORT_TCP)
+  {
+    SendFramed (GetUpstreamConnection (toAddress), requestRecord);
+    return;
+  }
   m_socket->SendTo (requestRecord, 0, toAddress);
 }
 
 void
-BindServer::ReplyQuery (Ptr<Packet> nsQuery, Address toAddress)
+BindServer::DoReplyQuery (Ptr<Packet> nsQuery, Address toAddress)
 {
   NS_LOG_FUNCTION (this << nsQuery << InetSocketAddress::ConvertFrom (toAddress).GetIpv4 () << InetSocketAddress::ConvertFrom (toAddress).GetPort ());
 
   NS_LOG_INFO ("Server " << m_localAddress << " send a reply to " << InetSocketAddress::ConvertFrom (toAddress).GetIpv4 ());
+  m_replies++;
+
+  // The reply of a traced resolution leaves now
+  DnsResolutionTag tag;
+  bool tagged = nsQuery->PeekPacketTag (tag);
+  if (tagged)
+  {
+    tag.SetDeparture (Simulator::Now ());
+    nsQuery->ReplacePacketTag (tag);
+  }
+  m_replyTrace (nsQuery, toAddress);
+  DNS_TRACE_EVENT (&m_eventTrace,
+                   DnsTraceEvent::REPLY,
+                   0,
+                   0,
+                   TraceAddress (toAddress),
+                   TraceTransactionId (nsQuery),
+                   TraceSize (nsQuery),
+                   0);
+
+  // Queries that arrived over TCP are answered on the same connection.
+  TcpSocketMapI peer = m_tcpPeers.find (toAddress);
+  if (peer != m_tcpPeers.end ())
+  {
+    SendFramed (peer->second, nsQuery);
+    return;
+  }
+
+  if (m_maxUdpPayloadSize != 0 && nsQuery->GetSize () > m_maxUdpPayloadSize)
+  {
+    NS_LOG_INFO ("Reply does not fit in " << m_maxUdpPayloadSize << " bytes. Truncating.");
+
+    DNSHeader DnsHeader;
+    nsQuery->PeekHeader (DnsHeader);
+    DnsHeader.ClearAnswers ();
+    DnsHeader.ClearNsRecords ();
+    DnsHeader.ClearArList ();
+    DnsHeader.SetTCbit (1);
+
+    nsQuery = Create<Packet> ();
+    nsQuery->AddHeader (DnsHeader);
+    if (tagged)
+    {
+      nsQuery->AddPacketTag (tag);
+    }
+  }
   m_socket->SendTo (nsQuery, 0, toAddress);
 }
 }
@@ -1,14 +1,23 @@
 #ifndef BIND_SERVER_H
 #define BIND_SERVER_H
 
+#include <deque>
+
 #include "ns3/address.h"
 #include "ns3/application.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 
+#include "ns3/dns-event-trace.h"
 #include "ns3/dns-header.h"
+#include "ns3/dns-pending-table.h"
+#include "ns3/dns-resolution-tag.h"
+#include "ns3/dns-upstream-selector.h"
 #include "ns3/dns.h"
+#include "ns3/nstime.h"
 
 #define DNS_PORT 53
 namespace ns3
@@ -38,14 +47,48 @@ public:
     RA_UNAVAILABLE = 0x02,
   };
 
+  /**
+   * /brief Transport used by the resolver roles to contact upstream servers */
+  enum TransportType
+  {
+    TRANSPORT_UDP = 0x01,  //!< One datagram per message
+    TRANSPORT_TCP = 0x02,  //!< Pooled, length-framed stream connections
+  };
+
+  /**
+   * /brief What happens to a message that finds the input queue full */
+  enum OverflowAction
+  {
+    OVERFLOW_DROP = 0x01,      //!< Discard the message silently
+    OVERFLOW_SERVFAIL = 0x02,  //!< Answer queries with SERVFAIL at once
+  };
+
   static TypeId GetTypeId (void);
   BindServer (void);
   virtual ~BindServer ();
   void
   DoDispose (void)
   {
+    m_nsCache.ReleaseInstance (m_lookupScratch);
     m_nsCache.DoDispose ();
+    m_delegationCache.DoDispose ();
     m_socket = 0;
+    m_tcpSocket = 0;
+    m_tcpConnections.clear ();
+    m_tcpPeers.clear ();
+    m_upstreamPool.clear ();
+    m_packetCache.clear ();
+    m_packetCacheOrder.clear ();
+    m_pendingQueries.Clear ();
+    m_upstreamSelector.Clear ();
+    m_hotNames.clear ();
+    m_multiQuestionRequests.clear ();
+    m_inputQueue.clear ();
+    for (std::vector<Worker>::iterator it = m_workers.begin (); it != m_workers.end (); it++)
+    {
+      it->completion.Cancel ();
+    }
+    m_workers.clear ();
   }
 
   void AddZone (std::string zone_name,
@@ -54,35 +97,412 @@ public:
                 uint16_t type,
                 std::string rData);
 
+  /**
+   * /brief Add a root server replica. The Local server chooses among the
+   * RootServerAddress and the added replicas by smoothed RTT. */
+  void AddRootServer (Ipv4Address address);
+
+  /**
+   * /brief Assign a fixed random variable stream to the upstream server
+   * selection of the resolver roles
+   * /returns the number of streams used */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * /brief Get the number of questions of the given type received in client queries */
+  uint64_t GetQueries (uint16_t qType) const;
+
+  /**
+   * /brief Write a binary dump of the event trace, see DnsEventTrace::Decode.
+   * Empty unless EventTraceSize is set and the module is configured with
+   * --enable-dns-event-trace. */
+  void WriteEventTrace (std::ostream& os) const;
+
+  /**
+   * /brief Write the memory taken by the caches, the pending resolutions and
+   * the message headers of the server, e.g., at the end of a run */
+  void WriteMemoryReport (std::ostream& os) const;
+
+  /**
+   * /brief Signature of the Query and CacheEviction trace sources */
+  typedef void (*QuestionTracedCallback) (const std::string& qName, uint16_t qType);
+
+  /**
+   * /brief Signature of the CacheHit and CacheMiss trace sources */
+  typedef void (*NameTracedCallback) (const std::string& qName);
+
+  /**
+   * /brief Signature of the UpstreamQuery trace source */
+  typedef void (*UpstreamTracedCallback) (Ptr<const Packet> query, Ipv4Address server);
+
+  /**
+   * /brief Signature of the Resolution trace source
+   * /param qName the name that was resolved
+   * /param rcode the response code sent to the clients
+   * /param upstreamQueries queries sent upstream for the resolution
+   * /param duration time from the first client query to the answer */
+  typedef void (*ResolutionTracedCallback) (const std::string& qName,
+                                            uint8_t rcode,
+                                            uint32_t upstreamQueries,
+                                            Time duration);
+
 private:
   virtual void StartApplication (void);
   virtual void StopApplication (void);
 
-  void SendQuery (Ptr<Packet> requestRecord, Address toAddress);
+  void SendQuery (Ptr<Packet> requestRecord, Address toAddress, TransportType transport);
   void HandleQuery (Ptr<Socket> socket);
+  void ProcessBatch (void);
+  void DispatchMessage (DNSHeader& DnsHeader, Address from);
+
+  // Processing model: messages wait in a bounded input queue and are served
+  // by a fixed number of simulated workers. Each message occupies a worker
+  // for a service time that depends on its kind, and the packets it produces
+  // leave the server when its service ends.
+  void EnqueueMessage (Ptr<Packet> message, Address from);
+  void StartService (void);
+  void FinishService (uint32_t worker);
 
-  void LocalServerService (Ptr<Packet> nsQuery, Address toAddress);
-  void RootServerService (Ptr<Packet> nsQuery, Address toAddress);
-  void TLDServerService (Ptr<Packet> nsQuery, Address toAddress);
-  void ISPServerService (Ptr<Packet> nsQuery, Address toAddress);
-  void AuthServerService (Ptr<Packet> nsQuery, Address toAddress);
+  // DNS over TCP (RFC 7766): every message is preceded by a two-byte length
+  // field, so several queries can be pipelined on one persistent connection.
+  bool HandleTcpConnectionRequest (Ptr<Socket> socket, const Address& from);
+  void HandleTcpAccept (Ptr<Socket> socket, const Address& from);
+  void HandleTcpRead (Ptr<Socket> socket);
+  void HandleTcpSend (Ptr<Socket> socket, uint32_t available);
+  void HandleTcpClose (Ptr<Socket> socket);
+  void HandleUpstreamConnected (Ptr<Socket> socket);
+  void HandleUpstreamConnectionFailed (Ptr<Socket> socket);
+  Ptr<Socket> GetUpstreamConnection (Address upstream);
+  void SendFramed (Ptr<Socket> socket, Ptr<Packet> message);
+  void FlushTcpQueue (Ptr<Socket> socket);
+  void CloseTcpConnection (Ptr<Socket> socket);
+
+  // Roles. Every role serves the messages through its own handler, which is
+  // bound once when the application starts.
+  typedef void (BindServer::*ServiceHandler) (DNSHeader& DnsHeader, Address toAddress);
+  void BindService (void);
+
+  /// The Local name server resolves names on behalf of its clients
+  void LocalServerService (DNSHeader& DnsHeader, Address toAddress);
+
+  // Compile-time traits of the roles serving zone data. A role with both
+  // usePacketCache and rotateAnswers has the answers of its cached responses
+  // rotated on every hit, since SwitchServersRoundRobin only reorders the
+  // zone data after the answers built from it and leaves the SRVTable
+  // generation, and so the cached responses, alone.
+
+  /// Root name server: refers resolvers to the TLD servers
+  struct RootServer
+  {
+    static const bool usePacketCache = true;    //!< reuse encoded responses
+    static const bool keepAnswerTrail = false;  //!< honour KeepAnswerTrail
+    static const bool rotateAnswers = false;    //!< round-robin the records after an answer
+  };
+  /// Top-level domain server: refers resolvers to the second level domains
+  struct TldServer
+  {
+    static const bool usePacketCache = true;
+    static const bool keepAnswerTrail = false;
+    static const bool rotateAnswers = false;
+  };
+  /// ISP's name server: answers from its records or refers to the Authoritative servers
+  struct IspServer
+  {
+    static const bool usePacketCache = false;
+    static const bool keepAnswerTrail = true;
+    static const bool rotateAnswers = true;
+  };
+  /// Authoritative name server: answers with the content servers of a name
+  struct AuthServer
+  {
+    static const bool usePacketCache = true;
+    static const bool keepAnswerTrail = true;
+    static const bool rotateAnswers = true;
+  };
+
+  template <class Role>
+  void ZoneServerService (DNSHeader& DnsHeader, Address toAddress);
 
   void ReplyQuery (Ptr<Packet> replyPacket, Address toAddress);
 
-  typedef std::map<std::string, Address> QueryList;  // FIXME Add an expiration timer
-  typedef std::map<std::string, Address>::iterator QueryListI;
-  typedef std::map<std::string, Address>::const_iterator QueryListCI;
+  // Pending resolutions of the Local server. Each upstream query carries
+  // its own transaction ID and is retransmitted with exponential backoff.
+  uint16_t NextTransactionId (void);
+  void SendPendingQuery (uint32_t handle, Ptr<Packet> request, const std::vector<Ipv4Address>& servers);
+  void HandleQueryTimeout (uint32_t handle);
+  void AddPendingClient (uint32_t handle, Address client, uint16_t id, uint32_t request);
+  void ReplyPendingClients (uint32_t handle, DNSHeader& reply);
+  void CompleteResolution (uint32_t handle, uint8_t rcode, const std::list<ResourceRecordHeader>& answers);
+  void CacheRecord (SRVTable& table, const ResourceRecordHeader& record);
+  void SendUpstream (uint32_t handle, Ptr<Packet> request, Ipv4Address upstream);
+  void HandleCacheEviction (const SRVRecordEntry& record);
+
+  // Resolution tags: the tag of the message being served is taken off the
+  // packet before the message is dispatched, and replies to tagged queries
+  // carry it on with a hop of this server.
+  void TakeResolutionTag (Ptr<Packet> message, Time arrival);
+  void TagReply (Ptr<Packet> reply, const DnsResolutionTag& tag, Time arrival);
+
+  // Memory accounting, read through the attributes and WriteMemoryReport
+  uint64_t GetCacheMemory (void) const;
+  uint64_t GetCacheMemoryPeak (void) const;
+  uint64_t GetDelegationCacheMemory (void) const;
+  uint64_t GetDelegationCacheMemoryPeak (void) const;
+  uint64_t GetPendingQueryMemory (void) const;
+  uint64_t GetHeaderMemory (void) const;
+  void CountHeaderMemory (const DNSHeader& header);
 
-  QueryList m_recursiveQueryList;  //!< This is only needed when the
-                                   //   the server supports recursive quering
-                                   // FIXME Add an expiration timer
-  SRVTable m_nsCache;              //!< the Cache for nameserver records
+  /// A client query with several questions, answered once all of them are
+  struct MultiQuestionRequest
+  {
+    Address client;                              //!< where the answer goes
+    uint16_t id;                                 //!< transaction ID of the client query
+    std::list<QuestionSectionHeader> questions;  //!< the questions, as asked
+    std::list<ResourceRecordHeader> answers;     //!< answers collected so far
+    uint32_t distinctQuestions;                  //!< questions that are not repeated
+    uint32_t outstanding;                        //!< questions still being resolved
+    uint32_t failures;                           //!< questions that could not be answered
+    uint8_t rcode;                               //!< response code of the last failure
+    bool tagged;                                 //!< the query carried a resolution tag
+    DnsResolutionTag tag;                        //!< the tag, with the hops of the resolutions
+    Time arrival;                                //!< when the query arrived
+  };
+
+  typedef std::map<uint32_t, MultiQuestionRequest> MultiQuestionRequestList;
+  typedef std::map<uint32_t, MultiQuestionRequest>::iterator MultiQuestionRequestI;
+
+  // Every question of a client query is answered from the cache or resolved
+  // on its own; the resolutions of one query run in parallel.
+  bool ResolveQuestion (const QuestionSectionHeader& question,
+                        Address client,
+                        uint16_t id,
+                        uint32_t request,
+                        std::list<ResourceRecordHeader>& answers,
+                        uint8_t& rcode);
+  void ReplyClient (DNSHeader& query, Address client, uint8_t rcode, const std::list<ResourceRecordHeader>& answers);
+  void AddRequestResult (MultiQuestionRequest& request, uint8_t rcode, const std::list<ResourceRecordHeader>& answers);
+  void FinishMultiQuestionRequest (uint32_t requestId);
+
+  // Referrals: servers answer from their zone data or refer the resolver to
+  // the deepest zone cut they know, with NS records and glue. Every replica
+  // of a zone is returned, and the Local server picks one by smoothed RTT.
+  bool FindZoneCut (SRVTable& table,
+                    const std::string& qName,
+                    std::string& zone,
+                    std::list<ResourceRecordHeader>& nsRecords,
+                    std::list<ResourceRecordHeader>& glue);
+  bool BuildZoneResponse (DNSHeader& DnsHeader);
+
+  // Hedging: a late upstream query is repeated to a second replica
+  void HandleHedge (uint32_t handle);
+  void UpdateHotNames (const std::string& qName);
+  bool IsHotName (const std::string& qName) const;
+
+  /// Space-Saving counter of a frequently queried name
+  struct HotNameCounter
+  {
+    uint64_t count;  //!< queries counted for the name
+    uint64_t error;  //!< overestimation inherited from the name it replaced
+  };
+
+  typedef std::map<std::string, HotNameCounter> HotNameMap;
+  typedef std::map<std::string, HotNameCounter>::iterator HotNameMapI;
+  typedef std::map<std::string, HotNameCounter>::const_iterator HotNameMapCI;
+
+  /// Key of the packet cache: the question a cached response answers
+  struct PacketCacheKey
+  {
+    std::string qName;
+    uint16_t qType;
+    uint16_t qClass;
+
+    bool
+    operator< (const PacketCacheKey& other) const
+    {
+      if (qName != other.qName)
+      {
+        return qName < other.qName;
+      }
+      if (qType != other.qType)
+      {
+        return qType < other.qType;
+      }
+      return qClass < other.qClass;
+    }
+  };
+
+  /// An encoded response and the zone generation it was built from
+  struct PacketCacheEntry
+  {
+    std::vector<uint8_t> response;
+    uint64_t generation;
+    uint32_t answerOffset;              //!< where the answer section starts in the response
+    std::vector<uint32_t> answerSizes;  //!< sizes of the answers, in order, if they are rotated
+  };
+
+  typedef std::map<PacketCacheKey, PacketCacheEntry> PacketCache;
+  typedef std::map<PacketCacheKey, PacketCacheEntry>::iterator PacketCacheI;
+
+  bool MakePacketCacheKey (const DNSHeader& query, PacketCacheKey& key) const;
+  bool ReplyFromPacketCache (const PacketCacheKey& key, const DNSHeader& query, Address toAddress);
+  void StorePacketCache (const PacketCacheKey& key,
+                         const DNSHeader& response,
+                         Ptr<const Packet> packet,
+                         bool rotateAnswers);
+
+  void DoSendQuery (Ptr<Packet> requestRecord, Address toAddress, TransportType transport);
+  void DoReplyQuery (Ptr<Packet> replyPacket, Address toAddress);
+
+  /// A message received in the current batch and the address it came from
+  typedef std::vector<std::pair<Ptr<Packet>, Address> > MessageBatch;
+
+  /// An outgoing message held back until the current batch has been served
+  struct OutputEntry
+  {
+    OutputEntry (Ptr<Packet> p, Address to, bool reply, TransportType t = TRANSPORT_UDP)
+      : packet (p),
+        toAddress (to),
+        isReply (reply),
+        transport (t)
+    {
+    }
+    Ptr<Packet> packet;
+    Address toAddress;
+    bool isReply;             //!< reply to a client (true) or upstream query (false)
+    TransportType transport;  //!< transport of an upstream query
+  };
+  typedef std::vector<OutputEntry> OutputQueue;
+  typedef std::vector<OutputEntry>::iterator OutputQueueI;
+
+  void EmitOutput (OutputQueue& output);
+
+  /// A message waiting for a worker
+  struct QueuedMessage
+  {
+    Ptr<Packet> packet;
+    Address from;
+    Time arrival;  //!< when the message entered the queue
+  };
+
+  /// A simulated worker thread and the message it is serving
+  struct Worker
+  {
+    EventId completion;   //!< end of the current service; not running when idle
+    OutputQueue output;   //!< packets sent when the service ends
+    Time arrival;         //!< when the message being served entered the queue
+  };
+
+  /// State kept for every open DNS-over-TCP connection
+  struct TcpConnection
+  {
+    Address peer;                     //!< remote end of the connection
+    Ptr<Packet> rxBuffer;             //!< bytes received but not yet deframed
+    std::list<Ptr<Packet> > txQueue;  //!< framed messages waiting for buffer space
+    bool connected;                   //!< false until an upstream connect completes
+  };
+
+  typedef std::map<Ptr<Socket>, TcpConnection> TcpConnectionList;
+  typedef std::map<Ptr<Socket>, TcpConnection>::iterator TcpConnectionI;
+
+  typedef std::map<Address, Ptr<Socket> > TcpSocketMap;
+  typedef std::map<Address, Ptr<Socket> >::iterator TcpSocketMapI;
+
+  PendingQueryTable m_pendingQueries;  //!< This is only needed when the
+                                       //   the server supports recursive quering
+  uint32_t m_maxPendingQueries;        //!< capacity of the pending table
+  Time m_queryTimeout;                 //!< initial retransmission timeout
+  uint32_t m_maxRetransmissions;       //!< retransmissions before answering SERVFAIL
+  uint16_t m_nextTransactionId;        //!< next ID for upstream queries
+  bool m_enableCoalescing;             //!< share in-flight resolutions between clients
+  MultiQuestionRequestList m_multiQuestionRequests;  //!< client queries with several questions
+  uint32_t m_nextRequestId;            //!< key of the next multi-question request (never 0)
+  uint32_t m_maxReferrals;             //!< referrals followed by one resolution
+  SRVTable m_nsCache;                  //!< the Cache for nameserver records
+  SRVTable m_delegationCache;          //!< NS records and glue learned from referrals
   Ipv4Address m_localAddress;
   Ipv4Mask m_netMask;
   RAType m_raType;
   ServerType m_serverType;
+  ServiceHandler m_service;             //!< service of the role, bound at start
   Ptr<Socket> m_socket;
+  Ptr<Socket> m_tcpSocket;             //!< listening socket for DNS over TCP
+  bool m_enableTcp;                    //!< accept queries over TCP as well as UDP
+  TransportType m_upstreamTransport;   //!< transport for upstream queries
+  uint32_t m_maxUdpPayloadSize;        //!< larger UDP replies are truncated (0: no limit)
+  TcpConnectionList m_tcpConnections;  //!< all open TCP connections (accepted and upstream)
+  TcpSocketMap m_tcpPeers;             //!< clients connected to the listener, by address
+  TcpSocketMap m_upstreamPool;         //!< reusable upstream connections, by server address
+
+  uint32_t m_maxBatchSize;               //!< datagrams served per batch
+  MessageBatch m_batch;                  //!< messages of the batch being served
+  std::vector<DNSHeader> m_batchHeaders;  //!< parsed headers, reused across batches
+  OutputQueue m_outputQueue;             //!< replies and queries held until the batch ends
+  bool m_holdOutput;                     //!< true while a batch is being served
+  SRVTable::SRVRecordInstance m_lookupScratch;  //!< record copies of the last lookup
+  DnsResolutionTag m_messageTag;         //!< resolution tag of the message being served
+  bool m_messageTagged;                  //!< the message being served carried m_messageTag
+  Time m_messageArrival;                 //!< when the message being served arrived
+
+  bool m_enableProcessingModel;          //!< serve messages through the queue and workers
+  uint32_t m_workerCount;                //!< simulated worker threads
+  uint32_t m_maxQueueLength;             //!< capacity of the input queue
+  OverflowAction m_overflowAction;       //!< handling of messages that find the queue full
+  Time m_cacheHitServiceTime;            //!< service time of a query answered from a cache
+  Time m_cacheMissServiceTime;           //!< service time of a query that misses the caches
+  Time m_responseServiceTime;            //!< service time of an upstream response
+  std::deque<QueuedMessage> m_inputQueue;  //!< messages waiting for a worker
+  std::vector<Worker> m_workers;         //!< the simulated workers
+  uint32_t m_cacheMisses;                //!< questions of the message being served that missed the caches
+  TracedValue<uint32_t> m_queueLength;   //!< messages in the input queue
+  TracedCallback<Time> m_sojournTrace;   //!< time from arrival to the end of service, per message
+  TracedCallback<Ptr<const Packet>, const Address&> m_queueDropTrace;  //!< messages rejected by a full queue
+
+  // Metrics
+  typedef std::map<uint16_t, uint64_t> QueryTypeCounters;
+  typedef std::map<uint16_t, uint64_t>::const_iterator QueryTypeCountersCI;
+
+  uint64_t m_queries;                  //!< questions received in client queries
+  QueryTypeCounters m_queriesByType;   //!< questions received, by type
+  uint64_t m_cacheHitCount;            //!< questions answered from the record or packet cache
+  uint64_t m_cacheMissCount;           //!< questions that missed the record or packet cache
+  uint64_t m_upstreamQueries;          //!< queries sent upstream
+  uint64_t m_replies;                  //!< replies sent to clients
+  uint64_t m_unmatchedResponses;       //!< upstream responses that matched no pending resolution
+  uint64_t m_queueDrops;               //!< messages that found the input queue full
+  uint64_t m_cacheEvictions;           //!< records expired from the cache
+  uint64_t m_headerMemoryPeak;         //!< largest memory of a message header parsed or built
+  TracedValue<uint32_t> m_pendingSize;  //!< resolutions in progress
+  TracedValue<uint32_t> m_cacheSize;    //!< records in the cache
+  TracedCallback<const std::string&, uint16_t> m_queryTrace;       //!< a question of a client query
+  TracedCallback<const std::string&> m_cacheHitTrace;              //!< a question answered from a cache
+  TracedCallback<const std::string&> m_cacheMissTrace;             //!< a question that missed the caches
+  TracedCallback<Ptr<const Packet>, Ipv4Address> m_upstreamTrace;  //!< a query sent upstream
+  TracedCallback<Ptr<const Packet>, const Address&> m_replyTrace;  //!< a reply sent to a client
+  TracedCallback<const std::string&, uint8_t, uint32_t, Time> m_resolutionTrace;  //!< a finished resolution
+  TracedCallback<const std::string&, uint16_t> m_evictionTrace;   //!< a record expired from the cache
+  uint32_t m_eventTraceSize;           //!< events kept in the event trace (0: disabled)
+#ifdef DNS_EVENT_TRACE
+  DnsEventTrace m_eventTrace;          //!< binary trace of the query path
+#endif
+
+  bool m_enablePacketCache;   //!< reuse encoded responses of the authoritative roles
+  bool m_keepAnswerTrail;     //!< move answers of queries to the additional section
+  uint32_t m_packetCacheSize;  //!< maximum number of cached responses
+  PacketCache m_packetCache;   //!< encoded responses by question
+  std::deque<PacketCacheI> m_packetCacheOrder;  //!< the cached responses, oldest first
   Ipv4Address m_rootAddress;  //!< Root ns's address. Only needed for the local Name server
+  std::vector<Ipv4Address> m_rootReplicas;  //!< further root servers added with AddRootServer
+  UpstreamSelector m_upstreamSelector;      //!< SRTT of every upstream server
+  double m_srttDecay;                       //!< decay of the servers passed over
+  double m_probeProbability;                //!< chance of probing a slower server
+
+  bool m_enableHedging;       //!< repeat late upstream queries to a second replica
+  double m_hedgeDelayFactor;  //!< hedge delay as a multiple of the SRTT
+  Time m_minHedgeDelay;       //!< lower bound of the hedge delay
+  uint32_t m_hedgeTopNames;   //!< most queried names hedged without delay
+  HotNameMap m_hotNames;      //!< counters of the most queried names
+  uint64_t m_hedgedQueries;   //!< queries sent to a second server
+  uint64_t m_hedgeWins;       //!< hedged queries answered first by the second server
 };
 }
 #endif /* BIND_SERVER_H */
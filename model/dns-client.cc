@@ -0,0 +1,468 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include <cmath>
+
+#include "dns-client.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/dns-header.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/socket-factory.h"
+#include "ns3/socket.h"
+#include "ns3/uinteger.h"
+
+#include "ns3/bind-server.h"
+
+NS_LOG_COMPONENT_DEFINE ("DnsClient");
+
+namespace ns3
+{
+NS_OBJECT_ENSURE_REGISTERED (DnsClient);
+
+TypeId
+DnsClient::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DnsClient")
+                        .SetParent<Application> ()
+                        .AddConstructor<DnsClient> ()
+                        .AddAttribute ("ArrivalProcess",
+                                       "How the sending times of the queries are chosen.",
+                                       EnumValue (DnsClient::ARRIVAL_POISSON),
+                                       MakeEnumAccessor (&DnsClient::m_arrivalProcess),
+                                       MakeEnumChecker (DnsClient::ARRIVAL_POISSON, "Poisson",
+                                                        DnsClient::ARRIVAL_TRACE, "Trace"))
+                        .AddAttribute ("QueryRate",
+                                       "Mean number of Poisson queries per second.",
+                                       DoubleValue (100),
+                                       MakeDoubleAccessor (&DnsClient::m_queryRate),
+                                       MakeDoubleChecker<double> (0))
+                        .AddAttribute ("ZipfExponent",
+                                       "Exponent of the Zipf distribution of the name popularity "
+                                       "(0: every name is equally popular).",
+                                       DoubleValue (0.9),
+                                       MakeDoubleAccessor (&DnsClient::m_zipfExponent),
+                                       MakeDoubleChecker<double> (0))
+                        .AddAttribute ("MaxQueries",
+                                       "Number of queries to send (0: no limit).",
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&DnsClient::m_maxQueries),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("MaxOutstanding",
+                                       "Maximum number of queries waiting for an answer. New queries are "
+                                       "skipped while the limit is reached.",
+                                       UintegerValue (1024),
+                                       MakeUintegerAccessor (&DnsClient::m_maxOutstanding),
+                                       MakeUintegerChecker<uint32_t> (1, 65535))
+                        .AddAttribute ("Timeout",
+                                       "Time to wait for an answer before the query is sent again.",
+                                       TimeValue (Seconds (1)),
+                                       MakeTimeAccessor (&DnsClient::m_timeout),
+                                       MakeTimeChecker ())
+                        .AddAttribute ("MaxRetries",
+                                       "Retransmissions of a query, each to the next resolver, before it fails.",
+                                       UintegerValue (2),
+                                       MakeUintegerAccessor (&DnsClient::m_maxRetries),
+                                       MakeUintegerChecker<uint32_t> ())
+                        .AddAttribute ("QueryType",
+                                       "Type of the records asked for.",
+                                       UintegerValue (RR_TYPE_A),
+                                       MakeUintegerAccessor (&DnsClient::m_qType),
+                                       MakeUintegerChecker<uint16_t> ())
+                        .AddAttribute ("EnableResolutionTag",
+                                       "Tag the queries with a DnsResolutionTag, so that the servers "
+                                       "record the time spent at every hop of the resolution.",
+                                       BooleanValue (false),
+                                       MakeBooleanAccessor (&DnsClient::m_enableResolutionTag),
+                                       MakeBooleanChecker ())
+                        .AddAttribute ("QueriesSent",
+                                       "Number of queries sent, not counting retransmissions.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&DnsClient::m_queriesSent),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("QueriesAnswered",
+                                       "Number of queries answered.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&DnsClient::m_queriesAnswered),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("QueriesFailed",
+                                       "Number of queries that were not answered after all retries.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&DnsClient::m_queriesFailed),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddAttribute ("QueriesSkipped",
+                                       "Number of queries not sent because MaxOutstanding was reached.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&DnsClient::m_queriesSkipped),
+                                       MakeUintegerChecker<uint64_t> ())
+                        .AddTraceSource ("Latency",
+                                         "A query was answered.",
+                                         MakeTraceSourceAccessor (&DnsClient::m_latencyTrace),
+                                         "ns3::DnsClient::LatencyTracedCallback")
+                        .AddTraceSource ("Timeout",
+                                         "A query was not answered after all retries.",
+                                         MakeTraceSourceAccessor (&DnsClient::m_timeoutTrace),
+                                         "ns3::DnsClient::TimeoutTracedCallback")
+                        .AddTraceSource ("Outcome",
+                                         "A query was answered or given up.",
+                                         MakeTraceSourceAccessor (&DnsClient::m_outcomeTrace),
+                                         "ns3::DnsClient::OutcomeTracedCallback")
+                        .AddTraceSource ("Tx",
+                                         "A query was transmitted.",
+                                         MakeTraceSourceAccessor (&DnsClient::m_txTrace),
+                                         "ns3::Packet::TracedCallback")
+                        .AddTraceSource ("Rx",
+                                         "A reply was received.",
+                                         MakeTraceSourceAccessor (&DnsClient::m_rxTrace),
+                                         "ns3::Packet::TracedCallback");
+  return tid;
+}
+
+DnsClient::DnsClient ()
+  : m_nextResolver (0),
+    m_nextScheduledQuery (0),
+    m_nextId (0),
+    m_socket (0),
+    m_queriesSent (0),
+    m_queriesAnswered (0),
+    m_queriesFailed (0),
+    m_queriesSkipped (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_uniform = CreateObject<UniformRandomVariable> ();
+  m_interArrival = CreateObject<ExponentialRandomVariable> ();
+}
+
+DnsClient::~DnsClient ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DnsClient::AddResolver (Ipv4Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  m_resolvers.push_back (address);
+}
+
+void
+DnsClient::AddName (const std::string& name)
+{
+  NS_LOG_FUNCTION (this << name);
+  m_names.push_back (name);
+}
+
+void
+DnsClient::AddScheduledQuery (Time at, const std::string& name)
+{
+  NS_LOG_FUNCTION (this << at << name);
+  m_scheduledQueries.push_back (std::make_pair (at, name));
+}
+
+int64_t
+DnsClient::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_uniform->SetStream (stream);
+  m_interArrival->SetStream (stream + 1);
+  return 2;
+}
+
+void
+DnsClient::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_socket = 0;
+  m_outstanding.clear ();
+  Application::DoDispose ();
+}
+
+void
+DnsClient::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ABORT_MSG_IF (m_resolvers.empty (), "DnsClient needs a resolver. Hint: AddResolver. Aborting");
+
+  if (m_socket == 0)
+  {
+    m_socket = Socket::CreateSocket (GetNode (), TypeId::LookupByName ("ns3::UdpSocketFactory"));
+    m_socket->Bind ();
+  }
+  m_socket->SetRecvCallback (MakeCallback (&DnsClient::HandleRead, this));
+
+  m_nextId = m_uniform->GetInteger (0, 65535);
+
+  if (m_arrivalProcess == ARRIVAL_TRACE)
+  {
+    std::stable_sort (m_scheduledQueries.begin (), m_scheduledQueries.end ());
+    m_nextScheduledQuery = 0;
+    if (!m_scheduledQueries.empty ())
+    {
+      m_sendEvent = Simulator::Schedule (m_scheduledQueries.front ().first, &DnsClient::SendScheduledQuery, this);
+    }
+    return;
+  }
+
+  NS_ABORT_MSG_IF (m_names.empty (), "DnsClient needs names to query. Hint: AddName. Aborting");
+
+  // Cumulative distribution of the popularity, searched for every query.
+  // Weights are 1/rank^s, normalized so that the last entry is one.
+  m_popularity.resize (m_names.size ());
+  double total = 0;
+  for (uint32_t rank = 0; rank < m_names.size (); rank++)
+  {
+    total += 1 / std::pow (rank + 1.0, m_zipfExponent);
+    m_popularity[rank] = total;
+  }
+  for (uint32_t rank = 0; rank < m_popularity.size (); rank++)
+  {
+    m_popularity[rank] /= total;
+  }
+  ScheduleNextQuery ();
+}
+
+void
+DnsClient::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_sendEvent.Cancel ();
+  for (OutstandingQueryI it = m_outstanding.begin (); it != m_outstanding.end (); it++)
+  {
+    it->second.timeoutEvent.Cancel ();
+  }
+  m_outstanding.clear ();
+  if (m_socket != 0)
+  {
+    m_socket->Close ();
+    m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+  }
+}
+
+void
+DnsClient::ScheduleNextQuery (void)
+{
+  if (m_queryRate <= 0 || (m_maxQueries != 0 && m_queriesSent + m_queriesSkipped >= m_maxQueries))
+  {
+    return;
+  }
+  Time interArrival = Seconds (m_interArrival->GetValue (1 / m_queryRate, 0));
+  m_sendEvent = Simulator::Schedule (interArrival, &DnsClient::SendNextQuery, this);
+}
+
+void
+DnsClient::Query (const std::string& qName, uint16_t qType, uint64_t tag)
+{
+  NS_LOG_FUNCTION (this << qName << qType << tag);
+
+  if (m_socket == 0)
+  {
+    NS_LOG_INFO ("Client not started. Dropping the query for " << qName);
+    return;
+  }
+  SendQuery (qName, qType, tag);
+}
+
+void
+DnsClient::SendNextQuery (void)
+{
+  SendQuery (DrawName (), m_qType, 0);
+  ScheduleNextQuery ();
+}
+
+// Send the scheduled query that is due and schedule the one after it
+void
+DnsClient::SendScheduledQuery (void)
+{
+  const std::pair<Time, std::string>& due = m_scheduledQueries[m_nextScheduledQuery++];
+  SendQuery (due.second, m_qType, 0);
+
+  if (m_nextScheduledQuery < m_scheduledQueries.size () &&
+      (m_maxQueries == 0 || m_queriesSent + m_queriesSkipped < m_maxQueries))
+  {
+    m_sendEvent = Simulator::Schedule (m_scheduledQueries[m_nextScheduledQuery].first - due.first,
+                                       &DnsClient::SendScheduledQuery,
+                                       this);
+  }
+}
+
+const std::string&
+DnsClient::DrawName (void)
+{
+  std::vector<double>::const_iterator rank =
+      std::upper_bound (m_popularity.begin (), m_popularity.end (), m_uniform->GetValue (0, 1));
+  if (rank == m_popularity.end ())
+  {
+    rank--;
+  }
+  return m_names[rank - m_popularity.begin ()];
+}
+
+// Transaction IDs are taken in sequence from a random start, skipping the
+// ones still in use.
+bool
+DnsClient::AllocateId (uint16_t& id)
+{
+  if (m_outstanding.size () >= m_maxOutstanding)
+  {
+    return false;
+  }
+  while (m_outstanding.find (m_nextId) != m_outstanding.end ())
+  {
+    m_nextId++;
+  }
+  id = m_nextId++;
+  return true;
+}
+
+void
+DnsClient::SendQuery (const std::string& qName, uint16_t qType, uint64_t tag)
+{
+  NS_LOG_FUNCTION (this << qName << qType);
+
+  uint16_t id;
+  if (!AllocateId (id))
+  {
+    NS_LOG_INFO ("Too many outstanding queries. Skipping " << qName);
+    m_queriesSkipped++;
+    return;
+  }
+
+  QuestionSectionHeader question;
+  question.SetqName (qName);
+  question.SetqType (qType);
+  question.SetqClass (1);
+
+  DNSHeader header;
+  header.SetId (id);
+  header.SetQRbit (1);
+  header.SetRDbit (1);
+  header.AddQuestion (question);
+
+  OutstandingQuery& query = m_outstanding[id];
+  query.qName = qName;
+  query.qType = qType;
+  query.tag = tag;
+  query.firstSent = Simulator::Now ();
+  query.retries = 0;
+  query.resolver = m_nextResolver;
+  query.request = Create<Packet> ();
+  query.request->AddHeader (header);
+
+  m_nextResolver = (m_nextResolver + 1) % m_resolvers.size ();
+  m_queriesSent++;
+  Transmit (id);
+}
+
+void
+DnsClient::Transmit (uint16_t id)
+{
+  OutstandingQuery& query = m_outstanding[id];
+  Ptr<Packet> packet = query.request->Copy ();
+  Ipv4Address resolver = m_resolvers[query.resolver];
+  if (m_enableResolutionTag)
+  {
+    DnsResolutionTag tag;
+    tag.SetSent (Simulator::Now ());
+    packet->AddPacketTag (tag);
+  }
+
+  NS_LOG_INFO ("Query " << query.qName << " (ID " << id << ") to " << resolver);
+  m_txTrace (packet);
+  m_socket->SendTo (packet, 0, InetSocketAddress (resolver, DNS_PORT));
+  query.timeoutEvent = Simulator::Schedule (m_timeout, &DnsClient::HandleTimeout, this, id);
+}
+
+void
+DnsClient::HandleTimeout (uint16_t id)
+{
+  NS_LOG_FUNCTION (this << id);
+
+  OutstandingQueryI it = m_outstanding.find (id);
+  if (it == m_outstanding.end ())
+  {
+    return;
+  }
+  OutstandingQuery& query = it->second;
+  if (query.retries >= m_maxRetries)
+  {
+    NS_LOG_INFO ("No answer for " << query.qName << " (ID " << id << ")");
+    m_queriesFailed++;
+    m_timeoutTrace (query.qName);
+    ReportOutcome (id, false, 0, std::vector<DnsResolutionHop> ());
+    m_outstanding.erase (it);
+    return;
+  }
+  query.retries++;
+  query.resolver = (query.resolver + 1) % m_resolvers.size ();
+  Transmit (id);
+}
+
+void
+DnsClient::HandleRead (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+  {
+    m_rxTrace (packet);
+
+    DNSHeader header;
+    packet->RemoveHeader (header);
+
+    OutstandingQueryI it = m_outstanding.find (header.GetId ());
+    if (it == m_outstanding.end () || header.GetQuestionList ().empty () ||
+        header.GetQuestionList ().begin ()->GetqName () != it->second.qName)
+    {
+      // A late answer to a query that was retransmitted or given up
+      NS_LOG_LOGIC ("Discarding a reply with ID " << header.GetId ());
+      continue;
+    }
+
+    Time latency = Simulator::Now () - it->second.firstSent;
+    NS_LOG_INFO ("Answer for " << it->second.qName << " after " << latency.GetMilliSeconds () << " ms");
+
+    DnsResolutionTag tag;
+    packet->PeekPacketTag (tag);
+
+    m_queriesAnswered++;
+    m_latencyTrace (it->second.qName, header.GetRcode (), latency);
+    ReportOutcome (header.GetId (), true, header.GetRcode (), tag.GetHops ());
+    it->second.timeoutEvent.Cancel ();
+    m_outstanding.erase (it);
+  }
+}
+
+void
+DnsClient::ReportOutcome (uint16_t id, bool answered, uint8_t rcode, const std::vector<DnsResolutionHop>& hops)
+{
+  const OutstandingQuery& query = m_outstanding[id];
+
+  DnsQueryOutcome outcome;
+  outcome.qName = query.qName;
+  outcome.qType = query.qType;
+  outcome.tag = query.tag;
+  outcome.resolver = m_resolvers[query.resolver];
+  outcome.sent = query.firstSent;
+  outcome.latency = Simulator::Now () - query.firstSent;
+  outcome.retries = query.retries;
+  outcome.answered = answered;
+  outcome.rcode = rcode;
+  outcome.hops = hops;
+  m_outcomeTrace (outcome);
+}
+
+}  // end of namespace ns3
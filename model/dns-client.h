@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_CLIENT_H
+#define DNS_CLIENT_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+
+#include "ns3/dns-resolution-tag.h"
+
+namespace ns3
+{
+class Socket;
+class Packet;
+
+/**
+ * /brief The outcome of a query of a DnsClient */
+struct DnsQueryOutcome
+{
+  std::string qName;  //!< the name asked for
+  uint16_t qType;     //!< the type asked for
+  uint64_t tag;       //!< the value given to DnsClient::Query (0 for generated queries)
+  Ipv4Address resolver;  //!< the resolver asked last
+  Time sent;          //!< first transmission
+  Time latency;       //!< time to the answer, or to giving up
+  uint32_t retries;   //!< retransmissions
+  bool answered;      //!< false if every attempt timed out
+  uint8_t rcode;      //!< response code of the answer
+  std::vector<DnsResolutionHop> hops;  //!< servers of the resolution, if the query was tagged
+};
+
+/**
+ * /brief A stub resolver that generates query load.
+ *
+ * Queries are sent either as a Poisson process at QueryRate, or at the
+ * times given with AddScheduledQuery. Names of Poisson queries are drawn
+ * from the configured name population with Zipf-distributed popularity,
+ * the first name added being the most popular one.
+ *
+ * Many queries may be outstanding at once; replies are matched by
+ * transaction ID and question name. Queries go to the configured resolvers
+ * in turn, and a query that is not answered within Timeout is sent again
+ * to the next resolver until MaxRetries is exhausted. The latency of every
+ * answered query is reported through the Latency trace source.
+ *
+ * With EnableResolutionTag, queries carry a DnsResolutionTag, and the
+ * outcome of an answered query lists the servers of its resolution with
+ * the time spent at each of them. */
+class DnsClient : public Application
+{
+public:
+  /**
+   * /brief How the sending times of the queries are chosen */
+  enum ArrivalProcess
+  {
+    ARRIVAL_POISSON = 0x01,  //!< Exponential inter-arrival times at QueryRate
+    ARRIVAL_TRACE = 0x02,    //!< The times given with AddScheduledQuery
+  };
+
+  static TypeId GetTypeId (void);
+  DnsClient ();
+  virtual ~DnsClient ();
+
+  /**
+   * /brief Add a resolver to send queries to */
+  void AddResolver (Ipv4Address address);
+
+  /**
+   * /brief Add a name to the population of the Poisson queries.
+   * Names are ranked by popularity in the order they are added. */
+  void AddName (const std::string& name);
+
+  /**
+   * /brief Send a query for a name at the given time after the application starts.
+   * Only used with the trace arrival process. */
+  void AddScheduledQuery (Time at, const std::string& name);
+
+  /**
+   * /brief Send a query now, e.g., one replayed from a query log
+   * /param tag a value reported back with the outcome of the query */
+  void Query (const std::string& qName, uint16_t qType, uint64_t tag = 0);
+
+  /**
+   * /brief Assign fixed random variable streams
+   * /returns the number of streams used */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * /brief Signature of the Latency trace source
+   * /param qName the name that was resolved
+   * /param rcode the response code of the answer
+   * /param latency time from the first transmission to the answer */
+  typedef void (*LatencyTracedCallback) (const std::string& qName, uint8_t rcode, Time latency);
+
+  /**
+   * /brief Signature of the Timeout trace source
+   * /param qName the name that was not resolved */
+  typedef void (*TimeoutTracedCallback) (const std::string& qName);
+
+  /**
+   * /brief Signature of the Outcome trace source */
+  typedef void (*OutcomeTracedCallback) (const DnsQueryOutcome& outcome);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void ScheduleNextQuery (void);
+  void SendNextQuery (void);
+  void SendScheduledQuery (void);
+  void SendQuery (const std::string& qName, uint16_t qType, uint64_t tag);
+  void ReportOutcome (uint16_t id, bool answered, uint8_t rcode, const std::vector<DnsResolutionHop>& hops);
+  void Transmit (uint16_t id);
+  void HandleRead (Ptr<Socket> socket);
+  void HandleTimeout (uint16_t id);
+  bool AllocateId (uint16_t& id);
+  const std::string& DrawName (void);
+
+  /// A query waiting for its answer
+  struct OutstandingQuery
+  {
+    std::string qName;     //!< the name asked for
+    uint16_t qType;        //!< the type asked for
+    uint64_t tag;          //!< reported with the outcome
+    Time firstSent;        //!< first transmission, for the latency
+    uint32_t retries;      //!< retransmissions so far
+    uint32_t resolver;     //!< index of the resolver asked last
+    Ptr<Packet> request;   //!< the encoded query, for retransmissions
+    EventId timeoutEvent;  //!< fires when the current attempt times out
+  };
+
+  typedef std::map<uint16_t, OutstandingQuery> OutstandingQueryList;
+  typedef std::map<uint16_t, OutstandingQuery>::iterator OutstandingQueryI;
+
+  typedef std::vector<std::pair<Time, std::string> > ScheduledQueryList;
+
+  ArrivalProcess m_arrivalProcess;  //!< how the sending times are chosen
+  double m_queryRate;               //!< Poisson queries per second
+  double m_zipfExponent;            //!< skew of the name popularity
+  uint32_t m_maxQueries;            //!< queries to send (0: no limit)
+  uint32_t m_maxOutstanding;        //!< queries waiting for an answer at most
+  Time m_timeout;                   //!< time to wait for an answer to each attempt
+  uint32_t m_maxRetries;            //!< retransmissions before a query fails
+  uint16_t m_qType;                 //!< type asked for
+  bool m_enableResolutionTag;       //!< tag the queries to trace their resolution
+
+  std::vector<Ipv4Address> m_resolvers;    //!< resolvers, asked in turn
+  uint32_t m_nextResolver;                 //!< resolver of the next new query
+  std::vector<std::string> m_names;        //!< name population, most popular first
+  std::vector<double> m_popularity;        //!< cumulative Zipf distribution over m_names
+  ScheduledQueryList m_scheduledQueries;   //!< queries of the trace arrival process
+  uint32_t m_nextScheduledQuery;           //!< index of the next scheduled query
+  OutstandingQueryList m_outstanding;      //!< queries waiting for an answer, by ID
+  uint16_t m_nextId;                       //!< next transaction ID to try
+
+  Ptr<Socket> m_socket;
+  EventId m_sendEvent;                          //!< next query of the arrival process
+  Ptr<UniformRandomVariable> m_uniform;         //!< names and transaction IDs
+  Ptr<ExponentialRandomVariable> m_interArrival;  //!< Poisson inter-arrival times
+
+  uint64_t m_queriesSent;      //!< queries sent (without retransmissions)
+  uint64_t m_queriesAnswered;  //!< queries answered
+  uint64_t m_queriesFailed;    //!< queries that exhausted their retries
+  uint64_t m_queriesSkipped;   //!< queries not sent because too many were outstanding
+
+  TracedCallback<const std::string&, uint8_t, Time> m_latencyTrace;  //!< an answered query
+  TracedCallback<const std::string&> m_timeoutTrace;                 //!< a query that failed
+  TracedCallback<const DnsQueryOutcome&> m_outcomeTrace;             //!< every finished query
+  TracedCallback<Ptr<const Packet> > m_txTrace;                      //!< every transmission
+  TracedCallback<Ptr<const Packet> > m_rxTrace;                      //!< every reply
+};
+
+}  // end of namespace ns3
+
+#endif /* DNS_CLIENT_H */
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+#include "dns-event-trace.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("DnsEventTrace");
+
+namespace ns3
+{
+// A dump is the magic, the node ID, the role and three reserved bytes, the
+// events recorded, the events that follow, and then the events. Integers
+// are little-endian.
+static const char DUMP_MAGIC[8] = {'D', 'N', 'S', 'E', 'V', 'T', '0', '1'};
+static const uint32_t DUMP_HEADER_SIZE = 8 + 4 + 4 + 8 + 4;
+static const uint32_t EVENT_SIZE = 8 + 1 + 1 + 2 + 4 + 4 + 2 + 2;
+
+static uint8_t*
+WriteLittleEndian (uint8_t* buffer, uint64_t value, uint32_t bytes)
+{
+  for (uint32_t n = 0; n < bytes; n++)
+  {
+    *buffer++ = static_cast<uint8_t> (value >> (8 * n));
+  }
+  return buffer;
+}
+
+static const uint8_t*
+ReadLittleEndian (const uint8_t* buffer, uint64_t& value, uint32_t bytes)
+{
+  value = 0;
+  for (uint32_t n = 0; n < bytes; n++)
+  {
+    value |= uint64_t (*buffer++) << (8 * n);
+  }
+  return buffer;
+}
+
+static const char*
+EventTypeName (uint8_t type)
+{
+  switch (type)
+  {
+  case DnsTraceEvent::RECEIVE:
+    return "receive";
+  case DnsTraceEvent::LOOKUP:
+    return "lookup";
+  case DnsTraceEvent::HIT:
+    return "hit";
+  case DnsTraceEvent::MISS:
+    return "miss";
+  case DnsTraceEvent::SEND:
+    return "send";
+  case DnsTraceEvent::REPLY:
+    return "reply";
+  case DnsTraceEvent::EXPIRE:
+    return "expire";
+  default:
+    return "unknown";
+  }
+}
+
+DnsEventTrace::DnsEventTrace ()
+  : m_mask (0),
+    m_recorded (0)
+{
+}
+
+void
+DnsEventTrace::SetCapacity (uint32_t capacity)
+{
+  NS_LOG_FUNCTION (this << capacity);
+
+  uint32_t size = 0;
+  if (capacity != 0)
+  {
+    size = 1;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+  }
+  std::vector<DnsTraceEvent> (size).swap (m_events);
+  m_mask = size == 0 ? 0 : size - 1;
+  m_recorded = 0;
+}
+
+std::vector<DnsTraceEvent>
+DnsEventTrace::GetEvents (void) const
+{
+  std::vector<DnsTraceEvent> events;
+  uint64_t kept = std::min<uint64_t> (m_recorded, m_events.size ());
+  events.reserve (kept);
+  for (uint64_t n = m_recorded - kept; n < m_recorded; n++)
+  {
+    events.push_back (m_events[n & m_mask]);
+  }
+  return events;
+}
+
+void
+DnsEventTrace::Write (std::ostream& os, uint32_t node, uint8_t role) const
+{
+  NS_LOG_FUNCTION (this << node << uint32_t (role));
+
+  std::vector<DnsTraceEvent> events = GetEvents ();
+  std::vector<uint8_t> buffer (DUMP_HEADER_SIZE + events.size () * EVENT_SIZE);
+
+  uint8_t* i = &buffer[0];
+  std::memcpy (i, DUMP_MAGIC, sizeof (DUMP_MAGIC));
+  i += sizeof (DUMP_MAGIC);
+  i = WriteLittleEndian (i, node, 4);
+  i = WriteLittleEndian (i, role, 4);
+  i = WriteLittleEndian (i, m_recorded, 8);
+  i = WriteLittleEndian (i, events.size (), 4);
+  for (std::vector<DnsTraceEvent>::const_iterator it = events.begin (); it != events.end (); it++)
+  {
+    i = WriteLittleEndian (i, static_cast<uint64_t> (it->time), 8);
+    i = WriteLittleEndian (i, it->type, 1);
+    i = WriteLittleEndian (i, it->flags, 1);
+    i = WriteLittleEndian (i, it->qType, 2);
+    i = WriteLittleEndian (i, it->name, 4);
+    i = WriteLittleEndian (i, it->address, 4);
+    i = WriteLittleEndian (i, it->id, 2);
+    i = WriteLittleEndian (i, it->size, 2);
+  }
+  os.write (reinterpret_cast<const char*> (&buffer[0]), buffer.size ());
+}
+
+bool
+DnsEventTrace::Decode (std::istream& is, std::ostream& os)
+{
+  os << "# time_s type name qtype peer id size flags" << std::endl;
+
+  uint8_t header[DUMP_HEADER_SIZE];
+  while (is.read (reinterpret_cast<char*> (header), DUMP_HEADER_SIZE))
+  {
+    if (std::memcmp (header, DUMP_MAGIC, sizeof (DUMP_MAGIC)) != 0)
+    {
+      return false;
+    }
+    uint64_t node, role, recorded, count;
+    const uint8_t* i = header + sizeof (DUMP_MAGIC);
+    i = ReadLittleEndian (i, node, 4);
+    i = ReadLittleEndian (i, role, 4);
+    i = ReadLittleEndian (i, recorded, 8);
+    i = ReadLittleEndian (i, count, 4);
+    os << "# node " << node << " role " << role << ": " << count << " of " << recorded << " events" << std::endl;
+
+    for (uint64_t n = 0; n < count; n++)
+    {
+      uint8_t record[EVENT_SIZE];
+      if (!is.read (reinterpret_cast<char*> (record), EVENT_SIZE))
+      {
+        return false;
+      }
+      uint64_t time, type, flags, qType, name, address, id, size;
+      i = record;
+      i = ReadLittleEndian (i, time, 8);
+      i = ReadLittleEndian (i, type, 1);
+      i = ReadLittleEndian (i, flags, 1);
+      i = ReadLittleEndian (i, qType, 2);
+      i = ReadLittleEndian (i, name, 4);
+      i = ReadLittleEndian (i, address, 4);
+      i = ReadLittleEndian (i, id, 2);
+      i = ReadLittleEndian (i, size, 2);
+
+      os << std::fixed << std::setprecision (9) << static_cast<int64_t> (time) / 1e9 << " " << EventTypeName (type)
+         << " " << std::hex << std::setw (8) << std::setfill ('0') << name << std::dec << std::setfill (' ') << " "
+         << qType << " " << Ipv4Address (static_cast<uint32_t> (address)) << " " << id << " " << size << " "
+         << flags << std::endl;
+    }
+  }
+  return is.eof () && is.gcount () == 0;
+}
+
+}  // end of namespace ns3
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_EVENT_TRACE_H
+#define DNS_EVENT_TRACE_H
+
+#include <stdint.h>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/simulator.h"
+
+namespace ns3
+{
+/**
+ * /brief An event of the query path, as kept by DnsEventTrace. 24 bytes. */
+struct DnsTraceEvent
+{
+  /// What happened
+  enum Type
+  {
+    RECEIVE = 0x01,  //!< a message was received; flags: 1 for a query
+    LOOKUP = 0x02,   //!< a table was searched for a name; flags: 1 if found
+    HIT = 0x03,      //!< a question was answered from a cache
+    MISS = 0x04,     //!< a question missed the caches
+    SEND = 0x05,     //!< a query was sent to an upstream server
+    REPLY = 0x06,    //!< a reply was sent
+    EXPIRE = 0x07,   //!< a record was removed from a table
+  };
+
+  int64_t time;      //!< simulation time in nanoseconds
+  uint8_t type;      //!< one of Type
+  uint8_t flags;     //!< depends on the type
+  uint16_t qType;    //!< type of the question or record (0: unknown)
+  uint32_t name;     //!< DnsEventTrace::Hash of the name (0: unknown)
+  uint32_t address;  //!< IPv4 address of the peer (0: none)
+  uint16_t id;       //!< transaction ID of the message (0: unknown)
+  uint16_t size;     //!< size of the message in bytes (0: unknown)
+};
+
+/**
+ * /brief Fixed-size ring buffer of binary events of the query path.
+ *
+ * Unlike logging, recording an event formats nothing: it stores the
+ * simulation time and a few integers, names being reduced to a hash. When
+ * the buffer is full the oldest events are overwritten. Dumps are written
+ * with Write and turned into text with Decode, e.g., after the simulation.
+ *
+ * Events are recorded through DNS_TRACE_EVENT, which checks that the
+ * buffer is enabled before its arguments are evaluated. The module has to
+ * be configured with --enable-dns-event-trace for the macro to do anything;
+ * otherwise it expands to nothing and the query path does not change. */
+class DnsEventTrace
+{
+public:
+  DnsEventTrace ();
+
+  /**
+   * /brief Set the number of events kept, rounded up to a power of two.
+   * Drops the events recorded so far; 0 disables recording. */
+  void SetCapacity (uint32_t capacity);
+  uint32_t
+  GetCapacity (void) const
+  {
+    return m_events.size ();
+  }
+  bool
+  IsEnabled (void) const
+  {
+    return !m_events.empty ();
+  }
+
+  void
+  Record (uint8_t type, uint32_t name, uint16_t qType, uint32_t address, uint16_t id, uint16_t size, uint8_t flags)
+  {
+    DnsTraceEvent& event = m_events[m_recorded & m_mask];
+    event.time = Simulator::Now ().GetNanoSeconds ();
+    event.type = type;
+    event.flags = flags;
+    event.qType = qType;
+    event.name = name;
+    event.address = address;
+    event.id = id;
+    event.size = size;
+    m_recorded++;
+  }
+
+  /**
+   * /brief Get the number of events recorded, including overwritten ones */
+  uint64_t
+  GetRecorded (void) const
+  {
+    return m_recorded;
+  }
+
+  /**
+   * /brief Get the events kept, oldest first */
+  std::vector<DnsTraceEvent> GetEvents (void) const;
+
+  /**
+   * /brief Write a binary dump of the events kept, oldest first.
+   * Dumps of several servers may follow each other in one stream.
+   * /param node ID of the node the events were recorded on
+   * /param role BindServer::ServerType of the server */
+  void Write (std::ostream& os, uint32_t node, uint8_t role) const;
+
+  /**
+   * /brief Print the events of every dump of a stream, one per line
+   * /returns false if the stream holds something else than dumps */
+  static bool Decode (std::istream& is, std::ostream& os);
+
+  /**
+   * /brief The hash names are recorded with (32-bit FNV-1a), to find the
+   * events of a name in a decoded trace */
+  static uint32_t
+  Hash (const std::string& name)
+  {
+    uint32_t hash = 2166136261u;
+    for (std::string::const_iterator it = name.begin (); it != name.end (); it++)
+    {
+      hash = (hash ^ static_cast<uint8_t> (*it)) * 16777619u;
+    }
+    return hash;
+  }
+
+private:
+  std::vector<DnsTraceEvent> m_events;  //!< the ring, a power of two in size
+  uint32_t m_mask;                      //!< size of the ring less one
+  uint64_t m_recorded;                  //!< events recorded since the capacity was set
+};
+
+}  // end of namespace ns3
+
+/**
+ * /brief Record an event in a DnsEventTrace, given by pointer (may be 0).
+ * The arguments are those of DnsEventTrace::Record, and are only evaluated
+ * when the trace is enabled. */
+#ifdef DNS_EVENT_TRACE
+#define DNS_TRACE_EVENT(trace, ...)                         \
+  do                                                        \
+  {                                                         \
+    ns3::DnsEventTrace* dnsEventTrace = (trace);            \
+    if (dnsEventTrace != 0 && dnsEventTrace->IsEnabled ())  \
+    {                                                       \
+      dnsEventTrace->Record (__VA_ARGS__);                  \
+    }                                                       \
+  }                                                         \
+  while (0)
+#else
+#define DNS_TRACE_EVENT(trace, ...) \
+  do                                \
+  {                                 \
+  }                                 \
+  while (0)
+#endif
+
+#endif /* DNS_EVENT_TRACE_H */
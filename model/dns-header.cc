@@ -22,6 +22,7 @@
 #include <string>
 
 #include "ns3/assert.h"
+#include "ns3/dns-memory.h"
 #include "ns3/log.h"
 
 namespace ns3
@@ -49,6 +50,8 @@ namespace ns3
 NS_OBJECT_ENSURE_REGISTERED (QuestionSectionHeader);
 
 QuestionSectionHeader::QuestionSectionHeader ()
+  : m_qType (RR_TYPE_A),
+    m_qClass (RR_CLASS_IN)
 {
 }
 
@@ -118,6 +121,10 @@ QuestionSectionHeader::Deserialize (Buffer::Iterator start)
 NS_OBJECT_ENSURE_REGISTERED (ResourceRecordHeader);
 
 ResourceRecordHeader::ResourceRecordHeader ()
+  : m_type (0),
+    m_class (RR_CLASS_IN),
+    m_timeToLive (0),
+    m_rDataLength (0)
 {
 }
 
@@ -142,42 +149,18 @@ ResourceRecordHeader::GetInstanceTypeId (void) const
 void
 ResourceRecordHeader::Print (std::ostream &os) const
 {
-  if (m_type == 1)
-  {
-    os << " " << m_name << ": type A"
-       << ", class IN"
-       << ", addr " << m_rData << std::endl;
-    os << "   Name: " << m_name << std::endl;
-    os << "   Type: " << m_type << std::endl;
-    os << "   Class: " << m_class << std::endl;
-    os << "   Time to Live: " << m_timeToLive << std::endl;
-    os << "   Data length: " << m_rDataLength << std::endl;
-    os << "   Address: " << m_rData << RESET << std::endl;
-  }
-  if (m_type == 2)
-  {
-    os << " " << m_name << ": type NS"
-       << ", class IN"
-       << ", ns record " << m_rData << std::endl;
-    os << "   Name: " << m_name << std::endl;
-    os << "   Type: " << m_type << std::endl;
-    os << "   Class: " << m_class << std::endl;
-    os << "   Time to Live: " << m_timeToLive << std::endl;
-    os << "   Data length: " << m_rDataLength << std::endl;
-    os << "   NS: " << m_rData << RESET << std::endl;
-  }
-  if (m_type == 5)
-  {
-    os << " " << m_name << ": type CNAME"
-       << ", class IN"
-       << ", cname " << m_rData << std::endl;
-    os << "   Name: " << m_name << std::endl;
-    os << "   Type: " << m_type << std::endl;
-    os << "   Class: " << m_class << std::endl;
-    os << "   Time to Live: " << m_timeToLive << std::endl;
-    os << "   Data length: " << m_rDataLength << std::endl;
-    os << "   CNAME: " << m_rData << RESET << std::endl;
-  }
+  std::string type = RRTypeToString (m_type);
+  std::string rData = RDataToString (m_type, m_rData);
+
+  os << " " << m_name << ": type " << type
+     << ", class IN"
+     << ", " << type << " " << rData << std::endl;
+  os << "   Name: " << m_name << std::endl;
+  os << "   Type: " << m_type << std::endl;
+  os << "   Class: " << m_class << std::endl;
+  os << "   Time to Live: " << m_timeToLive << std::endl;
+  os << "   Data length: " << m_rDataLength << std::endl;
+  os << "   " << type << ": " << rData << RESET << std::endl;
 }
 
 uint32_t
@@ -189,8 +172,7 @@ ResourceRecordHeader::GetSerializedSize (void) const
           sizeof (m_class) /* size of the class */ +
           sizeof (m_timeToLive) /* size of the TTL */ +
           sizeof (m_rDataLength) /* size of the resource record */ +
-          2 /* 2B to send the size of the resource record */ +
-          m_rData.size () + 1 /* size of the resource record and additional 1 byte for end */
+          m_rData.size () /* the encoded resource record */
           );
 }
 
@@ -207,15 +189,18 @@ ResourceRecordHeader::Serialize (Buffer::Iterator start) const
   i.WriteHtonU32 (m_timeToLive);
   i.WriteHtonU16 (m_rDataLength);
 
-  i.WriteU16 ((m_rData.size () + 1));
-  i.Write ((uint8_t *)m_rData.c_str (), (m_rData.size () + 1));
+  // The RDATA is kept encoded, so it is copied as is
+  if (!m_rData.empty ())
+  {
+    i.Write (&m_rData[0], m_rData.size ());
+  }
 }
 
 uint32_t
 ResourceRecordHeader::Deserialize (Buffer::Iterator start)
 {
   Buffer::Iterator i = start;
-  uint8_t receivedSize;
+  uint16_t receivedSize;
   m_name = std::string ("");
 
   receivedSize = i.ReadU16 ();
@@ -228,13 +213,11 @@ ResourceRecordHeader::Deserialize (Buffer::Iterator start)
   m_timeToLive = i.ReadNtohU32 ();
   m_rDataLength = i.ReadNtohU16 ();
 
-  receivedSize = 0;
-  m_rData = std::string ("");
-  receivedSize = i.ReadU16 ();
-
-  char data1[receivedSize];
-  i.Read ((uint8_t *)data1, receivedSize);
-  m_rData = data1;
+  m_rData.resize (m_rDataLength);
+  if (m_rDataLength != 0)
+  {
+    i.Read (&m_rData[0], m_rDataLength);
+  }
 
   return ResourceRecordHeader::GetSerializedSize ();
 }
@@ -323,6 +306,26 @@ DNSHeader::Print (std::ostream &os) const
   }
 }
 
+uint32_t
+DNSHeader::GetMemoryUsage (void) const
+{
+  uint32_t bytes = sizeof (*this);
+  for (std::list<QuestionSectionHeader>::const_iterator iter = m_qdList.begin (); iter != m_qdList.end (); iter++)
+  {
+    bytes += DNS_LIST_NODE_OVERHEAD + sizeof (QuestionSectionHeader) + DnsMemoryUsage (iter->GetqName ());
+  }
+  const std::list<ResourceRecordHeader>* sections[] = {&m_rrList, &m_nsList, &m_arList};
+  for (uint32_t n = 0; n < 3; n++)
+  {
+    for (std::list<ResourceRecordHeader>::const_iterator iter = sections[n]->begin (); iter != sections[n]->end (); iter++)
+    {
+      bytes += DNS_LIST_NODE_OVERHEAD + sizeof (ResourceRecordHeader) + DnsMemoryUsage (iter->GetName ()) +
+               DnsMemoryUsage (iter->GetRDataWire ());
+    }
+  }
+  return bytes;
+}
+
 uint32_t
 DNSHeader::GetSerializedSize (void) const
 {
@@ -430,47 +433,52 @@ uint32_t
 DNSHeader::Deserialize (Buffer::Iterator start)
 {
   Buffer::Iterator i = start;
+
+  // The same header object may be reused for several messages
+  m_qdList.clear ();
+  m_rrList.clear ();
+  m_nsList.clear ();
+  m_arList.clear ();
+
   m_id = i.ReadNtohU16 ();
   m_flagSet = i.ReadNtohU16 ();
   m_qdCount = i.ReadNtohU16 ();
   m_anCount = i.ReadNtohU16 ();
   m_nsCount = i.ReadNtohU16 ();
   m_arCount = i.ReadNtohU16 ();
+  m_totalRecordsCount = m_qdCount + m_anCount + m_nsCount + m_arCount;
 
+  // Records are deserialized in place, at the end of their section
   if (m_qdCount != 0)
   {
-    for (uint8_t n = 0; n < m_qdCount; n++)
+    for (uint16_t n = 0; n < m_qdCount; n++)
     {
-      QuestionSectionHeader question;
-      i.Next (question.Deserialize (i));
-      m_qdList.push_back (question);
+      m_qdList.emplace_back ();
+      i.Next (m_qdList.back ().Deserialize (i));
     }
   }
   if (m_anCount != 0)
   {
-    for (uint8_t n = 0; n < m_anCount; n++)
+    for (uint16_t n = 0; n < m_anCount; n++)
     {
-      ResourceRecordHeader answer;
-      i.Next (answer.Deserialize (i));
-      m_rrList.push_back (answer);
+      m_rrList.emplace_back ();
+      i.Next (m_rrList.back ().Deserialize (i));
     }
   }
   if (m_nsCount != 0)
   {
-    for (uint8_t n = 0; n < m_nsCount; n++)
+    for (uint16_t n = 0; n < m_nsCount; n++)
     {
-      ResourceRecordHeader nsRecord;
-      i.Next (nsRecord.Deserialize (i));
-      m_nsList.push_back (nsRecord);
+      m_nsList.emplace_back ();
+      i.Next (m_nsList.back ().Deserialize (i));
     }
   }
   if (m_arCount != 0)
   {
-    for (uint8_t n = 0; n < m_arCount; n++)
+    for (uint16_t n = 0; n < m_arCount; n++)
     {
-      ResourceRecordHeader aRecord;
-      i.Next (aRecord.Deserialize (i));
-      m_arList.push_back (aRecord);
+      m_arList.emplace_back ();
+      i.Next (m_arList.back ().Deserialize (i));
     }
   }
   return DNSHeader::GetSerializedSize ();
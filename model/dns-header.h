@@ -21,11 +21,18 @@
 #ifndef DNS_HEADER_H
 #define DNS_HEADER_H
 
+#include "ns3/assert.h"
 #include "ns3/header.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/nstime.h"
 
+#include "ns3/dns-rdata.h"
+
+#include <list>
+#include <string>
+#include <utility>
+
 namespace ns3
 {
 //  4.1.2. Question section format
@@ -68,6 +75,12 @@ class QuestionSectionHeader : public Header
 public:
   QuestionSectionHeader ();
   virtual ~QuestionSectionHeader ();
+  // The declared destructor would leave the class without move operations,
+  // so questions added to a message would be copied
+  QuestionSectionHeader (const QuestionSectionHeader&) = default;
+  QuestionSectionHeader (QuestionSectionHeader&&) = default;
+  QuestionSectionHeader& operator= (const QuestionSectionHeader&) = default;
+  QuestionSectionHeader& operator= (QuestionSectionHeader&&) = default;
 
   /**
    * \brief Get the type ID.
@@ -111,7 +124,7 @@ public:
   /*
   * /brief Get and Set the qname
   */
-  std::string
+  const std::string&
   GetqName () const
   {
     return m_qName;
@@ -119,7 +132,7 @@ public:
   void
   SetqName (std::string qname)
   {
-    m_qName = qname;
+    m_qName = std::move (qname);
   }
 
   /*
@@ -215,6 +228,10 @@ class ResourceRecordHeader : public Header
 public:
   ResourceRecordHeader ();
   virtual ~ResourceRecordHeader ();
+  ResourceRecordHeader (const ResourceRecordHeader&) = default;
+  ResourceRecordHeader (ResourceRecordHeader&&) = default;
+  ResourceRecordHeader& operator= (const ResourceRecordHeader&) = default;
+  ResourceRecordHeader& operator= (ResourceRecordHeader&&) = default;
 
   /**
    * \brief Get the type ID.
@@ -254,14 +271,14 @@ private:
   uint16_t m_type;
   uint16_t m_class;
   uint32_t m_timeToLive;
-  std::string m_rData;     // !< This contains the resource data (IP, CNAME or NS records)
-  uint16_t m_rDataLength;  // !< the length of the resource data
+  std::vector<uint8_t> m_rData;  // !< the encoded resource data (see RDataCodec)
+  uint16_t m_rDataLength;        // !< the length of the resource data
 
 public:
   /*
   * /brief Get and Set thename
   */
-  std::string
+  const std::string&
   GetName () const
   {
     return m_name;
@@ -269,7 +286,7 @@ public:
   void
   SetName (std::string name)
   {
-    m_name = name;  // Added the "." for testing
+    m_name = std::move (name);  // Added the "." for testing
   }
 
   /*
@@ -315,18 +332,64 @@ public:
   }
 
   /*
-  * /brief Get and Set the Resource data
+  * /brief Get and Set the Resource data in presentation form.
+  * The text is encoded according to the type, so set the type first.
+  * SetRData returns false, and leaves the RDATA as it was, if the text is
+  * not valid for the type.
   */
   std::string
   GetRData () const
+  {
+    return RDataToString (m_type, m_rData);
+  }
+  bool
+  SetRData (const std::string& rData)
+  {
+    NS_ASSERT_MSG (m_type != 0, "Set the type of a resource record before its RDATA");
+    if (!RDataFromString (m_type, rData, m_rData))
+    {
+      return false;
+    }
+    SetRdLength ();  // Set the length of the resource data
+    return true;
+  }
+
+  /*
+  * /brief Get and Set the Resource data as a typed value, e.g., GetRData<RR_TYPE_A> ().
+  * Setting a typed value also sets the type of the record.
+  */
+  template <uint16_t Type>
+  typename RDataCodec<Type>::Value
+  GetRData () const
+  {
+    NS_ASSERT_MSG (m_type == Type, "Resource record of type " << m_type << " read as type " << Type);
+    typename RDataCodec<Type>::Value value;
+    DecodeRData<Type> (m_rData, value);
+    return value;
+  }
+  template <uint16_t Type>
+  void
+  SetRData (const typename RDataCodec<Type>::Value& value)
+  {
+    m_type = Type;
+    EncodeRData<Type> (value, m_rData);
+    SetRdLength ();
+  }
+
+  /*
+  * /brief Get and Set the encoded Resource data.
+  * Use these to copy records without decoding them.
+  */
+  const std::vector<uint8_t>&
+  GetRDataWire () const
   {
     return m_rData;
   }
   void
-  SetRData (std::string rData)
+  SetRDataWire (std::vector<uint8_t> rData)
   {
-    m_rData = rData;
-    SetRdLength ();  // Set the length of the resource data
+    m_rData = std::move (rData);
+    SetRdLength ();
   }
 
   /*
@@ -501,6 +564,12 @@ public:
    */
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
+  /**
+   * \brief Get the bytes the header takes in memory, with its sections.
+   * \return size
+   */
+  uint32_t GetMemoryUsage (void) const;
+
 private:
   uint16_t m_id;
   uint16_t m_flagSet;  //!< QR|   Opcode  |AA|TC|RD|RA|   Z    |   RCODE   |
@@ -553,7 +622,7 @@ public:
   void
   ResetOpcode (void)
   {
-    m_flagSet &= (0 << 11);
+    m_flagSet &= ~(0x000F << 11);
   }
 
   bool
@@ -717,7 +786,7 @@ public:
   void
   AddQuestion (QuestionSectionHeader question)
   {
-    m_qdList.push_front (question);
+    m_qdList.push_front (std::move (question));
     SetQdCount ();
   }
 
@@ -726,7 +795,7 @@ public:
    * \param question the question that should delete from DNS message
    */
   void
-  DeleteQuestion (QuestionSectionHeader question)
+  DeleteQuestion (const QuestionSectionHeader& question)
   {
     for (std::list<QuestionSectionHeader>::iterator it = m_qdList.begin (); it != m_qdList.end (); it++)
     {
@@ -753,8 +822,9 @@ public:
   /**
    * \brief Get the list of the questions added to the DNS message
    * \returns the list of the questions added to the DNS message
+   * (a reference that stays valid until the section is modified)
    */
-  std::list<QuestionSectionHeader>
+  const std::list<QuestionSectionHeader>&
   GetQuestionList (void) const
   {
     return m_qdList;
@@ -770,7 +840,7 @@ public:
   void
   AddAnswer (ResourceRecordHeader answer)
   {
-    m_rrList.push_front (answer);
+    m_rrList.push_front (std::move (answer));
     SetAnCount ();
   }
 
@@ -779,7 +849,7 @@ public:
    * \param answeer the answer that should delete from DNS message
    */
   void
-  DeleteAnswer (ResourceRecordHeader answer)
+  DeleteAnswer (const ResourceRecordHeader& answer)
   {
     for (std::list<ResourceRecordHeader>::iterator it = m_rrList.begin (); it != m_rrList.end (); it++)
     {
@@ -806,8 +876,9 @@ public:
   /**
    * \brief Get the list of the answer added to the DNS message
    * \returns the list of the answer added to the DNS message
+   * (a reference that stays valid until the section is modified)
    */
-  std::list<ResourceRecordHeader>
+  const std::list<ResourceRecordHeader>&
   GetAnswerList (void) const
   {
     return m_rrList;
@@ -823,7 +894,7 @@ public:
   void
   AddNsRecord (ResourceRecordHeader nsRecord)
   {
-    m_nsList.push_front (nsRecord);
+    m_nsList.push_front (std::move (nsRecord));
     SetNsCount ();
   }
 
@@ -832,7 +903,7 @@ public:
    * \param nsRecord the ns record that should delete from DNS message
    */
   void
-  DeleteNsRecord (ResourceRecordHeader nsRecord)
+  DeleteNsRecord (const ResourceRecordHeader& nsRecord)
   {
     for (std::list<ResourceRecordHeader>::iterator it = m_nsList.begin (); it != m_nsList.end (); it++)
     {
@@ -859,8 +930,9 @@ public:
   /**
    * \brief Get the list of the ns records added to the DNS message
    * \returns the list of the ns records added to the DNS message
+   * (a reference that stays valid until the section is modified)
    */
-  std::list<ResourceRecordHeader>
+  const std::list<ResourceRecordHeader>&
   GetNsRecordList (void) const
   {
     return m_nsList;
@@ -876,7 +948,7 @@ public:
   void
   AddARecord (ResourceRecordHeader aRecord)
   {
-    m_arList.push_front (aRecord);
+    m_arList.push_front (std::move (aRecord));
     SetArCount ();
   }
 
@@ -885,7 +957,7 @@ public:
    * \param aRecord the additional record that should delete from DNS message
    */
   void
-  DeleteARecord (ResourceRecordHeader aRecord)
+  DeleteARecord (const ResourceRecordHeader& aRecord)
   {
     for (std::list<ResourceRecordHeader>::iterator it = m_arList.begin (); it != m_arList.end (); it++)
     {
@@ -912,8 +984,9 @@ public:
   /**
    * \brief Get the list of the additional records added to the DNS message
    * \returns the list of the additional records added to the DNS message
+   * (a reference that stays valid until the section is modified)
    */
-  std::list<ResourceRecordHeader>
+  const std::list<ResourceRecordHeader>&
   GetArList (void) const
   {
     return m_arList;
@@ -0,0 +1,46 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_MEMORY_H
+#define DNS_MEMORY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+// Memory accounting of the tables and messages of the module. The figures
+// are the bytes the data structures ask for; the overhead of the allocator
+// is not counted.
+
+/**
+ * /brief Bytes a std::list keeps per node besides the value: the two links */
+static const uint32_t DNS_LIST_NODE_OVERHEAD = 2 * sizeof (void*);
+
+/**
+ * /brief Bytes a string holds on the heap. Short strings are kept inside
+ * the object and hold none. */
+inline uint32_t
+DnsMemoryUsage (const std::string& value)
+{
+  const char* data = value.data ();
+  const char* object = reinterpret_cast<const char*> (&value);
+  if (data >= object && data < object + sizeof (value))
+  {
+    return 0;
+  }
+  return value.capacity () + 1;
+}
+
+/**
+ * /brief Bytes a vector holds on the heap, not counting what its elements
+ * hold themselves */
+template <class T>
+inline uint64_t
+DnsMemoryUsage (const std::vector<T>& value)
+{
+  return value.capacity () * sizeof (T);
+}
+
+}  // end of namespace ns3
+
+#endif /* DNS_MEMORY_H */
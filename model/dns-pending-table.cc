@@ -0,0 +1,347 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "dns-pending-table.h"
+
+#include "ns3/dns-memory.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+NS_LOG_COMPONENT_DEFINE ("DNSPendingQueryTable");
+
+namespace ns3
+{
+const uint32_t PendingQueryTable::INVALID_HANDLE;
+const uint32_t PendingQueryTable::EMPTY_SLOT;
+const uint32_t PendingQueryTable::DELETED_SLOT;
+
+PendingQueryTable::PendingQueryTable ()
+  : m_size (0)
+{
+  SetCapacity (1024);
+}
+
+PendingQueryTable::~PendingQueryTable ()
+{
+  Clear ();
+}
+
+void
+PendingQueryTable::SetCapacity (uint32_t capacity)
+{
+  NS_LOG_FUNCTION (this << capacity);
+
+  Clear ();
+
+  m_entries.assign (capacity, PendingQuery ());
+  m_freeList.clear ();
+  for (uint32_t handle = capacity; handle > 0; handle--)
+  {
+    m_freeList.push_back (handle - 1);
+  }
+  m_replyIndex.Reset (capacity);
+  m_questionIndex.Reset (capacity);
+}
+
+uint32_t
+PendingQueryTable::Allocate (const std::string& qName, uint16_t qType, uint16_t qClass)
+{
+  NS_LOG_FUNCTION (this << qName << qType << qClass);
+
+  if (m_freeList.empty ())
+  {
+    return INVALID_HANDLE;
+  }
+  uint32_t handle = m_freeList.back ();
+  m_freeList.pop_back ();
+  m_size++;
+
+  PendingQuery& entry = m_entries[handle];
+  entry.qName = qName;
+  entry.qType = qType;
+  entry.qClass = qClass;
+  entry.upstreams.clear ();
+  entry.clients.clear ();
+  entry.zone.clear ();
+  entry.referrals = 0;
+  entry.upstreamQueries = 0;
+  entry.startedAt = Simulator::Now ();
+  entry.traced = false;
+  entry.trail = DnsResolutionTag ();
+  entry.retransmissions = 0;
+  entry.overTcp = false;
+  m_questionIndex.Insert (Hash (qName, qType, qClass), handle);
+  return handle;
+}
+
+void
+PendingQueryTable::Release (uint32_t handle)
+{
+  NS_LOG_FUNCTION (this << handle);
+
+  PendingQuery& entry = m_entries[handle];
+  entry.timeoutEvent.Cancel ();
+  entry.hedgeEvent.Cancel ();
+  ClearUpstreams (handle);
+  m_questionIndex.Remove (Hash (entry.qName, entry.qType, entry.qClass), handle);
+  entry.clients.clear ();
+  entry.request = 0;
+
+  m_freeList.push_back (handle);
+  m_size--;
+}
+
+void
+PendingQueryTable::AddUpstream (uint32_t handle, Ipv4Address upstream)
+{
+  NS_LOG_FUNCTION (this << handle << upstream);
+
+  PendingQuery& entry = m_entries[handle];
+  entry.upstreams.push_back (upstream);
+  m_replyIndex.Insert (Hash (entry.id, entry.qName, upstream), handle);
+}
+
+void
+PendingQueryTable::ClearUpstreams (uint32_t handle)
+{
+  NS_LOG_FUNCTION (this << handle);
+
+  PendingQuery& entry = m_entries[handle];
+  for (std::vector<Ipv4Address>::const_iterator it = entry.upstreams.begin ();
+       it != entry.upstreams.end ();
+       it++)
+  {
+    m_replyIndex.Remove (Hash (entry.id, entry.qName, *it), handle);
+  }
+  entry.upstreams.clear ();
+}
+
+uint32_t
+PendingQueryTable::Find (uint16_t id, const std::string& qName, Ipv4Address upstream) const
+{
+  NS_LOG_FUNCTION (this << id << qName << upstream);
+
+  uint32_t hash = Hash (id, qName, upstream);
+  uint32_t mask = m_replyIndex.slots.size () - 1;
+
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+  {
+    const Slot& slot = m_replyIndex.slots[i];
+    if (slot.handle == EMPTY_SLOT)
+    {
+      return INVALID_HANDLE;
+    }
+    if (slot.handle != DELETED_SLOT && slot.hash == hash)
+    {
+      const PendingQuery& entry = m_entries[slot.handle];
+      if (entry.id == id && entry.qName == qName)
+      {
+        for (std::vector<Ipv4Address>::const_iterator it = entry.upstreams.begin ();
+             it != entry.upstreams.end ();
+             it++)
+        {
+          if (*it == upstream)
+          {
+            return slot.handle;
+          }
+        }
+      }
+    }
+  }
+}
+
+uint32_t
+PendingQueryTable::FindQuestion (const std::string& qName, uint16_t qType, uint16_t qClass) const
+{
+  NS_LOG_FUNCTION (this << qName << qType << qClass);
+
+  uint32_t hash = Hash (qName, qType, qClass);
+  uint32_t mask = m_questionIndex.slots.size () - 1;
+
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+  {
+    const Slot& slot = m_questionIndex.slots[i];
+    if (slot.handle == EMPTY_SLOT)
+    {
+      return INVALID_HANDLE;
+    }
+    if (slot.handle != DELETED_SLOT && slot.hash == hash)
+    {
+      const PendingQuery& entry = m_entries[slot.handle];
+      if (entry.qType == qType && entry.qClass == qClass && entry.qName == qName)
+      {
+        return slot.handle;
+      }
+    }
+  }
+}
+
+void
+PendingQueryTable::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint32_t handle = 0; handle < m_entries.size (); handle++)
+  {
+    m_entries[handle].timeoutEvent.Cancel ();
+    m_entries[handle].hedgeEvent.Cancel ();
+    m_entries[handle].upstreams.clear ();
+    m_entries[handle].clients.clear ();
+    m_entries[handle].request = 0;
+  }
+  m_freeList.clear ();
+  for (uint32_t handle = m_entries.size (); handle > 0; handle--)
+  {
+    m_freeList.push_back (handle - 1);
+  }
+  m_replyIndex.Reset (m_entries.size ());
+  m_questionIndex.Reset (m_entries.size ());
+  m_size = 0;
+}
+
+uint64_t
+PendingQueryTable::GetMemoryUsage (void) const
+{
+  uint64_t bytes = DnsMemoryUsage (m_entries) + DnsMemoryUsage (m_freeList) + DnsMemoryUsage (m_replyIndex.slots) +
+                   DnsMemoryUsage (m_questionIndex.slots);
+  for (std::vector<PendingQuery>::const_iterator it = m_entries.begin (); it != m_entries.end (); it++)
+  {
+    bytes += DnsMemoryUsage (it->qName) + DnsMemoryUsage (it->zone) + DnsMemoryUsage (it->servers) +
+             DnsMemoryUsage (it->upstreams) + DnsMemoryUsage (it->clients) + DnsMemoryUsage (it->trail.GetHops ());
+    for (std::vector<PendingClient>::const_iterator client = it->clients.begin (); client != it->clients.end (); client++)
+    {
+      bytes += DnsMemoryUsage (client->tag.GetHops ());
+    }
+    if (it->request != 0)
+    {
+      bytes += it->request->GetSize ();
+    }
+  }
+  return bytes;
+}
+
+// FNV-1a over the parts of the keys
+
+static uint32_t
+HashBytes (uint32_t hash, const std::string& bytes)
+{
+  for (std::string::const_iterator it = bytes.begin (); it != bytes.end (); it++)
+  {
+    hash = (hash ^ static_cast<uint8_t> (*it)) * 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t
+HashInteger (uint32_t hash, uint32_t value, int bytes)
+{
+  for (int shift = 0; shift < 8 * bytes; shift += 8)
+  {
+    hash = (hash ^ ((value >> shift) & 0xff)) * 16777619u;
+  }
+  return hash;
+}
+
+uint32_t
+PendingQueryTable::Hash (uint16_t id, const std::string& qName, Ipv4Address upstream)
+{
+  uint32_t hash = 2166136261u;
+  hash = HashInteger (hash, id, 2);
+  hash = HashInteger (hash, upstream.Get (), 4);
+  return HashBytes (hash, qName);
+}
+
+uint32_t
+PendingQueryTable::Hash (const std::string& qName, uint16_t qType, uint16_t qClass)
+{
+  uint32_t hash = 2166136261u;
+  hash = HashInteger (hash, qType, 2);
+  hash = HashInteger (hash, qClass, 2);
+  return HashBytes (hash, qName);
+}
+
+// Index
+
+void
+PendingQueryTable::Index::Reset (uint32_t capacity)
+{
+  // Keep the load factor at or below one half
+  uint32_t size = 16;
+  while (size < 2 * capacity)
+  {
+    size <<= 1;
+  }
+  Slot empty = {0, EMPTY_SLOT};
+  slots.assign (size, empty);
+  usedSlots = 0;
+}
+
+void
+PendingQueryTable::Index::Insert (uint32_t hash, uint32_t handle)
+{
+  // Deleted slots are only reclaimed by a rebuild, which keeps probing simple.
+  if (2 * (usedSlots + 1) > slots.size ())
+  {
+    Rebuild ();
+  }
+
+  uint32_t mask = slots.size () - 1;
+  uint32_t i = hash & mask;
+  while (slots[i].handle != EMPTY_SLOT)
+  {
+    i = (i + 1) & mask;
+  }
+  slots[i].hash = hash;
+  slots[i].handle = handle;
+  usedSlots++;
+}
+
+void
+PendingQueryTable::Index::Remove (uint32_t hash, uint32_t handle)
+{
+  uint32_t mask = slots.size () - 1;
+
+  for (uint32_t i = hash & mask; slots[i].handle != EMPTY_SLOT; i = (i + 1) & mask)
+  {
+    if (slots[i].handle == handle && slots[i].hash == hash)
+    {
+      slots[i].handle = DELETED_SLOT;
+      return;
+    }
+  }
+}
+
+void
+PendingQueryTable::Index::Rebuild (void)
+{
+  std::vector<Slot> live;
+  for (std::vector<Slot>::const_iterator it = slots.begin (); it != slots.end (); it++)
+  {
+    if (it->handle != EMPTY_SLOT && it->handle != DELETED_SLOT)
+    {
+      live.push_back (*it);
+    }
+  }
+
+  // Grow if the live keys alone would exceed a quarter of the slots
+  uint32_t size = slots.size ();
+  while (4 * (live.size () + 1) > size)
+  {
+    size <<= 1;
+  }
+  Slot empty = {0, EMPTY_SLOT};
+  slots.assign (size, empty);
+  usedSlots = 0;
+
+  uint32_t mask = slots.size () - 1;
+  for (std::vector<Slot>::const_iterator it = live.begin (); it != live.end (); it++)
+  {
+    uint32_t i = it->hash & mask;
+    while (slots[i].handle != EMPTY_SLOT)
+    {
+      i = (i + 1) & mask;
+    }
+    slots[i] = *it;
+    usedSlots++;
+  }
+}
+}
@@ -0,0 +1,175 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_PENDING_TABLE_H
+#define DNS_PENDING_TABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ns3/address.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+
+#include "ns3/dns-resolution-tag.h"
+
+namespace ns3
+{
+/**
+ * /brief A client waiting for the outcome of a resolution */
+struct PendingClient
+{
+  Address address;       //!< where the answer goes
+  uint16_t id;           //!< transaction ID of the client query
+  uint32_t request;      //!< multi-question request the answer belongs to (0: none)
+  bool tagged;           //!< the query carried a resolution tag
+  DnsResolutionTag tag;  //!< the tag of the query
+  Time arrival;          //!< when the query arrived
+};
+
+/**
+ * /brief An upstream resolution that waits for its reply */
+struct PendingQuery
+{
+  uint16_t id;                          //!< transaction ID used towards the upstream servers
+  std::string qName;                    //!< the name being resolved
+  uint16_t qType;                       //!< the type being resolved
+  uint16_t qClass;                      //!< the class being resolved
+  std::string zone;                     //!< zone of the servers currently asked ("" for the root)
+  uint32_t referrals;                   //!< referrals followed so far
+  uint32_t upstreamQueries;             //!< queries sent upstream, including retransmissions and hedges
+  Time startedAt;                       //!< when the resolution started
+  std::vector<Ipv4Address> servers;     //!< replicas that can answer the current query
+  std::vector<Ipv4Address> upstreams;   //!< servers the current query was sent to
+  std::vector<PendingClient> clients;   //!< every client asking this question
+  Ptr<Packet> request;                  //!< copy of the upstream query, for retransmissions
+  Time sentAt;                          //!< when the current query was first sent
+  Time hedgedAt;                        //!< when the current query was hedged to a second server
+  Time timeout;                         //!< current retransmission timeout
+  bool overTcp;                         //!< the current query is repeated over TCP after a truncated reply
+  uint32_t retransmissions;             //!< retransmissions of the current query
+  EventId timeoutEvent;                 //!< fires when the current timeout expires
+  EventId hedgeEvent;                   //!< fires when the current query is to be hedged
+  bool traced;                          //!< some client is tagged, so upstream queries are tagged too
+  DnsResolutionTag trail;               //!< hops of the upstream replies received so far
+};
+
+/**
+ * /brief Bounded table of the resolutions a server is waiting for.
+ *
+ * Entries live in a fixed array and are referred to by handle. Two flat
+ * open-addressing indexes with linear probing lead to them:
+ *  - replies are matched by (transaction ID, qname, upstream server). An
+ *    entry has one such key per upstream server it is waiting for.
+ *  - new client queries find a resolution of the same (qname, qtype,
+ *    qclass) that is already in flight, so they can wait for its result.
+ * The entries are allocated when the capacity is set, and Allocate fails
+ * instead of growing the table. An index is rebuilt once its deleted slots
+ * pile up, which allocates a copy of its live keys and may grow the index;
+ * the entries are not touched. */
+class PendingQueryTable
+{
+public:
+  static const uint32_t INVALID_HANDLE = 0xffffffff;
+
+  PendingQueryTable ();
+  ~PendingQueryTable ();
+
+  /**
+   * /brief Set the maximum number of entries. Drops all current entries. */
+  void SetCapacity (uint32_t capacity);
+  uint32_t
+  GetCapacity (void) const
+  {
+    return m_entries.size ();
+  }
+  uint32_t
+  GetSize (void) const
+  {
+    return m_size;
+  }
+
+  /**
+   * /brief Reserve an entry for resolving a question
+   * /returns the handle of the entry, or INVALID_HANDLE if the table is full */
+  uint32_t Allocate (const std::string& qName, uint16_t qType, uint16_t qClass);
+
+  /**
+   * /brief Cancel the timers of an entry, drop its keys and free it */
+  void Release (uint32_t handle);
+
+  PendingQuery&
+  Get (uint32_t handle)
+  {
+    return m_entries[handle];
+  }
+
+  /**
+   * /brief Register the entry under (id, qName, upstream).
+   * Set the id of the entry before adding upstreams. */
+  void AddUpstream (uint32_t handle, Ipv4Address upstream);
+
+  /**
+   * /brief Drop every key of the entry, e.g., before it moves to another server */
+  void ClearUpstreams (uint32_t handle);
+
+  /**
+   * /brief Find the entry a reply belongs to
+   * /returns the handle of the entry, or INVALID_HANDLE */
+  uint32_t Find (uint16_t id, const std::string& qName, Ipv4Address upstream) const;
+
+  /**
+   * /brief Find the resolution in flight for a question
+   * /returns the handle of the entry, or INVALID_HANDLE */
+  uint32_t FindQuestion (const std::string& qName, uint16_t qType, uint16_t qClass) const;
+
+  /**
+   * /brief Release every entry */
+  void Clear (void);
+
+  /**
+   * /brief Get the bytes the table takes: the entries with what they hold,
+   * the free list and the indexes. Released entries keep their buffers for
+   * the next resolution, so apart from the queries kept for retransmission
+   * the figure only grows until the capacity is set again. */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  static const uint32_t EMPTY_SLOT = 0xffffffff;
+  static const uint32_t DELETED_SLOT = 0xfffffffe;
+
+  /// A slot of an index: the hash of a key and the entry it leads to
+  struct Slot
+  {
+    uint32_t hash;
+    uint32_t handle;
+  };
+
+  /// Open-addressing index from key hashes to entry handles.
+  /// Keys are compared against the entries by the lookups of the table.
+  struct Index
+  {
+    void Reset (uint32_t capacity);
+    void Insert (uint32_t hash, uint32_t handle);
+    void Remove (uint32_t hash, uint32_t handle);
+    void Rebuild (void);
+
+    std::vector<Slot> slots;  //!< a power of two in size
+    uint32_t usedSlots;       //!< slots that are not empty (including deleted ones)
+  };
+
+  static uint32_t Hash (uint16_t id, const std::string& qName, Ipv4Address upstream);
+  static uint32_t Hash (const std::string& qName, uint16_t qType, uint16_t qClass);
+
+  std::vector<PendingQuery> m_entries;  //!< entry storage, never resized after SetCapacity
+  std::vector<uint32_t> m_freeList;     //!< handles of the unused entries
+  Index m_replyIndex;                   //!< (id, qname, upstream) to entry
+  Index m_questionIndex;                //!< (qname, qtype, qclass) to entry
+  uint32_t m_size;                      //!< entries in use
+};
+
+}  // end of namespace ns3
+
+#endif /* DNS_PENDING_TABLE_H */
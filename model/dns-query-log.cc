@@ -0,0 +1,270 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <cstdlib>
+#include <iomanip>
+
+#include "dns-query-log.h"
+
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include "ns3/dns-event-trace.h"
+#include "ns3/dns-rdata.h"
+
+NS_LOG_COMPONENT_DEFINE ("DNSQueryLog");
+
+namespace ns3
+{
+// Size of the read buffer of a query log
+static const std::size_t LOG_BUFFER_SIZE = 1 << 20;
+
+QueryLogReader::QueryLogReader ()
+  : m_buffer (LOG_BUFFER_SIZE),
+    m_lineNumber (0),
+    m_malformedLines (0)
+{
+}
+
+QueryLogReader::~QueryLogReader ()
+{
+  Close ();
+}
+
+bool
+QueryLogReader::Open (const std::string& fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+
+  Close ();
+  // The buffer has to be installed before the file is opened
+  m_stream.rdbuf ()->pubsetbuf (&m_buffer[0], m_buffer.size ());
+  m_stream.open (fileName.c_str ());
+  m_lineNumber = 0;
+  m_malformedLines = 0;
+  return m_stream.is_open ();
+}
+
+void
+QueryLogReader::Close (void)
+{
+  if (m_stream.is_open ())
+  {
+    m_stream.close ();
+  }
+  m_stream.clear ();
+}
+
+bool
+QueryLogReader::Next (QueryLogRecord& record)
+{
+  while (std::getline (m_stream, m_line))
+  {
+    m_lineNumber++;
+    std::size_t start = m_line.find_first_not_of (" \t\r");
+    if (start == std::string::npos || m_line[start] == '#')
+    {
+      continue;
+    }
+    if (Parse (record))
+    {
+      record.line = m_lineNumber;
+      return true;
+    }
+    NS_LOG_INFO ("Skipping malformed line " << m_lineNumber);
+    m_malformedLines++;
+  }
+  return false;
+}
+
+// Split the line into its four fields and convert them. The timestamp is
+// converted without going through a double, so that the sub-microsecond
+// digits of epoch timestamps are kept.
+bool
+QueryLogReader::Parse (QueryLogRecord& record)
+{
+  static const char* separators = " \t\r,";
+
+  std::string fields[4];
+  std::size_t end = 0;
+  for (int n = 0; n < 4; n++)
+  {
+    std::size_t start = m_line.find_first_not_of (separators, end);
+    if (start == std::string::npos)
+    {
+      return false;
+    }
+    end = m_line.find_first_of (separators, start);
+    fields[n] = m_line.substr (start, end == std::string::npos ? std::string::npos : end - start);
+  }
+
+  const std::string& timestamp = fields[0];
+  std::size_t point = timestamp.find ('.');
+  std::string seconds = timestamp.substr (0, point);
+  std::string fraction = point == std::string::npos ? std::string () : timestamp.substr (point + 1);
+  if (seconds.empty () || seconds.find_first_not_of ("0123456789") != std::string::npos ||
+      fraction.find_first_not_of ("0123456789") != std::string::npos)
+  {
+    return false;
+  }
+  fraction.resize (9, '0');
+  record.timestamp = NanoSeconds (std::strtoll (seconds.c_str (), 0, 10) * 1000000000LL +
+                                  std::strtoll (fraction.c_str (), 0, 10));
+
+  record.client = fields[1];
+  record.qName = fields[2];
+  return RRTypeFromString (fields[3], record.qType);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DnsLogReplay);
+
+TypeId
+DnsLogReplay::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DnsLogReplay")
+                        .SetParent<Object> ()
+                        .AddConstructor<DnsLogReplay> ()
+                        .AddAttribute ("FileName",
+                                       "The query log to replay.",
+                                       StringValue (""),
+                                       MakeStringAccessor (&DnsLogReplay::m_fileName),
+                                       MakeStringChecker ())
+                        .AddAttribute ("OutcomeFileName",
+                                       "File the outcome of every replayed query is written to "
+                                       "(empty: none).",
+                                       StringValue (""),
+                                       MakeStringAccessor (&DnsLogReplay::m_outcomeFileName),
+                                       MakeStringChecker ())
+                        .AddAttribute ("Speedup",
+                                       "Factor by which the replay runs faster than the log.",
+                                       DoubleValue (1),
+                                       MakeDoubleAccessor (&DnsLogReplay::m_speedup),
+                                       MakeDoubleChecker<double> (0.001))
+                        .AddAttribute ("ReplayedQueries",
+                                       "Number of queries handed to the clients.",
+                                       TypeId::ATTR_GET,
+                                       UintegerValue (0),
+                                       MakeUintegerAccessor (&DnsLogReplay::m_replayedQueries),
+                                       MakeUintegerChecker<uint64_t> ());
+  return tid;
+}
+
+DnsLogReplay::DnsLogReplay ()
+  : m_hasNext (false),
+    m_replayedQueries (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DnsLogReplay::~DnsLogReplay ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DnsLogReplay::AddClient (Ptr<DnsClient> client)
+{
+  NS_LOG_FUNCTION (this << client);
+  m_clients.push_back (client);
+  client->TraceConnectWithoutContext ("Outcome", MakeCallback (&DnsLogReplay::HandleOutcome, this));
+}
+
+void
+DnsLogReplay::AddClients (ApplicationContainer clients)
+{
+  for (ApplicationContainer::Iterator it = clients.Begin (); it != clients.End (); it++)
+  {
+    AddClient ((*it)->GetObject<DnsClient> ());
+  }
+}
+
+void
+DnsLogReplay::Start (Time delay)
+{
+  NS_LOG_FUNCTION (this << delay);
+
+  NS_ABORT_MSG_IF (m_clients.empty (), "DnsLogReplay needs clients. Hint: AddClient. Aborting");
+  NS_ABORT_MSG_UNLESS (m_reader.Open (m_fileName), "Cannot read the query log " << m_fileName);
+
+  if (!m_outcomeFileName.empty ())
+  {
+    m_outcomes.open (m_outcomeFileName.c_str ());
+    NS_ABORT_MSG_UNLESS (m_outcomes.is_open (), "Cannot write the outcomes to " << m_outcomeFileName);
+    // Times to the nanosecond, as the simulator keeps them
+    m_outcomes << std::fixed << std::setprecision (9);
+  }
+
+  m_hasNext = m_reader.Next (m_next);
+  if (!m_hasNext)
+  {
+    NS_LOG_INFO ("The query log is empty.");
+    return;
+  }
+  m_origin = m_next.timestamp;
+  m_start = Simulator::Now () + delay;
+  m_replayEvent = Simulator::Schedule (delay, &DnsLogReplay::ReplayDue, this);
+}
+
+void
+DnsLogReplay::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_replayEvent.Cancel ();
+  m_reader.Close ();
+  m_hasNext = false;
+}
+
+void
+DnsLogReplay::DoDispose (void)
+{
+  Stop ();
+  m_clients.clear ();
+  if (m_outcomes.is_open ())
+  {
+    m_outcomes.close ();
+  }
+  Object::DoDispose ();
+}
+
+// Hand every record that is due to its client, then wait for the next one.
+// Records logged out of order are sent as soon as they are read.
+void
+DnsLogReplay::ReplayDue (void)
+{
+  while (m_hasNext)
+  {
+    int64_t offset = (m_next.timestamp - m_origin).GetNanoSeconds ();
+    Time due = m_start + NanoSeconds (static_cast<int64_t> (offset / m_speedup));
+    if (due > Simulator::Now ())
+    {
+      m_replayEvent = Simulator::Schedule (due - Simulator::Now (), &DnsLogReplay::ReplayDue, this);
+      return;
+    }
+
+    // The clients of the log are spread over the nodes by the hash of their name
+    uint32_t hash = DnsEventTrace::Hash (m_next.client);
+    m_clients[hash % m_clients.size ()]->Query (m_next.qName, m_next.qType, m_next.line);
+    m_replayedQueries++;
+
+    m_hasNext = m_reader.Next (m_next);
+  }
+  NS_LOG_INFO ("Replayed " << m_replayedQueries << " queries; " << m_reader.GetMalformedLines ()
+                           << " malformed lines skipped.");
+}
+
+void
+DnsLogReplay::HandleOutcome (const DnsQueryOutcome& outcome)
+{
+  if (!m_outcomes.is_open ())
+  {
+    return;
+  }
+  m_outcomes << outcome.tag << ' ' << outcome.sent.GetSeconds () << ' ' << outcome.qName << ' '
+             << RRTypeToString (outcome.qType) << ' ' << outcome.answered << ' ' << uint32_t (outcome.rcode)
+             << ' ' << outcome.latency.GetSeconds () << ' ' << outcome.retries << '\n';
+}
+
+}  // end of namespace ns3
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_QUERY_LOG_H
+#define DNS_QUERY_LOG_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ns3/application-container.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+
+#include "ns3/dns-client.h"
+
+namespace ns3
+{
+/**
+ * /brief A query of a query log */
+struct QueryLogRecord
+{
+  Time timestamp;      //!< when the query was logged
+  std::string client;  //!< the client that sent it, as logged
+  std::string qName;   //!< the name asked for
+  uint16_t qType;      //!< the type asked for
+  uint64_t line;       //!< line of the record in the log
+};
+
+/**
+ * /brief Reads a query log one record at a time.
+ *
+ * Every line holds a timestamp in seconds (with an optional fraction), the
+ * client, the name and the type, separated by blanks or commas, e.g.,
+ *   1700000000.000125 192.0.2.7 www.example.com A
+ * Types are given by mnemonic, as TYPE<n> or as a number. Empty lines and
+ * lines starting with '#' are skipped, and so are malformed lines, which
+ * are counted. The file is read through a large buffer and never held in
+ * memory as a whole, so logs of any size can be replayed. */
+class QueryLogReader
+{
+public:
+  QueryLogReader ();
+  ~QueryLogReader ();
+
+  /**
+   * /brief Open a log
+   * /returns false if the file cannot be read */
+  bool Open (const std::string& fileName);
+  void Close (void);
+
+  /**
+   * /brief Read the next record
+   * /returns false at the end of the log */
+  bool Next (QueryLogRecord& record);
+
+  uint64_t
+  GetMalformedLines (void) const
+  {
+    return m_malformedLines;
+  }
+
+private:
+  bool Parse (QueryLogRecord& record);
+
+  std::ifstream m_stream;      //!< the log
+  std::vector<char> m_buffer;  //!< stream buffer of m_stream
+  std::string m_line;          //!< the line being parsed, reused
+  uint64_t m_lineNumber;       //!< lines read so far
+  uint64_t m_malformedLines;   //!< lines skipped as malformed
+};
+
+/**
+ * /brief Replays a query log through a set of DnsClient applications.
+ *
+ * Every query of the log is sent at its logged time, relative to the first
+ * record and to the time the replay starts. The queries of a logged client
+ * always go through the same DnsClient, chosen by a hash of the client, so
+ * the per-client locality of the log is kept when there are fewer clients
+ * in the simulation than in the log.
+ *
+ * Only the next record is held in memory and a single event is pending at
+ * any time. The clients should use the Trace arrival process without
+ * scheduled queries, so that they only send the replayed ones.
+ *
+ * With OutcomeFileName set, the outcome of every query is written as
+ *   line sent qname qtype answered rcode latency retries
+ * where line is the line of the query in the log, sent and latency are in
+ * seconds, and answered is 1 or 0. */
+class DnsLogReplay : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  DnsLogReplay ();
+  virtual ~DnsLogReplay ();
+
+  void AddClient (Ptr<DnsClient> client);
+  void AddClients (ApplicationContainer clients);
+
+  /**
+   * /brief Start replaying FileName after the given delay */
+  void Start (Time delay);
+
+  /**
+   * /brief Stop the replay; queries already sent still complete */
+  void Stop (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void ReplayDue (void);
+  void HandleOutcome (const DnsQueryOutcome& outcome);
+
+  std::string m_fileName;          //!< the query log
+  std::string m_outcomeFileName;   //!< where outcomes are written ("" for nowhere)
+  double m_speedup;                //!< logged time is divided by this
+  std::vector<Ptr<DnsClient> > m_clients;  //!< clients the queries are spread over
+  QueryLogReader m_reader;         //!< the log being replayed
+  QueryLogRecord m_next;           //!< the next record to replay
+  bool m_hasNext;                  //!< false once the log is exhausted
+  Time m_origin;                   //!< timestamp of the first record
+  Time m_start;                    //!< simulation time of the first record
+  EventId m_replayEvent;           //!< replays the next record
+  std::ofstream m_outcomes;        //!< outcome file
+  uint64_t m_replayedQueries;      //!< queries handed to the clients
+};
+
+}  // end of namespace ns3
+
+#endif /* DNS_QUERY_LOG_H */
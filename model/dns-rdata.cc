@@ -0,0 +1,485 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <cstdlib>
+#include <sstream>
+
+#include "dns-rdata.h"
+
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("DNSRData");
+
+namespace ns3
+{
+// Helpers shared by the codecs.
+// Names and character strings are one length byte followed by the characters.
+
+static uint16_t
+GetStringSize (const std::string& value)
+{
+  return 1 + (value.size () > 255 ? 255 : value.size ());
+}
+
+static uint8_t*
+WriteString (uint8_t* start, const std::string& value)
+{
+  uint8_t length = value.size () > 255 ? 255 : value.size ();
+  *start++ = length;
+  value.copy (reinterpret_cast<char*> (start), length);
+  return start + length;
+}
+
+static const uint8_t*
+ReadString (const uint8_t* start, const uint8_t* end, std::string& value)
+{
+  if (start >= end || start + 1 + *start > end)
+  {
+    return 0;
+  }
+  value.assign (reinterpret_cast<const char*> (start + 1), *start);
+  return start + 1 + *start;
+}
+
+static uint8_t*
+WriteU16 (uint8_t* start, uint16_t value)
+{
+  start[0] = (value >> 8) & 0xff;
+  start[1] = value & 0xff;
+  return start + 2;
+}
+
+static uint8_t*
+WriteU32 (uint8_t* start, uint32_t value)
+{
+  start[0] = (value >> 24) & 0xff;
+  start[1] = (value >> 16) & 0xff;
+  start[2] = (value >> 8) & 0xff;
+  start[3] = value & 0xff;
+  return start + 4;
+}
+
+static uint32_t
+ReadU32 (const uint8_t* start)
+{
+  return (uint32_t (start[0]) << 24) | (uint32_t (start[1]) << 16) | (uint32_t (start[2]) << 8) | start[3];
+}
+
+// A
+
+uint16_t
+RDataCodec<RR_TYPE_A>::GetSize (const Value& /* value */)
+{
+  return 4;
+}
+
+void
+RDataCodec<RR_TYPE_A>::Write (uint8_t* start, const Value& value)
+{
+  value.Serialize (start);
+}
+
+bool
+RDataCodec<RR_TYPE_A>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  if (length != 4)
+  {
+    return false;
+  }
+  value = Ipv4Address::Deserialize (start);
+  return true;
+}
+
+bool
+RDataCodec<RR_TYPE_A>::Parse (const std::string& text, Value& value)
+{
+  value = Ipv4Address (text.c_str ());
+  return true;
+}
+
+void
+RDataCodec<RR_TYPE_A>::Print (std::ostream& os, const Value& value)
+{
+  os << value;
+}
+
+// AAAA
+
+uint16_t
+RDataCodec<RR_TYPE_AAAA>::GetSize (const Value& /* value */)
+{
+  return 16;
+}
+
+void
+RDataCodec<RR_TYPE_AAAA>::Write (uint8_t* start, const Value& value)
+{
+  value.Serialize (start);
+}
+
+bool
+RDataCodec<RR_TYPE_AAAA>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  if (length != 16)
+  {
+    return false;
+  }
+  value = Ipv6Address::Deserialize (start);
+  return true;
+}
+
+bool
+RDataCodec<RR_TYPE_AAAA>::Parse (const std::string& text, Value& value)
+{
+  value = Ipv6Address (text.c_str ());
+  return true;
+}
+
+void
+RDataCodec<RR_TYPE_AAAA>::Print (std::ostream& os, const Value& value)
+{
+  os << value;
+}
+
+// NS
+
+uint16_t
+RDataCodec<RR_TYPE_NS>::GetSize (const Value& value)
+{
+  return GetStringSize (value);
+}
+
+void
+RDataCodec<RR_TYPE_NS>::Write (uint8_t* start, const Value& value)
+{
+  WriteString (start, value);
+}
+
+bool
+RDataCodec<RR_TYPE_NS>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  return ReadString (start, start + length, value) == start + length;
+}
+
+bool
+RDataCodec<RR_TYPE_NS>::Parse (const std::string& text, Value& value)
+{
+  value = text;
+  return text.size () <= 255;
+}
+
+void
+RDataCodec<RR_TYPE_NS>::Print (std::ostream& os, const Value& value)
+{
+  os << value;
+}
+
+// CNAME
+
+uint16_t
+RDataCodec<RR_TYPE_CNAME>::GetSize (const Value& value)
+{
+  return GetStringSize (value);
+}
+
+void
+RDataCodec<RR_TYPE_CNAME>::Write (uint8_t* start, const Value& value)
+{
+  WriteString (start, value);
+}
+
+bool
+RDataCodec<RR_TYPE_CNAME>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  return ReadString (start, start + length, value) == start + length;
+}
+
+bool
+RDataCodec<RR_TYPE_CNAME>::Parse (const std::string& text, Value& value)
+{
+  value = text;
+  return text.size () <= 255;
+}
+
+void
+RDataCodec<RR_TYPE_CNAME>::Print (std::ostream& os, const Value& value)
+{
+  os << value;
+}
+
+// SOA
+
+uint16_t
+RDataCodec<RR_TYPE_SOA>::GetSize (const Value& value)
+{
+  return GetStringSize (value.mName) + GetStringSize (value.rName) + 5 * 4;
+}
+
+void
+RDataCodec<RR_TYPE_SOA>::Write (uint8_t* start, const Value& value)
+{
+  start = WriteString (start, value.mName);
+  start = WriteString (start, value.rName);
+  start = WriteU32 (start, value.serial);
+  start = WriteU32 (start, value.refresh);
+  start = WriteU32 (start, value.retry);
+  start = WriteU32 (start, value.expire);
+  WriteU32 (start, value.minimum);
+}
+
+bool
+RDataCodec<RR_TYPE_SOA>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  const uint8_t* end = start + length;
+  start = ReadString (start, end, value.mName);
+  if (start != 0)
+  {
+    start = ReadString (start, end, value.rName);
+  }
+  if (start == 0 || end - start != 5 * 4)
+  {
+    return false;
+  }
+  value.serial = ReadU32 (start);
+  value.refresh = ReadU32 (start + 4);
+  value.retry = ReadU32 (start + 8);
+  value.expire = ReadU32 (start + 12);
+  value.minimum = ReadU32 (start + 16);
+  return true;
+}
+
+// Presentation form: "mname rname serial refresh retry expire minimum"
+bool
+RDataCodec<RR_TYPE_SOA>::Parse (const std::string& text, Value& value)
+{
+  std::istringstream is (text);
+  is >> value.mName >> value.rName >> value.serial >> value.refresh >> value.retry >> value.expire >> value.minimum;
+  return !is.fail ();
+}
+
+void
+RDataCodec<RR_TYPE_SOA>::Print (std::ostream& os, const Value& value)
+{
+  os << value.mName << " " << value.rName << " " << value.serial << " " << value.refresh << " "
+     << value.retry << " " << value.expire << " " << value.minimum;
+}
+
+// MX
+
+uint16_t
+RDataCodec<RR_TYPE_MX>::GetSize (const Value& value)
+{
+  return 2 + GetStringSize (value.exchange);
+}
+
+void
+RDataCodec<RR_TYPE_MX>::Write (uint8_t* start, const Value& value)
+{
+  start = WriteU16 (start, value.preference);
+  WriteString (start, value.exchange);
+}
+
+bool
+RDataCodec<RR_TYPE_MX>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  if (length < 3)
+  {
+    return false;
+  }
+  value.preference = (start[0] << 8) | start[1];
+  return ReadString (start + 2, start + length, value.exchange) == start + length;
+}
+
+// Presentation form: "preference exchange"
+bool
+RDataCodec<RR_TYPE_MX>::Parse (const std::string& text, Value& value)
+{
+  std::istringstream is (text);
+  is >> value.preference >> value.exchange;
+  return !is.fail ();
+}
+
+void
+RDataCodec<RR_TYPE_MX>::Print (std::ostream& os, const Value& value)
+{
+  os << value.preference << " " << value.exchange;
+}
+
+// TXT
+
+uint16_t
+RDataCodec<RR_TYPE_TXT>::GetSize (const Value& value)
+{
+  // one length byte per started 255 byte string, at least one string
+  return value.size () + (value.size () + 254) / 255 + (value.empty () ? 1 : 0);
+}
+
+void
+RDataCodec<RR_TYPE_TXT>::Write (uint8_t* start, const Value& value)
+{
+  std::string::size_type offset = 0;
+  do
+  {
+    start = WriteString (start, value.substr (offset, 255));
+    offset += 255;
+  } while (offset < value.size ());
+}
+
+bool
+RDataCodec<RR_TYPE_TXT>::Read (const uint8_t* start, uint16_t length, Value& value)
+{
+  const uint8_t* end = start + length;
+  std::string part;
+  value.clear ();
+  while (start != 0 && start < end)
+  {
+    start = ReadString (start, end, part);
+    value += part;
+  }
+  return start == end;
+}
+
+bool
+RDataCodec<RR_TYPE_TXT>::Parse (const std::string& text, Value& value)
+{
+  value = text;
+  return text.size () <= 65000;
+}
+
+void
+RDataCodec<RR_TYPE_TXT>::Print (std::ostream& os, const Value& value)
+{
+  os << "\"" << value << "\"";
+}
+
+// Runtime dispatch on the record type
+
+template <uint16_t Type>
+static bool
+ParseRData (const std::string& text, std::vector<uint8_t>& wire)
+{
+  typename RDataCodec<Type>::Value value;
+  if (!RDataCodec<Type>::Parse (text, value))
+  {
+    return false;
+  }
+  EncodeRData<Type> (value, wire);
+  return true;
+}
+
+template <uint16_t Type>
+static std::string
+PrintRData (const std::vector<uint8_t>& wire)
+{
+  typename RDataCodec<Type>::Value value;
+  std::ostringstream os;
+  if (DecodeRData<Type> (wire, value))
+  {
+    RDataCodec<Type>::Print (os, value);
+  }
+  return os.str ();
+}
+
+bool
+RDataFromString (uint16_t type, const std::string& text, std::vector<uint8_t>& wire)
+{
+  switch (type)
+  {
+  case RR_TYPE_A:
+    return ParseRData<RR_TYPE_A> (text, wire);
+  case RR_TYPE_AAAA:
+    return ParseRData<RR_TYPE_AAAA> (text, wire);
+  case RR_TYPE_NS:
+    return ParseRData<RR_TYPE_NS> (text, wire);
+  case RR_TYPE_CNAME:
+    return ParseRData<RR_TYPE_CNAME> (text, wire);
+  case RR_TYPE_SOA:
+    return ParseRData<RR_TYPE_SOA> (text, wire);
+  case RR_TYPE_MX:
+    return ParseRData<RR_TYPE_MX> (text, wire);
+  case RR_TYPE_TXT:
+    return ParseRData<RR_TYPE_TXT> (text, wire);
+  default:
+    NS_LOG_LOGIC ("No codec for type " << type << ". Keeping the RDATA as opaque bytes.");
+    wire.assign (text.begin (), text.end ());
+    return true;
+  }
+}
+
+std::string
+RDataToString (uint16_t type, const std::vector<uint8_t>& wire)
+{
+  switch (type)
+  {
+  case RR_TYPE_A:
+    return PrintRData<RR_TYPE_A> (wire);
+  case RR_TYPE_AAAA:
+    return PrintRData<RR_TYPE_AAAA> (wire);
+  case RR_TYPE_NS:
+    return PrintRData<RR_TYPE_NS> (wire);
+  case RR_TYPE_CNAME:
+    return PrintRData<RR_TYPE_CNAME> (wire);
+  case RR_TYPE_SOA:
+    return PrintRData<RR_TYPE_SOA> (wire);
+  case RR_TYPE_MX:
+    return PrintRData<RR_TYPE_MX> (wire);
+  case RR_TYPE_TXT:
+    return PrintRData<RR_TYPE_TXT> (wire);
+  default:
+    return std::string (wire.begin (), wire.end ());
+  }
+}
+
+std::string
+RRTypeToString (uint16_t type)
+{
+  switch (type)
+  {
+  case RR_TYPE_A:
+    return "A";
+  case RR_TYPE_AAAA:
+    return "AAAA";
+  case RR_TYPE_NS:
+    return "NS";
+  case RR_TYPE_CNAME:
+    return "CNAME";
+  case RR_TYPE_SOA:
+    return "SOA";
+  case RR_TYPE_MX:
+    return "MX";
+  case RR_TYPE_TXT:
+    return "TXT";
+  default:
+    std::ostringstream os;
+    os << "TYPE" << type;
+    return os.str ();
+  }
+}
+
+bool
+RRTypeFromString (const std::string& text, uint16_t& type)
+{
+  static const uint16_t known[] = {RR_TYPE_A, RR_TYPE_AAAA, RR_TYPE_NS, RR_TYPE_CNAME,
+                                   RR_TYPE_SOA, RR_TYPE_MX, RR_TYPE_TXT};
+  for (std::size_t n = 0; n < sizeof (known) / sizeof (known[0]); n++)
+  {
+    if (text == RRTypeToString (known[n]))
+    {
+      type = known[n];
+      return true;
+    }
+  }
+
+  std::string digits = text.compare (0, 4, "TYPE") == 0 ? text.substr (4) : text;
+  if (digits.empty () || digits.size () > 5 || digits.find_first_not_of ("0123456789") != std::string::npos)
+  {
+    return false;
+  }
+  uint32_t value = std::atoi (digits.c_str ());
+  if (value > 0xffff)
+  {
+    return false;
+  }
+  type = value;
+  return true;
+}
+}
@@ -0,0 +1,212 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_RDATA_H
+#define DNS_RDATA_H
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+
+namespace ns3
+{
+/**
+ * /brief Numeric values of the supported resource record types (RFC 1035, RFC 3596) */
+enum RRType
+{
+  RR_TYPE_A = 1,       //!< IPv4 host address
+  RR_TYPE_NS = 2,      //!< Authoritative name server
+  RR_TYPE_CNAME = 5,   //!< Canonical name of an alias
+  RR_TYPE_SOA = 6,     //!< Start of a zone of authority
+  RR_TYPE_MX = 15,     //!< Mail exchange
+  RR_TYPE_TXT = 16,    //!< Text strings
+  RR_TYPE_AAAA = 28,   //!< IPv6 host address
+};
+
+/**
+ * /brief Numeric values of the resource record classes */
+enum RRClass
+{
+  RR_CLASS_IN = 1,  //!< the Internet
+};
+
+/**
+ * /brief In-memory form of a SOA record */
+struct SOARData
+{
+  SOARData ()
+    : serial (0),
+      refresh (0),
+      retry (0),
+      expire (0),
+      minimum (0)
+  {
+  }
+  std::string mName;  //!< primary name server of the zone
+  std::string rName;  //!< mailbox of the person responsible for the zone
+  uint32_t serial;
+  uint32_t refresh;
+  uint32_t retry;
+  uint32_t expire;
+  uint32_t minimum;
+};
+
+/**
+ * /brief In-memory form of a MX record */
+struct MXRData
+{
+  MXRData ()
+    : preference (0)
+  {
+  }
+  uint16_t preference;
+  std::string exchange;
+};
+
+/**
+ * /brief Encoder and decoder for the RDATA of one record type.
+ *
+ * Every supported type specializes this template with
+ *  - Value: the compact in-memory form of the RDATA,
+ *  - GetSize: the number of bytes of the encoded RDATA,
+ *  - Write / Read: direct conversion between Value and the encoded bytes,
+ *  - Parse / Print: conversion from and to the zone-file presentation form.
+ *
+ * Domain names inside RDATA are carried as one length byte followed by
+ * the characters of the name. The primary template is left undefined so
+ * that typed access to an unsupported type fails at compile time. */
+template <uint16_t Type>
+struct RDataCodec;
+
+template <>
+struct RDataCodec<RR_TYPE_A>
+{
+  typedef Ipv4Address Value;
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+template <>
+struct RDataCodec<RR_TYPE_AAAA>
+{
+  typedef Ipv6Address Value;
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+template <>
+struct RDataCodec<RR_TYPE_NS>
+{
+  typedef std::string Value;  //!< name of the server
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+template <>
+struct RDataCodec<RR_TYPE_CNAME>
+{
+  typedef std::string Value;  //!< canonical name
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+template <>
+struct RDataCodec<RR_TYPE_SOA>
+{
+  typedef SOARData Value;
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+template <>
+struct RDataCodec<RR_TYPE_MX>
+{
+  typedef MXRData Value;
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+template <>
+struct RDataCodec<RR_TYPE_TXT>
+{
+  typedef std::string Value;  //!< text, split in 255 byte strings on the wire
+  static uint16_t GetSize (const Value& value);
+  static void Write (uint8_t* start, const Value& value);
+  static bool Read (const uint8_t* start, uint16_t length, Value& value);
+  static bool Parse (const std::string& text, Value& value);
+  static void Print (std::ostream& os, const Value& value);
+};
+
+/**
+ * /brief Encode a typed RDATA value
+ * /param value the value to encode
+ * /param wire receives the encoded RDATA */
+template <uint16_t Type>
+void
+EncodeRData (const typename RDataCodec<Type>::Value& value, std::vector<uint8_t>& wire)
+{
+  wire.resize (RDataCodec<Type>::GetSize (value));
+  if (!wire.empty ())
+  {
+    RDataCodec<Type>::Write (&wire[0], value);
+  }
+}
+
+/**
+ * /brief Decode encoded RDATA into its typed value
+ * /param wire the encoded RDATA
+ * /param value receives the decoded value
+ * /returns false if the bytes are not a valid RDATA of this type */
+template <uint16_t Type>
+bool
+DecodeRData (const std::vector<uint8_t>& wire, typename RDataCodec<Type>::Value& value)
+{
+  if (wire.empty ())
+  {
+    return false;
+  }
+  return RDataCodec<Type>::Read (&wire[0], wire.size (), value);
+}
+
+/**
+ * /brief Encode RDATA given in presentation form according to its type.
+ * The text of a type without a codec is kept as opaque bytes.
+ * /returns false if the text is not valid for the type */
+bool RDataFromString (uint16_t type, const std::string& text, std::vector<uint8_t>& wire);
+
+/**
+ * /brief Get the presentation form of encoded RDATA of the given type */
+std::string RDataToString (uint16_t type, const std::vector<uint8_t>& wire);
+
+/**
+ * /brief Get the mnemonic of a record type (e.g., "A" or "CNAME") */
+std::string RRTypeToString (uint16_t type);
+
+/**
+ * /brief Parse a record type given as a mnemonic, as "TYPE<n>" or as a number
+ * /returns false if the text is not a record type */
+bool RRTypeFromString (const std::string& text, uint16_t& type);
+
+}  // end of namespace ns3
+
+#endif /* DNS_RDATA_H */
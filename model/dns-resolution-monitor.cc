@@ -0,0 +1,376 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "dns-resolution-monitor.h"
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include "ns3/bind-server.h"
+
+NS_LOG_COMPONENT_DEFINE ("DnsResolutionMonitor");
+
+namespace ns3
+{
+LatencyHistogram::LatencyHistogram (uint32_t precisionBits)
+  : m_precisionBits (precisionBits)
+{
+  Reset ();
+}
+
+void
+LatencyHistogram::Reset (void)
+{
+  m_counts.clear ();
+  m_count = 0;
+  m_min = std::numeric_limits<uint64_t>::max ();
+  m_max = 0;
+  m_sum = 0;
+}
+
+// Values below 2^b have their own bucket. A larger value v with its highest
+// bit at position b + e falls into octave e, and into the bucket of that
+// octave given by the b bits after its highest bit.
+uint32_t
+LatencyHistogram::GetIndex (uint64_t value) const
+{
+  uint64_t buckets = uint64_t (1) << m_precisionBits;
+  if (value < buckets)
+  {
+    return value;
+  }
+  uint32_t octave = 0;
+  while ((value >> octave) >= 2 * buckets)
+  {
+    octave++;
+  }
+  return buckets * (octave + 1) + ((value >> octave) - buckets);
+}
+
+uint64_t
+LatencyHistogram::GetUpperBound (uint32_t index) const
+{
+  uint64_t buckets = uint64_t (1) << m_precisionBits;
+  if (index < buckets)
+  {
+    return index;
+  }
+  uint32_t octave = index / buckets - 1;
+  uint64_t mantissa = buckets + index % buckets;
+  return ((mantissa + 1) << octave) - 1;
+}
+
+void
+LatencyHistogram::Record (Time latency)
+{
+  int64_t nanoSeconds = latency.GetNanoSeconds ();
+  uint64_t value = nanoSeconds < 0 ? 0 : nanoSeconds;
+  uint32_t index = GetIndex (value);
+  if (index >= m_counts.size ())
+  {
+    m_counts.resize (index + 1, 0);
+  }
+  m_counts[index]++;
+  m_count++;
+  m_min = std::min (m_min, value);
+  m_max = std::max (m_max, value);
+  m_sum += value;
+}
+
+void
+LatencyHistogram::Merge (const LatencyHistogram& other)
+{
+  NS_ASSERT_MSG (other.m_precisionBits == m_precisionBits, "Histograms of different precision");
+
+  if (other.m_counts.size () > m_counts.size ())
+  {
+    m_counts.resize (other.m_counts.size (), 0);
+  }
+  for (std::size_t index = 0; index < other.m_counts.size (); index++)
+  {
+    m_counts[index] += other.m_counts[index];
+  }
+  m_count += other.m_count;
+  m_min = std::min (m_min, other.m_min);
+  m_max = std::max (m_max, other.m_max);
+  m_sum += other.m_sum;
+}
+
+Time
+LatencyHistogram::GetMin (void) const
+{
+  return NanoSeconds (m_count == 0 ? 0 : m_min);
+}
+
+Time
+LatencyHistogram::GetMax (void) const
+{
+  return NanoSeconds (m_max);
+}
+
+Time
+LatencyHistogram::GetMean (void) const
+{
+  return NanoSeconds (m_count == 0 ? 0 : static_cast<int64_t> (m_sum / m_count));
+}
+
+Time
+LatencyHistogram::GetQuantile (double quantile) const
+{
+  if (m_count == 0)
+  {
+    return Time (0);
+  }
+  // Rank of the value wanted, counting from one
+  uint64_t rank = static_cast<uint64_t> (std::ceil (quantile * m_count));
+  rank = std::max<uint64_t> (rank, 1);
+
+  uint64_t seen = 0;
+  for (std::size_t index = 0; index < m_counts.size (); index++)
+  {
+    seen += m_counts[index];
+    if (seen >= rank)
+    {
+      return NanoSeconds (std::min (GetUpperBound (index), m_max));
+    }
+  }
+  return NanoSeconds (m_max);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DnsResolutionMonitor);
+
+TypeId
+DnsResolutionMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DnsResolutionMonitor")
+                        .SetParent<Object> ()
+                        .AddConstructor<DnsResolutionMonitor> ()
+                        .AddAttribute ("PrecisionBits",
+                                       "Buckets per power of two of the histograms, as a power of two. "
+                                       "Latencies are known within a relative error of 2^-PrecisionBits. "
+                                       "Only takes effect before the first query is recorded.",
+                                       UintegerValue (7),
+                                       MakeUintegerAccessor (&DnsResolutionMonitor::m_precisionBits),
+                                       MakeUintegerChecker<uint32_t> (1, 16));
+  return tid;
+}
+
+DnsResolutionMonitor::DnsResolutionMonitor ()
+  : m_precisionBits (7),
+    m_total (7),
+    m_interval (7)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DnsResolutionMonitor::~DnsResolutionMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DnsResolutionMonitor::Install (Ptr<DnsClient> client, std::string name)
+{
+  NS_LOG_FUNCTION (this << client << name);
+
+  if (name.empty ())
+  {
+    Ptr<Node> node = client->GetNode ();
+    uint32_t index = 0;
+    while (index < node->GetNApplications () && node->GetApplication (index) != client)
+    {
+      index++;
+    }
+    std::ostringstream os;
+    os << "node " << node->GetId () << "/" << index;
+    name = os.str ();
+  }
+  client->TraceConnect ("Outcome", name, MakeCallback (&DnsResolutionMonitor::HandleOutcome, this));
+}
+
+void
+DnsResolutionMonitor::Install (ApplicationContainer clients)
+{
+  for (ApplicationContainer::Iterator it = clients.Begin (); it != clients.End (); it++)
+  {
+    Install ((*it)->GetObject<DnsClient> ());
+  }
+}
+
+void
+DnsResolutionMonitor::DoDispose (void)
+{
+  StopSnapshots ();
+  m_snapshotStream = 0;
+  Object::DoDispose ();
+}
+
+void
+DnsResolutionMonitor::StartSnapshots (Time interval, Ptr<OutputStreamWrapper> stream)
+{
+  NS_LOG_FUNCTION (this << interval);
+
+  m_snapshotEvent.Cancel ();
+  m_snapshotInterval = interval;
+  m_snapshotStream = stream;
+  m_interval = Statistics (m_precisionBits);
+  m_snapshotEvent = Simulator::Schedule (interval, &DnsResolutionMonitor::WriteSnapshot, this);
+}
+
+void
+DnsResolutionMonitor::StopSnapshots (void)
+{
+  m_snapshotEvent.Cancel ();
+}
+
+void
+DnsResolutionMonitor::HandleOutcome (std::string client, const DnsQueryOutcome& outcome)
+{
+  if (m_total.latency.GetCount () == 0 && m_total.failures == 0)
+  {
+    // Nothing recorded yet, so a changed precision can still take effect
+    m_total = Statistics (m_precisionBits);
+    m_interval = Statistics (m_precisionBits);
+  }
+
+  Record (m_total, outcome);
+  if (m_snapshotEvent.IsRunning ())
+  {
+    Record (m_interval, outcome);
+  }
+
+  ClientStatisticsI perClient = m_clients.find (client);
+  if (perClient == m_clients.end ())
+  {
+    perClient = m_clients.insert (std::make_pair (client, Statistics (m_precisionBits))).first;
+  }
+  Record (perClient->second, outcome);
+
+  ResolverStatisticsI perResolver = m_resolvers.find (outcome.resolver);
+  if (perResolver == m_resolvers.end ())
+  {
+    perResolver = m_resolvers.insert (std::make_pair (outcome.resolver, Statistics (m_precisionBits))).first;
+  }
+  Record (perResolver->second, outcome);
+
+  for (std::vector<DnsResolutionHop>::const_iterator hop = outcome.hops.begin (); hop != outcome.hops.end (); hop++)
+  {
+    HopStatisticsI perRole = m_hops.find (hop->role);
+    if (perRole == m_hops.end ())
+    {
+      perRole = m_hops.insert (std::make_pair (hop->role, LatencyHistogram (m_precisionBits))).first;
+    }
+    perRole->second.Record (hop->departure - hop->arrival);
+  }
+}
+
+void
+DnsResolutionMonitor::Record (Statistics& statistics, const DnsQueryOutcome& outcome)
+{
+  if (outcome.answered)
+  {
+    statistics.latency.Record (outcome.latency);
+  }
+  else
+  {
+    statistics.failures++;
+  }
+}
+
+void
+DnsResolutionMonitor::WriteSnapshot (void)
+{
+  const LatencyHistogram& latency = m_interval.latency;
+  *m_snapshotStream->GetStream () << Simulator::Now ().GetSeconds () << ' ' << latency.GetCount () << ' '
+                                  << m_interval.failures << ' '
+                                  << latency.GetQuantile (0.5).GetSeconds () * 1000 << ' '
+                                  << latency.GetQuantile (0.95).GetSeconds () * 1000 << ' '
+                                  << latency.GetQuantile (0.99).GetSeconds () * 1000 << ' '
+                                  << latency.GetQuantile (0.999).GetSeconds () * 1000 << ' '
+                                  << latency.GetMax ().GetSeconds () * 1000 << std::endl;
+
+  m_interval = Statistics (m_precisionBits);
+  m_snapshotEvent = Simulator::Schedule (m_snapshotInterval, &DnsResolutionMonitor::WriteSnapshot, this);
+}
+
+static std::string
+RoleName (uint8_t role)
+{
+  switch (role)
+  {
+  case BindServer::LOCAL_SERVER:
+    return "local";
+  case BindServer::ROOT_SERVER:
+    return "root";
+  case BindServer::TLD_SERVER:
+    return "tld";
+  case BindServer::ISP_SERVER:
+    return "isp";
+  case BindServer::AUTH_SERVER:
+    return "auth";
+  default:
+    return "unknown";
+  }
+}
+
+void
+DnsResolutionMonitor::WriteStatistics (std::ostream& os,
+                                       const std::string& name,
+                                       const LatencyHistogram& latency,
+                                       uint64_t failures)
+{
+  os << std::left << std::setw (24) << name << std::right << std::setw (10) << latency.GetCount ()
+     << std::setw (8) << failures;
+  double quantiles[] = {0.5, 0.95, 0.99, 0.999};
+  for (std::size_t n = 0; n < sizeof (quantiles) / sizeof (quantiles[0]); n++)
+  {
+    os << std::setw (10) << latency.GetQuantile (quantiles[n]).GetSeconds () * 1000;
+  }
+  os << std::setw (10) << latency.GetMax ().GetSeconds () * 1000 << std::endl;
+}
+
+void
+DnsResolutionMonitor::Report (std::ostream& os) const
+{
+  std::ios::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os << std::fixed << std::setprecision (3);
+
+  os << "Resolution latency (ms)" << std::endl;
+  os << std::left << std::setw (24) << "" << std::right << std::setw (10) << "answered" << std::setw (8)
+     << "failed" << std::setw (10) << "p50" << std::setw (10) << "p95" << std::setw (10) << "p99"
+     << std::setw (10) << "p999" << std::setw (10) << "max" << std::endl;
+
+  WriteStatistics (os, "total", m_total.latency, m_total.failures);
+  for (ClientStatisticsCI it = m_clients.begin (); it != m_clients.end (); it++)
+  {
+    WriteStatistics (os, "client " + it->first, it->second.latency, it->second.failures);
+  }
+  for (ResolverStatisticsCI it = m_resolvers.begin (); it != m_resolvers.end (); it++)
+  {
+    std::ostringstream name;
+    name << "resolver " << it->first;
+    WriteStatistics (os, name.str (), it->second.latency, it->second.failures);
+  }
+
+  if (!m_hops.empty ())
+  {
+    os << "Time at the servers (ms)" << std::endl;
+    for (HopStatisticsCI it = m_hops.begin (); it != m_hops.end (); it++)
+    {
+      WriteStatistics (os, RoleName (it->first), it->second, 0);
+    }
+  }
+
+  os.flags (flags);
+  os.precision (precision);
+}
+
+}  // end of namespace ns3
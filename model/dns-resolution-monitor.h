@@ -0,0 +1,161 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_RESOLUTION_MONITOR_H
+#define DNS_RESOLUTION_MONITOR_H
+
+#include <stdint.h>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/application-container.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/ptr.h"
+
+#include "ns3/dns-client.h"
+
+namespace ns3
+{
+/**
+ * /brief Log-linear histogram of latencies, in the manner of HdrHistogram.
+ *
+ * Values below 2^b nanoseconds have a bucket each. Above that, every power
+ * of two is split into 2^b equal buckets, so a value is known within a
+ * relative error of 2^-b whatever its magnitude, and the memory used grows
+ * only with the logarithm of the largest value. Recording is a few shifts
+ * and an increment. */
+class LatencyHistogram
+{
+public:
+  /**
+   * /param precisionBits b, the buckets per power of two are 2^b */
+  LatencyHistogram (uint32_t precisionBits = 7);
+
+  void Record (Time latency);
+  void Merge (const LatencyHistogram& other);
+  void Reset (void);
+
+  uint64_t
+  GetCount (void) const
+  {
+    return m_count;
+  }
+  Time GetMin (void) const;
+  Time GetMax (void) const;
+  Time GetMean (void) const;
+
+  /**
+   * /brief Get the latency below which the given fraction of the values lie
+   * /param quantile between 0 and 1, e.g., 0.99 for the 99th percentile
+   * /returns the upper end of the bucket holding the quantile, or the largest
+   * value recorded if that is lower */
+  Time GetQuantile (double quantile) const;
+
+private:
+  uint32_t GetIndex (uint64_t value) const;
+  uint64_t GetUpperBound (uint32_t index) const;
+
+  uint32_t m_precisionBits;       //!< b
+  std::vector<uint64_t> m_counts;  //!< values per bucket, grown on demand
+  uint64_t m_count;               //!< values recorded
+  uint64_t m_min;                 //!< smallest value, in nanoseconds
+  uint64_t m_max;                 //!< largest value, in nanoseconds
+  double m_sum;                   //!< sum of the values, in nanoseconds
+};
+
+/**
+ * /brief Collects the resolution latency seen by DnsClient applications.
+ *
+ * Like FlowMonitor, the monitor is installed on the clients and follows
+ * every query to its answer, here through the Outcome trace source of the
+ * clients. Latencies of answered queries are kept in a LatencyHistogram for
+ * all queries, per client and per resolver; queries that got no answer are
+ * counted apart. Report writes the percentiles at the end of the run, and
+ * StartSnapshots writes the percentiles of every interval while it runs.
+ *
+ * Clients with EnableResolutionTag report the servers of every resolution
+ * as well, and the time spent at each of them is kept per server role. The
+ * time at the Local server includes the time it waits for upstream servers. */
+class DnsResolutionMonitor : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  DnsResolutionMonitor ();
+  virtual ~DnsResolutionMonitor ();
+
+  /**
+   * /brief Monitor a client, reported under the given name
+   * (by default "node <id>/<index of the application>") */
+  void Install (Ptr<DnsClient> client, std::string name = "");
+  void Install (ApplicationContainer clients);
+
+  /**
+   * /brief Write the percentiles of every interval to the stream, one line
+   * per interval: time, answered, failed, p50, p95, p99, p999, max (in ms) */
+  void StartSnapshots (Time interval, Ptr<OutputStreamWrapper> stream);
+  void StopSnapshots (void);
+
+  /**
+   * /brief Write the percentiles of the whole run: in total, per client and per resolver */
+  void Report (std::ostream& os) const;
+
+  const LatencyHistogram&
+  GetHistogram (void) const
+  {
+    return m_total.latency;
+  }
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// Latencies and failures of a group of queries
+  struct Statistics
+  {
+    Statistics (uint32_t precisionBits)
+      : latency (precisionBits),
+        failures (0)
+    {
+    }
+    LatencyHistogram latency;  //!< latencies of the answered queries
+    uint64_t failures;         //!< queries without an answer
+  };
+
+  typedef std::map<std::string, Statistics> ClientStatistics;
+  typedef std::map<std::string, Statistics>::iterator ClientStatisticsI;
+  typedef std::map<std::string, Statistics>::const_iterator ClientStatisticsCI;
+
+  typedef std::map<Ipv4Address, Statistics> ResolverStatistics;
+  typedef std::map<Ipv4Address, Statistics>::iterator ResolverStatisticsI;
+  typedef std::map<Ipv4Address, Statistics>::const_iterator ResolverStatisticsCI;
+
+  typedef std::map<uint8_t, LatencyHistogram> HopStatistics;
+  typedef std::map<uint8_t, LatencyHistogram>::iterator HopStatisticsI;
+  typedef std::map<uint8_t, LatencyHistogram>::const_iterator HopStatisticsCI;
+
+  void HandleOutcome (std::string client, const DnsQueryOutcome& outcome);
+  void WriteSnapshot (void);
+  static void Record (Statistics& statistics, const DnsQueryOutcome& outcome);
+  static void WriteStatistics (std::ostream& os,
+                               const std::string& name,
+                               const LatencyHistogram& latency,
+                               uint64_t failures);
+
+  uint32_t m_precisionBits;           //!< precision of the histograms
+  Statistics m_total;                 //!< every query
+  Statistics m_interval;              //!< queries since the last snapshot
+  ClientStatistics m_clients;         //!< queries per client
+  ResolverStatistics m_resolvers;     //!< queries per resolver
+  HopStatistics m_hops;               //!< time spent at the servers, by role
+  Time m_snapshotInterval;            //!< time between snapshots
+  Ptr<OutputStreamWrapper> m_snapshotStream;  //!< where snapshots are written
+  EventId m_snapshotEvent;            //!< writes the next snapshot
+};
+
+}  // end of namespace ns3
+
+#endif /* DNS_RESOLUTION_MONITOR_H */
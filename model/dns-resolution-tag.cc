@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+
+#include "dns-resolution-tag.h"
+
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("DnsResolutionTag");
+
+namespace ns3
+{
+NS_OBJECT_ENSURE_REGISTERED (DnsResolutionTag);
+
+// Serialized size of the sending time with the hop count, and of one hop
+static const uint32_t SENT_SIZE = 8 + 1;
+static const uint32_t HOP_SIZE = 4 + 1 + 8 + 8;
+
+TypeId
+DnsResolutionTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DnsResolutionTag")
+                        .SetParent<Tag> ()
+                        .AddConstructor<DnsResolutionTag> ();
+  return tid;
+}
+
+TypeId
+DnsResolutionTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+DnsResolutionTag::DnsResolutionTag ()
+  : m_sent (Seconds (0))
+{
+}
+
+uint32_t
+DnsResolutionTag::GetSerializedSize (void) const
+{
+  return SENT_SIZE + m_hops.size () * HOP_SIZE;
+}
+
+void
+DnsResolutionTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_sent.GetNanoSeconds ());
+  i.WriteU8 (m_hops.size ());
+  for (std::vector<DnsResolutionHop>::const_iterator it = m_hops.begin (); it != m_hops.end (); it++)
+  {
+    i.WriteU32 (it->node);
+    i.WriteU8 (it->role);
+    i.WriteU64 (it->arrival.GetNanoSeconds ());
+    i.WriteU64 (it->departure.GetNanoSeconds ());
+  }
+}
+
+void
+DnsResolutionTag::Deserialize (TagBuffer i)
+{
+  m_sent = NanoSeconds (static_cast<int64_t> (i.ReadU64 ()));
+  m_hops.resize (i.ReadU8 ());
+  for (std::vector<DnsResolutionHop>::iterator it = m_hops.begin (); it != m_hops.end (); it++)
+  {
+    it->node = i.ReadU32 ();
+    it->role = i.ReadU8 ();
+    it->arrival = NanoSeconds (static_cast<int64_t> (i.ReadU64 ()));
+    it->departure = NanoSeconds (static_cast<int64_t> (i.ReadU64 ()));
+  }
+}
+
+void
+DnsResolutionTag::Print (std::ostream& os) const
+{
+  os << "sent=" << m_sent.GetSeconds ();
+  for (std::vector<DnsResolutionHop>::const_iterator it = m_hops.begin (); it != m_hops.end (); it++)
+  {
+    os << " [node " << it->node << " role " << uint32_t (it->role) << " " << it->arrival.GetSeconds () << "-"
+       << it->departure.GetSeconds () << "]";
+  }
+}
+
+void
+DnsResolutionTag::AddHop (uint32_t node, uint8_t role, Time arrival)
+{
+  if (m_hops.size () >= MAX_HOPS)
+  {
+    NS_LOG_LOGIC ("Dropping a hop of node " << node << "; the tag is full.");
+    return;
+  }
+  DnsResolutionHop hop;
+  hop.node = node;
+  hop.role = role;
+  hop.arrival = arrival;
+  hop.departure = arrival;
+  m_hops.push_back (hop);
+}
+
+void
+DnsResolutionTag::AddHops (const DnsResolutionTag& other)
+{
+  std::size_t room = MAX_HOPS - std::min<std::size_t> (m_hops.size (), MAX_HOPS);
+  std::size_t added = std::min (room, other.m_hops.size ());
+  m_hops.insert (m_hops.end (), other.m_hops.begin (), other.m_hops.begin () + added);
+}
+
+void
+DnsResolutionTag::SetDeparture (Time departure)
+{
+  if (!m_hops.empty ())
+  {
+    m_hops.back ().departure = departure;
+  }
+}
+
+}  // end of namespace ns3
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_RESOLUTION_TAG_H
+#define DNS_RESOLUTION_TAG_H
+
+#include <stdint.h>
+#include <ostream>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/tag.h"
+
+namespace ns3
+{
+/**
+ * /brief A server a resolution went through */
+struct DnsResolutionHop
+{
+  uint32_t node;   //!< ID of the node of the server
+  uint8_t role;    //!< BindServer::ServerType of the server
+  Time arrival;    //!< when the message reached the server
+  Time departure;  //!< when the server sent its reply
+};
+
+/**
+ * /brief Resolution context carried by DNS messages as a packet tag.
+ *
+ * A DnsClient tags its queries with the time they were sent. Every server
+ * that receives a tagged query tags its reply with the hops of the query
+ * and one hop of its own, stamped with the arrival of the query and the
+ * departure of the reply. The Local server tags its upstream queries and
+ * collects the hops of the upstream replies, so the reply to the client
+ * holds every server of the resolution, in the order they replied, e.g.,
+ * Root, TLD, Auth and finally the Local server itself. The time spent at
+ * every hop and between them follows from the stamps.
+ *
+ * The tag is simulation metadata and does not change the size of the
+ * messages. Packet tags do not cross byte streams, so the hops of
+ * messages carried over TCP are not recorded. */
+class DnsResolutionTag : public Tag
+{
+public:
+  /// Hops kept at most; further hops are dropped
+  static const uint32_t MAX_HOPS = 16;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream& os) const;
+
+  DnsResolutionTag ();
+
+  /**
+   * /brief Set when the query carrying the tag was sent */
+  void
+  SetSent (Time sent)
+  {
+    m_sent = sent;
+  }
+  Time
+  GetSent (void) const
+  {
+    return m_sent;
+  }
+
+  /**
+   * /brief Add the hop of a server; it departs with SetDeparture */
+  void AddHop (uint32_t node, uint8_t role, Time arrival);
+
+  /**
+   * /brief Add the hops of another tag, e.g., of an upstream reply */
+  void AddHops (const DnsResolutionTag& other);
+
+  /**
+   * /brief Stamp the last hop with the time its reply leaves the server */
+  void SetDeparture (Time departure);
+
+  const std::vector<DnsResolutionHop>&
+  GetHops (void) const
+  {
+    return m_hops;
+  }
+
+private:
+  Time m_sent;                          //!< when the query was sent
+  std::vector<DnsResolutionHop> m_hops;  //!< the servers, in the order they replied
+};
+
+}  // end of namespace ns3
+
+#endif /* DNS_RESOLUTION_TAG_H */
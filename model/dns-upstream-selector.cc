@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <algorithm>
+
+#include "dns-upstream-selector.h"
+
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("DNSUpstreamSelector");
+
+namespace ns3
+{
+// Upper bound of an estimate, so a server that was down recovers after a few decays
+static const double MAX_SRTT_US = 10e6;
+
+UpstreamSelector::UpstreamSelector ()
+  : m_smoothing (0.7),
+    m_decay (0.98),
+    m_probeProbability (0.05)
+{
+  m_rng = CreateObject<UniformRandomVariable> ();
+}
+
+void
+UpstreamSelector::ReportRtt (Ipv4Address server, Time rtt)
+{
+  NS_LOG_FUNCTION (this << server << rtt);
+
+  double& srtt = GetEstimate (server);
+  srtt = m_smoothing * srtt + (1 - m_smoothing) * rtt.GetMicroSeconds ();
+}
+
+void
+UpstreamSelector::ReportTimeout (Ipv4Address server, Time timeout)
+{
+  NS_LOG_FUNCTION (this << server << timeout);
+
+  double& srtt = GetEstimate (server);
+  srtt = std::max (2 * srtt, double (timeout.GetMicroSeconds ()));
+  srtt = std::min (srtt, MAX_SRTT_US);
+}
+
+Time
+UpstreamSelector::GetSrtt (Ipv4Address server) const
+{
+  SrttMapCI it = m_srtt.find (server);
+  if (it == m_srtt.end ())
+  {
+    return Time (0);
+  }
+  return MicroSeconds (it->second);
+}
+
+Ipv4Address
+UpstreamSelector::Select (const std::vector<Ipv4Address>& candidates)
+{
+  NS_LOG_FUNCTION (this << candidates.size ());
+
+  if (candidates.size () == 1)
+  {
+    return candidates.front ();
+  }
+
+  std::size_t best = 0;
+  for (std::size_t n = 1; n < candidates.size (); n++)
+  {
+    if (GetEstimate (candidates[n]) < GetEstimate (candidates[best]))
+    {
+      best = n;
+    }
+  }
+
+  std::size_t chosen = best;
+  if (m_rng->GetValue () < m_probeProbability)
+  {
+    // Probe one of the other servers, picked uniformly
+    chosen = m_rng->GetInteger (0, candidates.size () - 2);
+    if (chosen >= best)
+    {
+      chosen++;
+    }
+    NS_LOG_LOGIC ("Probing " << candidates[chosen]);
+  }
+
+  for (std::size_t n = 0; n < candidates.size (); n++)
+  {
+    if (candidates[n] != candidates[chosen])
+    {
+      GetEstimate (candidates[n]) *= m_decay;
+    }
+  }
+  return candidates[chosen];
+}
+
+void
+UpstreamSelector::Clear (void)
+{
+  m_srtt.clear ();
+}
+
+double&
+UpstreamSelector::GetEstimate (Ipv4Address server)
+{
+  SrttMapI it = m_srtt.find (server);
+  if (it == m_srtt.end ())
+  {
+    // Unknown servers get a random estimate of 1 to 32 ms, as in BIND
+    it = m_srtt.insert (std::make_pair (server, m_rng->GetValue (1000, 32000))).first;
+  }
+  return it->second;
+}
+}
@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DNS_UPSTREAM_SELECTOR_H
+#define DNS_UPSTREAM_SELECTOR_H
+
+#include <map>
+#include <vector>
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3
+{
+/**
+ * /brief Chooses among the name servers of a zone by smoothed RTT.
+ *
+ * Follows the BIND approach:
+ *  - every measured RTT is folded into a per-server SRTT estimate,
+ *  - a server that times out has its estimate doubled,
+ *  - the server with the lowest SRTT is chosen, and the estimates of the
+ *    servers that were passed over decay, so a slow server is retried
+ *    after a while instead of being abandoned,
+ *  - servers never measured start with a small random estimate so that
+ *    each of them gets tried early.
+ * On top of the decay, a small fraction of the selections probe one of
+ * the slower servers directly to keep its estimate fresh. */
+class UpstreamSelector
+{
+public:
+  UpstreamSelector ();
+
+  /**
+   * /brief Set the weight of the previous estimate when folding in a new RTT */
+  void
+  SetSmoothing (double smoothing)
+  {
+    m_smoothing = smoothing;
+  }
+
+  /**
+   * /brief Set the factor applied to the estimates of the servers that were not chosen */
+  void
+  SetDecay (double decay)
+  {
+    m_decay = decay;
+  }
+
+  /**
+   * /brief Set the probability of choosing a slower server on purpose */
+  void
+  SetProbeProbability (double probability)
+  {
+    m_probeProbability = probability;
+  }
+
+  void
+  SetRandomVariable (Ptr<UniformRandomVariable> rng)
+  {
+    m_rng = rng;
+  }
+
+  /**
+   * /brief Fold a measured round-trip time into the estimate of a server */
+  void ReportRtt (Ipv4Address server, Time rtt);
+
+  /**
+   * /brief Penalize a server that did not answer within the given timeout */
+  void ReportTimeout (Ipv4Address server, Time timeout);
+
+  /**
+   * /brief Get the current estimate of a server (zero if it was never seen) */
+  Time GetSrtt (Ipv4Address server) const;
+
+  /**
+   * /brief Choose the server to query among the candidates
+   * /param candidates the addresses of the name servers of a zone; must not be empty */
+  Ipv4Address Select (const std::vector<Ipv4Address>& candidates);
+
+  void Clear (void);
+
+private:
+  double& GetEstimate (Ipv4Address server);
+
+  typedef std::map<Ipv4Address, double> SrttMap;
+  typedef std::map<Ipv4Address, double>::iterator SrttMapI;
+  typedef std::map<Ipv4Address, double>::const_iterator SrttMapCI;
+
+  SrttMap m_srtt;                   //!< estimates in microseconds, by server
+  double m_smoothing;               //!< weight of the previous estimate
+  double m_decay;                   //!< factor applied to the servers passed over
+  double m_probeProbability;        //!< chance of probing a slower server
+  Ptr<UniformRandomVariable> m_rng;  //!< randomness for the initial estimates and the probes
+};
+
+}  // end of namespace ns3
+
+#endif /* DNS_UPSTREAM_SELECTOR_H */
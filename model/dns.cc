@@ -1,5 +1,6 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
+#include <algorithm>
 #include <iomanip>
 
 #include "dns.h"
@@ -26,11 +27,24 @@ SRVRecordEntry::SRVRecordEntry (std::string rName,
                                 uint32_t rTTL,
                                 uint16_t rClass,
                                 uint16_t rType,
-                                std::string rData) : m_recordName (rName),
-                                                     m_recordTimeToLive (rTTL),
-                                                     m_recordClass (rClass),
-                                                     m_recordType (rType),
-                                                     m_rData (rData)
+                                const std::string& rData) : m_recordName (std::move (rName)),
+                                                            m_recordTimeToLive (rTTL),
+                                                            m_recordClass (rClass),
+                                                            m_recordType (rType)
+{
+  NS_ABORT_MSG_UNLESS (RDataFromString (rType, rData, m_rData),
+                       "Invalid RDATA " << rData << " for a record of type " << rType << " of " << m_recordName);
+}
+
+SRVRecordEntry::SRVRecordEntry (std::string rName,
+                                uint32_t rTTL,
+                                uint16_t rClass,
+                                uint16_t rType,
+                                std::vector<uint8_t> rData) : m_recordName (std::move (rName)),
+                                                              m_recordTimeToLive (rTTL),
+                                                              m_recordClass (rClass),
+                                                              m_recordType (rType),
+                                                              m_rData (std::move (rData))
 {
   /*     cstrctr     */
 }
@@ -49,7 +63,15 @@ SRVRecordEntry::~SRVRecordEntry ()
 //
 
 SRVTable::SRVTable ()
+  : m_generation (0),
+    m_evictions (0),
+    m_memoryUsage (0),
+    m_peakMemoryUsage (0),
+    m_outstandingCopies (0)
 {
+#ifdef DNS_EVENT_TRACE
+  m_eventTrace = 0;
+#endif
   m_rng = CreateObject<UniformRandomVariable> ();
   m_rng->SetStream (1);
   // Cstrctr
@@ -61,9 +83,18 @@ SRVTable::~SRVTable ()
 }
 
 void
-SRVTable::AddRecord (std::string name, uint16_t nsClass, uint16_t type, uint32_t TTL, std::string rData)
+SRVTable::AddRecord (const std::string& name, uint16_t nsClass, uint16_t type, uint32_t TTL, const std::string& rData)
 {
-  NS_LOG_FUNCTION (this << name << nsClass << type << TTL << rData);
+  std::vector<uint8_t> encoded;
+  NS_ABORT_MSG_UNLESS (RDataFromString (type, rData, encoded),
+                       "Invalid RDATA " << rData << " for a record of type " << type << " of " << name);
+  AddRecord (name, nsClass, type, TTL, encoded);
+}
+
+void
+SRVTable::AddRecord (const std::string& name, uint16_t nsClass, uint16_t type, uint32_t TTL, const std::vector<uint8_t>& rData)
+{
+  NS_LOG_FUNCTION (this << name << nsClass << type << TTL);
 
   SRVRecordEntry* newEntry = new SRVRecordEntry (name,
                                                  TTL,
@@ -75,16 +106,18 @@ SRVTable::AddRecord (std::string name, uint16_t nsClass, uint16_t type, uint32_t
   EventId removeEvent;
 
   delay = Seconds (TTL) + Seconds (m_rng->GetValue (0.0, 5.0));
-  removeEvent = Simulator::Schedule (delay, &SRVTable::DeleteRecord, this, newEntry);
+  removeEvent = Simulator::Schedule (delay, &SRVTable::ExpireRecord, this, newEntry);
 
   m_recordsTable.push_front (std::make_pair (newEntry, removeEvent));
+  AddMemory (GetRecordMemory (newEntry));
+  m_generation++;
 }
 
 // Add a zone name to the DNS server without starting the expiration timer.
 // This method is added to add initial zones to the server.
 // At the time DNS server starts, these records will be scheduled to expire after a time of TTL
 void
-SRVTable::AddZone (std::string name, uint16_t nsClass, uint16_t type, uint32_t TTL, std::string rData)
+SRVTable::AddZone (const std::string& name, uint16_t nsClass, uint16_t type, uint32_t TTL, const std::string& rData)
 {
   NS_LOG_FUNCTION (this << name << nsClass << type << TTL << rData);
 
@@ -101,13 +134,37 @@ SRVTable::AddZone (std::string name, uint16_t nsClass, uint16_t type, uint32_t T
   // removeEvent = Simulator::Schedule (delay, &SRVTable::DeleteRecord, this, newEntry);
 
   m_recordsTable.push_front (std::make_pair (newEntry, EventId ()));
+  AddMemory (GetRecordMemory (newEntry));
+  m_generation++;
+}
+
+void
+SRVTable::AddMemory (uint32_t bytes)
+{
+  m_memoryUsage += bytes;
+  m_peakMemoryUsage = std::max (m_peakMemoryUsage, m_memoryUsage);
 }
 
 bool
 SRVTable::DeleteRecord (SRVRecordEntry* record)
 {
   NS_LOG_FUNCTION (this << record);
+  return RemoveRecord (record, false);
+}
+
+// Scheduled when a record is added, or when the TTL of the zone data is
+// synchronized
+void
+SRVTable::ExpireRecord (SRVRecordEntry* record)
+{
+  NS_LOG_FUNCTION (this << record);
+  RemoveRecord (record, true);
+}
 
+// Only records whose TTL expired count as evictions
+bool
+SRVTable::RemoveRecord (SRVRecordEntry* record, bool expired)
+{
   bool retValue = false;
 
   for (SRVRecordI it = m_recordsTable.begin (); it != m_recordsTable.end (); it++)
@@ -115,9 +172,31 @@ SRVTable::DeleteRecord (SRVRecordEntry* record)
     if (it->first->GetRecordName () == record->GetRecordName () &&
         it->first->GetClass () == record->GetClass () &&
         it->first->GetType () == record->GetType () &&
-        it->first->GetRData () == record->GetRData ())  // || (it->first->GetCData () == record->GetCData ())))
+        it->first->GetRDataWire () == record->GetRDataWire ())  // || (it->first->GetCData () == record->GetCData ())))
     {
+      DNS_TRACE_EVENT (m_eventTrace,
+                       DnsTraceEvent::EXPIRE,
+                       DnsEventTrace::Hash (record->GetRecordName ()),
+                       record->GetType (),
+                       0,
+                       0,
+                       0,
+                       0);
+      if (expired)
+      {
+        m_evictions++;
+        if (!m_evictionCallback.IsNull ())
+        {
+          m_evictionCallback (*it->first);
+        }
+      }
+      // The record may be deleted before its TTL expires, so its removal
+      // event must not fire on the freed entry.
+      it->second.Cancel ();
+      m_memoryUsage -= GetRecordMemory (it->first);
+      delete it->first;
       m_recordsTable.erase (it);
+      m_generation++;
       retValue = false;
       break;
     }
@@ -133,10 +212,11 @@ SRVTable::UpdateRecordForTTL (SRVRecordEntry* record, uint32_t newTTL)
   for (SRVRecordI it = m_recordsTable.begin (); it != m_recordsTable.end (); it++)
   {
     if (it->first->GetRecordName () == record->GetRecordName () &&
-        it->first->GetRData () == record->GetRData ())  // || (it->first->GetCData () == record->GetCData ())))
+        it->first->GetRDataWire () == record->GetRDataWire ())  // || (it->first->GetCData () == record->GetCData ())))
     {
       // Only TTL and data part can be updated
       it->first->SetTTL (newTTL);
+      m_generation++;
       retValue = true;
       break;
     }
@@ -155,14 +235,14 @@ SRVTable::SynchronizeTTL (void)
   {
     it->second.Cancel ();
     delay = Seconds (it->first->GetTTL ()) + Seconds (m_rng->GetValue (0.0, 5.0));
-    removeEvent = Simulator::Schedule (delay, &SRVTable::DeleteRecord, this, it->first);
+    removeEvent = Simulator::Schedule (delay, &SRVTable::ExpireRecord, this, it->first);
 
     it->second = removeEvent;
   }
 }
 
 bool
-SRVTable::UpdateRdata (SRVRecordEntry* record, std::string rData)
+SRVTable::UpdateRdata (SRVRecordEntry* record, const std::string& rData)
 {
   NS_LOG_FUNCTION (this << record << rData);
   bool retValue = false;
@@ -172,7 +252,15 @@ SRVTable::UpdateRdata (SRVRecordEntry* record, std::string rData)
         it->first->GetClass () == record->GetClass () &&
         it->first->GetType () == record->GetType ())
     {
-      it->first->SetRData (rData);
+      uint32_t memory = GetRecordMemory (it->first);
+      if (!it->first->SetRData (rData))
+      {
+        NS_LOG_WARN ("Invalid RDATA " << rData << " for " << record->GetRecordName () << ". Not updated.");
+        break;
+      }
+      m_memoryUsage -= memory;
+      AddMemory (GetRecordMemory (it->first));
+      m_generation++;
       retValue = true;
       break;
     }
@@ -183,7 +271,7 @@ SRVTable::UpdateRdata (SRVRecordEntry* record, std::string rData)
 // Find a record that exactly matches a given query name.
 // This is always the first record matches the given name
 SRVTable::SRVRecordI
-SRVTable::FindARecord (std::string name, bool& found)
+SRVTable::FindARecord (const std::string& name, bool& found)
 {
   NS_LOG_FUNCTION (this << name);
   SRVRecordI foundRecord;
@@ -199,12 +287,13 @@ SRVTable::FindARecord (std::string name, bool& found)
     }
   }
   found = retValue;
+  DNS_TRACE_EVENT (m_eventTrace, DnsTraceEvent::LOOKUP, DnsEventTrace::Hash (name), 0, 0, 0, 0, retValue);
   return foundRecord;
 }
 
 // Find all records that exactly matches a given query name.
 bool
-SRVTable::FindRecordsFor (std::string name, SRVTable::SRVRecordInstance& instance)
+SRVTable::FindRecordsFor (const std::string& name, SRVTable::SRVRecordInstance& instance)
 {
   NS_LOG_FUNCTION (this << name);
 
@@ -218,20 +307,37 @@ SRVTable::FindRecordsFor (std::string name, SRVTable::SRVRecordInstance& instanc
                                                      it->first->GetTTL (),
                                                      it->first->GetClass (),
                                                      it->first->GetType (),
-                                                     it->first->GetRData ());
+                                                     it->first->GetRDataWire ());
 
       instance.push_front (std::make_pair (newEntry, EventId ()));
+      m_outstandingCopies++;
       retValue = true;
     }
   }
+  DNS_TRACE_EVENT (m_eventTrace, DnsTraceEvent::LOOKUP, DnsEventTrace::Hash (name), 0, 0, 0, 0, retValue);
   return retValue;
 }
 
+bool
+SRVTable::HasRecord (const std::string& name, uint16_t type, const std::vector<uint8_t>& rData) const
+{
+  NS_LOG_FUNCTION (this << name << type);
+
+  for (SRVRecordCI it = m_recordsTable.begin (); it != m_recordsTable.end (); it++)
+  {
+    if (it->first->GetRecordName () == name && it->first->GetType () == type && it->first->GetRDataWire () == rData)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
 // return a DNS records witch matches either part or full string of of the dns records
 // for example, if the query is west.sd.keio.ac.jp,
 // This function returns .ac.jp
 SRVTable::SRVRecordI
-SRVTable::FindARecordMatches (std::string name, bool& found)
+SRVTable::FindARecordMatches (const std::string& name, bool& found)
 {
   NS_LOG_FUNCTION (this << name);
   SRVRecordI foundRecord;
@@ -254,6 +360,7 @@ SRVTable::FindARecordMatches (std::string name, bool& found)
     }
   }
   found = retValue;
+  DNS_TRACE_EVENT (m_eventTrace, DnsTraceEvent::LOOKUP, DnsEventTrace::Hash (name), 0, 0, 0, 0, retValue);
   return foundRecord;
 }
 
@@ -261,7 +368,7 @@ SRVTable::FindARecordMatches (std::string name, bool& found)
 // for example, if the query is west.sd.keio.ac.jp,
 // This function returns server1.west.sd.keio.ac.jp
 bool
-SRVTable::FindAllRecordsHas (std::string name, SRVTable::SRVRecordInstance& instance)
+SRVTable::FindAllRecordsHas (const std::string& name, SRVTable::SRVRecordInstance& instance)
 {
   NS_LOG_FUNCTION (this << name);
 
@@ -283,17 +390,34 @@ SRVTable::FindAllRecordsHas (std::string name, SRVTable::SRVRecordInstance& inst
                                                      it->first->GetTTL (),
                                                      it->first->GetClass (),
                                                      it->first->GetType (),
-                                                     it->first->GetRData ());
+                                                     it->first->GetRDataWire ());
 
       instance.push_front (std::make_pair (newEntry, EventId ()));
+      m_outstandingCopies++;
       retValue = true;
     }
   }
+  DNS_TRACE_EVENT (m_eventTrace, DnsTraceEvent::LOOKUP, DnsEventTrace::Hash (name), 0, 0, 0, 0, retValue);
   return retValue;
 }
 
+// Free the record copies handed out by FindRecordsFor and FindAllRecordsHas
+// and empty the instance so that it can be reused for another lookup.
+void
+SRVTable::ReleaseInstance (SRVTable::SRVRecordInstance& instance)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (SRVRecordI it = instance.begin (); it != instance.end (); it++)
+  {
+    delete it->first;
+  }
+  m_outstandingCopies -= std::min<uint64_t> (m_outstandingCopies, instance.size ());
+  instance.clear ();
+}
+
 SRVTable::SRVRecordI
-SRVTable::FindARecordHas (std::string name, bool& found)
+SRVTable::FindARecordHas (const std::string& name, bool& found)
 {
   NS_LOG_FUNCTION (this << name);
   SRVRecordI foundRecord;
@@ -317,6 +441,7 @@ SRVTable::FindARecordHas (std::string name, bool& found)
     }
   }
   found = retValue;
+  DNS_TRACE_EVENT (m_eventTrace, DnsTraceEvent::LOOKUP, DnsEventTrace::Hash (name), 0, 0, 0, 0, retValue);
   return foundRecord;
 }
 
@@ -325,18 +450,12 @@ void
 SRVTable::SwitchServersRoundRobin (void)
 {
   NS_LOG_FUNCTION (this);
-  if (!m_recordsTable.empty () || m_recordsTable.size () != 1)
+  // Rotation only changes the order of the records, so it does not bump the
+  // generation: responses cached by the authoritative roles stay valid.
+  if (m_recordsTable.size () > 1)
   {
-    SRVRecordI it = m_recordsTable.begin ();
-
-    SRVRecordEntry* newEntry = new SRVRecordEntry (it->first->GetRecordName (),
-                                                   it->first->GetTTL (),
-                                                   it->first->GetClass (),
-                                                   it->first->GetType (),
-                                                   it->first->GetRData ());
-
-    m_recordsTable.push_back (std::make_pair (newEntry, it->second));
-    m_recordsTable.erase (it);
+    // Move the head node to the tail without copying the record
+    m_recordsTable.splice (m_recordsTable.end (), m_recordsTable, m_recordsTable.begin ());
   }
 }
 }
@@ -5,7 +5,10 @@
 #include <sys/types.h>
 #include <cassert>
 #include <list>
+#include <string>
+#include <utility>
 
+#include "ns3/callback.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4.h"
 #include "ns3/net-device.h"
@@ -14,6 +17,10 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/timer.h"
 
+#include "ns3/dns-event-trace.h"
+#include "ns3/dns-memory.h"
+#include "ns3/dns-rdata.h"
+
 namespace ns3
 {
 class SRVRecordEntry
@@ -26,12 +33,20 @@ public:
    * /param rTTL the TTL value of the record
    * /param rClass the class of the record
    * /param rType the type of the record
-   * /rData the IP address of the record //FIXME the support all type of records*/
+   * /rData the record data in presentation form, encoded according to rType */
   SRVRecordEntry (std::string rName = std::string (""),
                   uint32_t rTTL = 0,
                   uint16_t rClass = 0,
                   uint16_t rType = 0,
-                  std::string rData = std::string (""));
+                  const std::string& rData = std::string (""));
+
+  /*
+   * /brief constructor for record data that is already encoded (see RDataCodec) */
+  SRVRecordEntry (std::string rName,
+                  uint32_t rTTL,
+                  uint16_t rClass,
+                  uint16_t rType,
+                  std::vector<uint8_t> rData);
 
   ~SRVRecordEntry ();
 
@@ -40,9 +55,9 @@ public:
   void
   SetRecordName (std::string rName)
   {
-    m_recordName = rName;
+    m_recordName = std::move (rName);
   }
-  std::string
+  const std::string&
   GetRecordName (void) const
   {
     return m_recordName;
@@ -88,25 +103,59 @@ public:
   }
 
   /*
-   * /brief Get and set the record data (This has to be fixed)*/
-  void
-  SetRData (std::string rData)
+   * /brief Get and set the record data in presentation form.
+   * SetRData returns false, and leaves the data as it was, if the text is
+   * not valid for the type of the record.*/
+  bool
+  SetRData (const std::string& rData)
   {
-    m_rData = rData;
+    return RDataFromString (m_recordType, rData, m_rData);
   }
   std::string
   GetRData (void) const
+  {
+    return RDataToString (m_recordType, m_rData);
+  }
+
+  /*
+   * /brief Get the record data as a typed value, e.g., GetRData<RR_TYPE_A> ()*/
+  template <uint16_t Type>
+  typename RDataCodec<Type>::Value
+  GetRData (void) const
+  {
+    typename RDataCodec<Type>::Value value;
+    DecodeRData<Type> (m_rData, value);
+    return value;
+  }
+
+  /*
+   * /brief Get and set the encoded record data*/
+  void
+  SetRDataWire (std::vector<uint8_t> rData)
+  {
+    m_rData = std::move (rData);
+  }
+  const std::vector<uint8_t>&
+  GetRDataWire (void) const
   {
     return m_rData;
   }
 
+  /*
+   * /brief Get the bytes the record takes, including its name and data*/
+  uint32_t
+  GetMemoryUsage (void) const
+  {
+    return sizeof (*this) + DnsMemoryUsage (m_recordName) + DnsMemoryUsage (m_rData);
+  }
+
 private:
   std::string m_recordName;     //!< the name of the record
   uint32_t m_recordTimeToLive;  //!< TTL value of the record
   uint16_t m_recordClass;       //!< class of the record
   uint16_t m_recordType;        //!< type of the record
-  std::string m_rData;          //!< either IN record or a NS record or a CNAME
-};                              // end of SRVRECORD class
+  std::vector<uint8_t> m_rData;  //!< the encoded record data (see RDataCodec)
+};                               // end of SRVRECORD class
 
 std::ostream& operator<< (std::ostream& os, SRVRecordEntry const& srv);
 
@@ -128,30 +177,115 @@ public:
   /// Constant Iterator for an RR
   typedef std::list<std::pair<SRVRecordEntry*, EventId> >::const_iterator SRVRecordCI;
 
-  void AddRecord (std::string name, uint16_t nsClass, uint16_t type, uint32_t TTL, std::string rData);
-  void AddZone (std::string name, uint16_t nsClass, uint16_t type, uint32_t TTL, std::string rData);
+  void AddRecord (const std::string& name, uint16_t nsClass, uint16_t type, uint32_t TTL, const std::string& rData);
+  void AddRecord (const std::string& name, uint16_t nsClass, uint16_t type, uint32_t TTL, const std::vector<uint8_t>& rData);
+  void AddZone (const std::string& name, uint16_t nsClass, uint16_t type, uint32_t TTL, const std::string& rData);
 
   bool DeleteRecord (SRVRecordEntry* record);
   bool UpdateRecordForTTL (SRVRecordEntry* record, uint32_t newTTL);
-  bool UpdateRdata (SRVRecordEntry* record, std::string rData);
+  /// Returns false if no record matches, or if the text is not valid for the type of the record
+  bool UpdateRdata (SRVRecordEntry* record, const std::string& rData);
+
+  SRVTable::SRVRecordI FindARecord (const std::string& name, bool& found);
+  bool FindRecordsFor (const std::string& name, SRVTable::SRVRecordInstance& instance);
+  /// Whether a record of the name and type holds the encoded data; nothing is copied
+  bool HasRecord (const std::string& name, uint16_t type, const std::vector<uint8_t>& rData) const;
 
-  SRVTable::SRVRecordI FindARecord (std::string name, bool& found);
-  bool FindRecordsFor (std::string name, SRVTable::SRVRecordInstance& instance);
+  SRVTable::SRVRecordI FindARecordMatches (const std::string& name, bool& found);  // Need RR
 
-  SRVTable::SRVRecordI FindARecordMatches (std::string name, bool& found);  // Need RR
+  SRVTable::SRVRecordI FindARecordHas (const std::string& name, bool& found);  // Need RR
+  bool FindAllRecordsHas (const std::string& name, SRVTable::SRVRecordInstance& instance);
 
-  SRVTable::SRVRecordI FindARecordHas (std::string name, bool& found);  // Need RR
-  bool FindAllRecordsHas (std::string name, SRVTable::SRVRecordInstance& instance);
+  void ReleaseInstance (SRVTable::SRVRecordInstance& instance);
 
   void SwitchServersRoundRobin (void);
 
   void SynchronizeTTL (void);
 
+  /**
+   * /brief Get the number of records in the table */
+  uint32_t
+  GetSize (void) const
+  {
+    return m_recordsTable.size ();
+  }
+
+  /**
+   * /brief Get the bytes the records of the table take, with their list nodes */
+  uint64_t
+  GetMemoryUsage (void) const
+  {
+    return m_memoryUsage;
+  }
+
+  /**
+   * /brief Get the largest GetMemoryUsage since the table was created */
+  uint64_t
+  GetPeakMemoryUsage (void) const
+  {
+    return m_peakMemoryUsage;
+  }
+
+  /**
+   * /brief Get the number of record copies handed out by FindRecordsFor and
+   * FindAllRecordsHas that were not given back to ReleaseInstance */
+  uint64_t
+  GetOutstandingCopies (void) const
+  {
+    return m_outstandingCopies;
+  }
+
+  /**
+   * /brief Get the number of records removed because their TTL expired */
+  uint64_t
+  GetEvictions (void) const
+  {
+    return m_evictions;
+  }
+
+  /**
+   * /brief Set a callback invoked with every record whose TTL expired,
+   * just before it is removed */
+  void
+  SetEvictionCallback (Callback<void, const SRVRecordEntry&> callback)
+  {
+    m_evictionCallback = callback;
+  }
+
+  /**
+   * /brief Get the generation of the table contents.
+   * The generation changes whenever a record is added, removed or updated,
+   * so data derived from the table can be checked for staleness. Reordering
+   * by SwitchServersRoundRobin leaves the contents, and the generation,
+   * unchanged. */
+  uint64_t
+  GetGeneration (void) const
+  {
+    return m_generation;
+  }
+
   void
   DoDispose ()
   {
+    for (SRVRecordI it = m_recordsTable.begin (); it != m_recordsTable.end (); it++)
+    {
+      it->second.Cancel ();
+      delete it->first;
+    }
     m_recordsTable.clear ();
+    m_memoryUsage = 0;
+    m_generation++;
   }
+#ifdef DNS_EVENT_TRACE
+  /**
+   * /brief Record the lookups and expiries of the table in a trace (0: none) */
+  void
+  SetEventTrace (DnsEventTrace* trace)
+  {
+    m_eventTrace = trace;
+  }
+#endif
+
   void
   AssignIpv4 (Ptr<Ipv4> ipv4)
   {
@@ -167,11 +301,30 @@ public:
   }
 
 private:
+  /// Bytes a record of the table takes, with its list node
+  static uint32_t
+  GetRecordMemory (const SRVRecordEntry* record)
+  {
+    return DNS_LIST_NODE_OVERHEAD + sizeof (SRVRecordPair) + record->GetMemoryUsage ();
+  }
+  void AddMemory (uint32_t bytes);
+  void ExpireRecord (SRVRecordEntry* record);
+  bool RemoveRecord (SRVRecordEntry* record, bool expired);
+
   SRVRecordInstance m_recordsTable;  //!< RR tabl; //!< RR tablee
   Ptr<UniformRandomVariable> m_rng;  //!< Rng stream.
   Ptr<Ipv4> m_ipv4;                  //!< Ipv4 pointer
   Ptr<Node> m_node;                  //!< node the routing protocol is running on
   uint32_t m_nodeId;                 //!< node id
+  uint64_t m_generation;             //!< bumped on every change to the records
+  uint64_t m_evictions;              //!< records removed on TTL expiry
+  Callback<void, const SRVRecordEntry&> m_evictionCallback;  //!< told about every expired record
+#ifdef DNS_EVENT_TRACE
+  DnsEventTrace* m_eventTrace;       //!< records lookups and expiries (0: none)
+#endif
+  uint64_t m_memoryUsage;            //!< bytes the records take
+  uint64_t m_peakMemoryUsage;        //!< largest m_memoryUsage so far
+  uint64_t m_outstandingCopies;      //!< record copies not released yet
 };
 
 }  // end of namespace ns3
@@ -1,49 +1,1034 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
-// Include a header file from your module to test.
-#include "ns3/dns.h"
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
 
-// An essential include is test.h
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/simple-net-device-helper.h"
 #include "ns3/test.h"
 
+#include "ns3/dns-module.h"
+
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
 
-// This is an example TestCase.
-class DnsTestCase1 : public TestCase
+// Recorded budgets of the performance tests. Lower them when an
+// optimization lands; raising one needs a reason in the commit message.
+static const double MAX_EVENTS_PER_CACHED_RECORD = 1.0;  // expiry of a cached record
+static const double MAX_UPSTREAM_PER_MISS = 1.0;         // miss below a cached zone cut
+static const double MAX_UPSTREAM_PER_HIT = 0.0;          // cache hit
+static const double MAX_EVENTS_PER_MISS = 40.0;          // scheduler events per answered miss
+static const double MAX_EVENTS_PER_HIT = 20.0;           // scheduler events per answered hit
+static const double MAX_PACKETS_PER_MISS = 8.0;          // packets created per answered miss
+static const double MAX_PACKETS_PER_HIT = 4.0;           // packets created per answered hit
+
+static uint64_t
+GetCounter (Ptr<Object> object, const std::string& name)
+{
+  UintegerValue value;
+  object->GetAttribute (name, value);
+  return value.Get ();
+}
+
+// Packets created so far in the simulation, read from the UID of a new one
+static uint64_t
+GetPacketCount (void)
+{
+  return Create<Packet> ()->GetUid ();
+}
+
+/**
+ * Nodes with the Internet stack on one shared channel, all in one subnet,
+ * so that no routing is needed. */
+class DnsTestNetwork
+{
+public:
+  DnsTestNetwork (uint32_t nodes);
+
+  Ptr<Node>
+  GetNode (uint32_t n) const
+  {
+    return m_nodes.Get (n);
+  }
+  Ipv4Address
+  GetAddress (uint32_t n) const
+  {
+    return m_interfaces.GetAddress (n);
+  }
+
+private:
+  NodeContainer m_nodes;
+  Ipv4InterfaceContainer m_interfaces;
+};
+
+DnsTestNetwork::DnsTestNetwork (uint32_t nodes)
+{
+  m_nodes.Create (nodes);
+  InternetStackHelper stack;
+  stack.Install (m_nodes);
+  SimpleNetDeviceHelper devices;
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  m_interfaces = address.Assign (devices.Install (m_nodes));
+}
+
+/**
+ * Sends raw queries from a UDP socket and keeps the replies by transaction ID */
+class DnsTestProbe
+{
+public:
+  DnsTestProbe (Ptr<Node> node);
+
+  void Ask (Time at,
+            Ipv4Address server,
+            uint16_t id,
+            const std::string& qName,
+            uint16_t qType,
+            bool recursionDesired = false);
+  bool GetReply (uint16_t id, DNSHeader& reply) const;
+
+private:
+  void Send (Ipv4Address server, Ptr<Packet> packet);
+  void HandleRead (Ptr<Socket> socket);
+
+  Ptr<Socket> m_socket;
+  std::map<uint16_t, DNSHeader> m_replies;
+};
+
+DnsTestProbe::DnsTestProbe (Ptr<Node> node)
+{
+  m_socket = Socket::CreateSocket (node, UdpSocketFactory::GetTypeId ());
+  m_socket->Bind ();
+  m_socket->SetRecvCallback (MakeCallback (&DnsTestProbe::HandleRead, this));
+}
+
+void
+DnsTestProbe::Ask (Time at,
+                   Ipv4Address server,
+                   uint16_t id,
+                   const std::string& qName,
+                   uint16_t qType,
+                   bool recursionDesired)
+{
+  QuestionSectionHeader question;
+  question.SetqName (qName);
+  question.SetqType (qType);
+  question.SetqClass (RR_CLASS_IN);
+
+  DNSHeader header;
+  header.SetId (id);
+  header.SetQRbit (1);
+  header.SetRDbit (recursionDesired);
+  header.AddQuestion (question);
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  Simulator::Schedule (at, &DnsTestProbe::Send, this, server, packet);
+}
+
+bool
+DnsTestProbe::GetReply (uint16_t id, DNSHeader& reply) const
+{
+  std::map<uint16_t, DNSHeader>::const_iterator it = m_replies.find (id);
+  if (it == m_replies.end ())
+  {
+    return false;
+  }
+  reply = it->second;
+  return true;
+}
+
+void
+DnsTestProbe::Send (Ipv4Address server, Ptr<Packet> packet)
+{
+  m_socket->SendTo (packet, 0, InetSocketAddress (server, DNS_PORT));
+}
+
+void
+DnsTestProbe::HandleRead (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+  {
+    DNSHeader reply;
+    packet->RemoveHeader (reply);
+    m_replies[reply.GetId ()] = reply;
+  }
+}
+
+/**
+ * A DnsClient resolving through a Local server, with Root, TLD and
+ * Authoritative servers below it. The Authoritative server holds
+ * www.example.jp, mail.example.jp and host<n>.example.jp. */
+class DnsTestHierarchy
+{
+public:
+  DnsTestHierarchy (uint32_t hosts);
+
+  /**
+   * /brief Let the client ask for a name at the given simulation time */
+  void Ask (Time at, const std::string& qName);
+
+  Ptr<BindServer>
+  GetLocal (void) const
+  {
+    return m_local;
+  }
+  const std::vector<DnsQueryOutcome>&
+  GetOutcomes (void) const
+  {
+    return m_outcomes;
+  }
+
+private:
+  void HandleOutcome (const DnsQueryOutcome& outcome);
+
+  enum
+  {
+    CLIENT = 0,
+    LOCAL,
+    ROOT,
+    TLD,
+    AUTH,
+    NODES
+  };
+
+  DnsTestNetwork m_network;
+  Ptr<DnsClient> m_client;
+  Ptr<BindServer> m_local;
+  std::vector<DnsQueryOutcome> m_outcomes;
+};
+
+DnsTestHierarchy::DnsTestHierarchy (uint32_t hosts)
+  : m_network (NODES)
+{
+  std::ostringstream tld, auth;
+  tld << m_network.GetAddress (TLD);
+  auth << m_network.GetAddress (AUTH);
+
+  {
+    BindServerHelper bindServer (BindServer::LOCAL_SERVER);
+    bindServer.SetAttribute ("SetRecursiveSupport", EnumValue (BindServer::RA_AVAILABLE));
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (m_network.GetAddress (LOCAL)));
+    bindServer.SetAttribute ("RootServerAddress", Ipv4AddressValue (m_network.GetAddress (ROOT)));
+    ApplicationContainer apps = bindServer.Install (m_network.GetNode (LOCAL));
+    m_local = apps.Get (0)->GetObject<BindServer> ();
+  }
+  {
+    BindServerHelper bindServer (BindServer::ROOT_SERVER);
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (m_network.GetAddress (ROOT)));
+    ApplicationContainer apps = bindServer.Install (m_network.GetNode (ROOT));
+    bindServer.AddNSRecord (apps.Get (0), ".jp", 86400, RR_CLASS_IN, RR_TYPE_A, tld.str ());
+  }
+  {
+    BindServerHelper bindServer (BindServer::TLD_SERVER);
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (m_network.GetAddress (TLD)));
+    ApplicationContainer apps = bindServer.Install (m_network.GetNode (TLD));
+    bindServer.AddNSRecord (apps.Get (0), ".example.jp", 86400, RR_CLASS_IN, RR_TYPE_A, auth.str ());
+  }
+  {
+    BindServerHelper bindServer (BindServer::AUTH_SERVER);
+    bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (m_network.GetAddress (AUTH)));
+    ApplicationContainer apps = bindServer.Install (m_network.GetNode (AUTH));
+    bindServer.AddNSRecord (apps.Get (0), "www.example.jp", 3600, RR_CLASS_IN, RR_TYPE_A, "192.0.2.1");
+    bindServer.AddNSRecord (apps.Get (0), "mail.example.jp", 3600, RR_CLASS_IN, RR_TYPE_A, "192.0.2.2");
+    for (uint32_t n = 0; n < hosts; n++)
+    {
+      std::ostringstream name;
+      name << "host" << n << ".example.jp";
+      bindServer.AddNSRecord (apps.Get (0), name.str (), 3600, RR_CLASS_IN, RR_TYPE_A, "198.51.100.1");
+    }
+  }
+  {
+    DnsClientHelper dnsClient;
+    dnsClient.SetAttribute ("ArrivalProcess", EnumValue (DnsClient::ARRIVAL_TRACE));
+    dnsClient.AddResolver (m_network.GetAddress (LOCAL));
+    ApplicationContainer apps = dnsClient.Install (m_network.GetNode (CLIENT));
+    m_client = apps.Get (0)->GetObject<DnsClient> ();
+    m_client->TraceConnectWithoutContext ("Outcome", MakeCallback (&DnsTestHierarchy::HandleOutcome, this));
+  }
+}
+
+void
+DnsTestHierarchy::Ask (Time at, const std::string& qName)
+{
+  // Every application starts at time zero
+  m_client->AddScheduledQuery (at, qName);
+}
+
+void
+DnsTestHierarchy::HandleOutcome (const DnsQueryOutcome& outcome)
+{
+  m_outcomes.push_back (outcome);
+}
+
+// A message with every section survives the trip through a packet
+class DnsHeaderRoundTripTestCase : public TestCase
 {
 public:
-  DnsTestCase1 ();
-  virtual ~DnsTestCase1 ();
+  DnsHeaderRoundTripTestCase ();
+  virtual ~DnsHeaderRoundTripTestCase ();
 
 private:
   virtual void DoRun (void);
 };
 
-// Add some help text to this case to describe what it is intended to test
-DnsTestCase1::DnsTestCase1 ()
-  : TestCase ("Dns test case (does nothing)")
+DnsHeaderRoundTripTestCase::DnsHeaderRoundTripTestCase ()
+  : TestCase ("DNSHeader serializes and deserializes every section and flag")
 {
 }
 
-// This destructor does nothing but we include it as a reminder that
-// the test case should clean up after itself
-DnsTestCase1::~DnsTestCase1 ()
+DnsHeaderRoundTripTestCase::~DnsHeaderRoundTripTestCase ()
+{
+}
+
+void
+DnsHeaderRoundTripTestCase::DoRun (void)
+{
+  QuestionSectionHeader question;
+  question.SetqName ("www.example.jp");
+  question.SetqType (RR_TYPE_A);
+  question.SetqClass (RR_CLASS_IN);
+
+  DNSHeader header;
+  header.SetId (4711);
+  header.SetQRbit (0);
+  header.SetAAbit (1);
+  header.SetRDbit (1);
+  header.SetRAbit (1);
+  header.SetRcode (3);
+  header.AddQuestion (question);
+
+  // One record of every supported type, in presentation form
+  static const struct
+  {
+    uint16_t type;
+    const char* rData;
+  } records[] = {
+    {RR_TYPE_A, "192.0.2.1"},
+    {RR_TYPE_CNAME, "alias.example.jp"},
+    {RR_TYPE_MX, "10 mx.example.jp"},
+    {RR_TYPE_TXT, "v=spf1 -all"},
+    {RR_TYPE_AAAA, "2001:db8::1"},
+  };
+  const uint32_t recordCount = sizeof (records) / sizeof (records[0]);
+  // AddAnswer prepends, so add in reverse to keep the order
+  for (uint32_t n = recordCount; n > 0; n--)
+  {
+    ResourceRecordHeader answer;
+    answer.SetName ("www.example.jp");
+    answer.SetClass (RR_CLASS_IN);
+    answer.SetType (records[n - 1].type);
+    answer.SetTimeToLive (300 + n);
+    NS_TEST_ASSERT_MSG_EQ (answer.SetRData (records[n - 1].rData), true, "Invalid RDATA " << records[n - 1].rData);
+    header.AddAnswer (answer);
+  }
+
+  ResourceRecordHeader nsRecord;
+  nsRecord.SetName ("example.jp");
+  nsRecord.SetClass (RR_CLASS_IN);
+  nsRecord.SetTimeToLive (86400);
+  nsRecord.SetRData<RR_TYPE_NS> ("ns1.example.jp");
+  header.AddNsRecord (nsRecord);
+
+  ResourceRecordHeader glue;
+  glue.SetName ("ns1.example.jp");
+  glue.SetClass (RR_CLASS_IN);
+  glue.SetTimeToLive (86400);
+  glue.SetRData<RR_TYPE_A> (Ipv4Address ("203.0.113.53"));
+  header.AddARecord (glue);
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), header.GetSerializedSize (), "Packet size is not the serialized size");
+
+  DNSHeader decoded;
+  packet->RemoveHeader (decoded);
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 0, "The header did not consume the message");
+
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetId (), 4711, "Wrong transaction ID");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetQRbit (), false, "Wrong QR bit");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetAAbit (), true, "Wrong AA bit");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRDbit (), true, "Wrong RD bit");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetRAbit (), true, "Wrong RA bit");
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (decoded.GetRcode ()), 3, "Wrong RCODE");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetQdCount (), 1, "Wrong question count");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetAnCount (), recordCount, "Wrong answer count");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetNsCount (), 1, "Wrong authority count");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetArCount (), 1, "Wrong additional count");
+
+  const QuestionSectionHeader& decodedQuestion = decoded.GetQuestionList ().front ();
+  NS_TEST_ASSERT_MSG_EQ (decodedQuestion.GetqName (), "www.example.jp", "Wrong question name");
+  NS_TEST_ASSERT_MSG_EQ (decodedQuestion.GetqType (), RR_TYPE_A, "Wrong question type");
+  NS_TEST_ASSERT_MSG_EQ (decodedQuestion.GetqClass (), RR_CLASS_IN, "Wrong question class");
+
+  uint32_t n = 0;
+  const std::list<ResourceRecordHeader>& answers = decoded.GetAnswerList ();
+  for (std::list<ResourceRecordHeader>::const_iterator it = answers.begin (); it != answers.end (); it++, n++)
+  {
+    NS_TEST_ASSERT_MSG_EQ (it->GetName (), "www.example.jp", "Wrong name of answer " << n);
+    NS_TEST_ASSERT_MSG_EQ (it->GetType (), records[n].type, "Wrong type of answer " << n);
+    NS_TEST_ASSERT_MSG_EQ (it->GetClass (), RR_CLASS_IN, "Wrong class of answer " << n);
+    NS_TEST_ASSERT_MSG_EQ (it->GetTimeToLive (), 301 + n, "Wrong TTL of answer " << n);
+    std::vector<uint8_t> wire;
+    RDataFromString (records[n].type, records[n].rData, wire);
+    NS_TEST_ASSERT_MSG_EQ ((it->GetRDataWire () == wire), true, "Wrong RDATA of answer " << n);
+  }
+
+  const ResourceRecordHeader& decodedNs = decoded.GetNsRecordList ().front ();
+  NS_TEST_ASSERT_MSG_EQ (decodedNs.GetName (), "example.jp", "Wrong name of the NS record");
+  NS_TEST_ASSERT_MSG_EQ (decodedNs.GetRData<RR_TYPE_NS> (), "ns1.example.jp", "Wrong name server");
+
+  const ResourceRecordHeader& decodedGlue = decoded.GetArList ().front ();
+  NS_TEST_ASSERT_MSG_EQ (decodedGlue.GetName (), "ns1.example.jp", "Wrong name of the glue");
+  NS_TEST_ASSERT_MSG_EQ (decodedGlue.GetRData<RR_TYPE_A> (), Ipv4Address ("203.0.113.53"), "Wrong glue address");
+
+  // Text that is not valid for the type leaves the RDATA alone
+  ResourceRecordHeader mx;
+  mx.SetType (RR_TYPE_MX);
+  NS_TEST_ASSERT_MSG_EQ (mx.SetRData ("10 mx.example.jp"), true, "Valid RDATA rejected");
+  NS_TEST_ASSERT_MSG_EQ (mx.SetRData ("mx.example.jp"), false, "RDATA without a preference accepted");
+  NS_TEST_ASSERT_MSG_EQ (mx.GetRData (), "10 mx.example.jp", "Invalid RDATA changed the record");
+}
+
+// Lookups, updates, deletion and rotation of the records of a table
+class DnsSrvTableLookupTestCase : public TestCase
+{
+public:
+  DnsSrvTableLookupTestCase ();
+  virtual ~DnsSrvTableLookupTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DnsSrvTableLookupTestCase::DnsSrvTableLookupTestCase ()
+  : TestCase ("SRVTable finds, updates, deletes and rotates records")
+{
+}
+
+DnsSrvTableLookupTestCase::~DnsSrvTableLookupTestCase ()
+{
+}
+
+void
+DnsSrvTableLookupTestCase::DoRun (void)
+{
+  SRVTable table;
+  // Records are kept most recent first
+  table.AddZone ("www.example.jp", RR_CLASS_IN, RR_TYPE_A, 3600, "192.0.2.1");
+  table.AddZone ("www.example.jp", RR_CLASS_IN, RR_TYPE_A, 3600, "192.0.2.2");
+  table.AddZone (".example.jp", RR_CLASS_IN, RR_TYPE_A, 3600, "10.0.0.1");
+  table.AddZone ("mail.example.jp", RR_CLASS_IN, RR_TYPE_MX, 3600, "10 mx.example.jp");
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 4, "Wrong table size");
+  NS_TEST_ASSERT_MSG_GT (table.GetMemoryUsage (), 4 * sizeof (SRVRecordEntry), "Records not accounted");
+
+  bool found = false;
+  SRVTable::SRVRecordI record = table.FindARecord ("www.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, true, "Exact lookup failed");
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRData (), "192.0.2.2", "Exact lookup did not find the latest record");
+
+  table.FindARecord ("ftp.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, false, "Exact lookup found a missing name");
+
+  record = table.FindARecordMatches ("ftp.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, true, "Suffix lookup failed");
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRecordName (), ".example.jp", "Suffix lookup found the wrong record");
+
+  record = table.FindARecordHas (".example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, true, "Subtree lookup failed");
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRecordName (), "mail.example.jp", "Subtree lookup found the wrong record");
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRData<RR_TYPE_MX> ().exchange, "mx.example.jp", "Wrong MX record");
+
+  SRVTable::SRVRecordInstance instance;
+  NS_TEST_ASSERT_MSG_EQ (table.FindRecordsFor ("www.example.jp", instance), true, "Records of a name not found");
+  NS_TEST_ASSERT_MSG_EQ (instance.size (), 2, "Wrong number of records of a name");
+  NS_TEST_ASSERT_MSG_EQ (table.GetOutstandingCopies (), 2, "Record copies not counted");
+  table.ReleaseInstance (instance);
+  NS_TEST_ASSERT_MSG_EQ (instance.size (), 0, "Released instance is not empty");
+  NS_TEST_ASSERT_MSG_EQ (table.GetOutstandingCopies (), 0, "Released copies still counted");
+
+  NS_TEST_ASSERT_MSG_EQ (table.FindAllRecordsHas ("example.jp", instance), true, "Records of a subtree not found");
+  NS_TEST_ASSERT_MSG_EQ (instance.size (), 4, "Wrong number of records of a subtree");
+  table.ReleaseInstance (instance);
+
+  // Rotation moves the head to the tail, one record at a time
+  uint64_t generation = table.GetGeneration ();
+  table.SwitchServersRoundRobin ();
+  NS_TEST_ASSERT_MSG_EQ (table.GetGeneration (), generation, "Rotation changed the generation");
+  record = table.FindARecord ("www.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRData (), "192.0.2.2", "One rotation reordered the addresses");
+  table.SwitchServersRoundRobin ();
+  table.SwitchServersRoundRobin ();
+  record = table.FindARecord ("www.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRData (), "192.0.2.1", "Rotation did not reach the other address");
+
+  SRVRecordEntry first ("www.example.jp", 0, RR_CLASS_IN, RR_TYPE_A, "192.0.2.1");
+  NS_TEST_ASSERT_MSG_EQ (table.UpdateRecordForTTL (&first, 60), true, "TTL update failed");
+  record = table.FindARecord ("www.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetTTL (), 60, "TTL not updated");
+
+  NS_TEST_ASSERT_MSG_EQ (table.UpdateRdata (&first, "192.0.2.3"), true, "RDATA update failed");
+  record = table.FindARecord ("www.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (record->first->GetRData (), "192.0.2.3", "RDATA not updated");
+
+  SRVRecordEntry mail ("mail.example.jp", 0, RR_CLASS_IN, RR_TYPE_MX, "10 mx.example.jp");
+  uint64_t memory = table.GetMemoryUsage ();
+  table.DeleteRecord (&mail);
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 3, "Record not deleted");
+  NS_TEST_ASSERT_MSG_EQ (table.GetEvictions (), 0, "An explicit deletion counted as an eviction");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (table.GetMemoryUsage () + mail.GetMemoryUsage (),
+                               memory,
+                               "Memory of the deleted record not released");
+  table.FindARecord ("mail.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, false, "Deleted record still found");
+
+  table.DoDispose ();
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 0, "Disposed table is not empty");
+  NS_TEST_ASSERT_MSG_EQ (table.GetMemoryUsage (), 0, "Disposed table still accounts memory");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (memory, table.GetPeakMemoryUsage (), "Peak memory below a past usage");
+}
+
+// Records added at run time expire after their TTL, zone data once the
+// TTLs are synchronized
+class DnsSrvTableExpiryTestCase : public TestCase
+{
+public:
+  DnsSrvTableExpiryTestCase ();
+  virtual ~DnsSrvTableExpiryTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CountEviction (const SRVRecordEntry& record);
+
+  uint32_t m_evicted;
+};
+
+DnsSrvTableExpiryTestCase::DnsSrvTableExpiryTestCase ()
+  : TestCase ("SRVTable expires records after their TTL"),
+    m_evicted (0)
+{
+}
+
+DnsSrvTableExpiryTestCase::~DnsSrvTableExpiryTestCase ()
 {
 }
 
-//
-// This method is the pure virtual method from class TestCase that every
-// TestCase must implement
-//
 void
-DnsTestCase1::DoRun (void)
+DnsSrvTableExpiryTestCase::CountEviction (const SRVRecordEntry& /* record */)
+{
+  m_evicted++;
+}
+
+void
+DnsSrvTableExpiryTestCase::DoRun (void)
+{
+  SRVTable table;
+  table.SetEvictionCallback (MakeCallback (&DnsSrvTableExpiryTestCase::CountEviction, this));
+  table.AddZone ("www.example.jp", RR_CLASS_IN, RR_TYPE_A, 10, "192.0.2.1");
+  table.AddRecord ("cached.example.jp", RR_CLASS_IN, RR_TYPE_A, 1, "192.0.2.2");
+
+  // Expiry is TTL plus up to five seconds of jitter
+  Simulator::Stop (Seconds (7));
+  Simulator::Run ();
+  bool found = false;
+  table.FindARecord ("cached.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, false, "Cached record did not expire");
+  table.FindARecord ("www.example.jp", found);
+  NS_TEST_ASSERT_MSG_EQ (found, true, "Zone record expired before its TTL was synchronized");
+  NS_TEST_ASSERT_MSG_EQ (table.GetEvictions (), 1, "Wrong eviction count");
+  NS_TEST_ASSERT_MSG_EQ (m_evicted, 1, "Eviction callback not called");
+
+  table.SynchronizeTTL ();
+  Simulator::Stop (Seconds (16));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 0, "Zone record did not expire");
+  NS_TEST_ASSERT_MSG_EQ (m_evicted, 2, "Eviction callback not called for the zone record");
+
+  table.DoDispose ();
+  Simulator::Destroy ();
+}
+
+// Released entries leave deleted slots in the indexes of the pending
+// table, which are reclaimed by rebuilds without losing live keys
+class DnsPendingTableTestCase : public TestCase
+{
+public:
+  DnsPendingTableTestCase ();
+  virtual ~DnsPendingTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DnsPendingTableTestCase::DnsPendingTableTestCase ()
+  : TestCase ("PendingQueryTable finds live entries across deleted slots and rebuilds")
+{
+}
+
+DnsPendingTableTestCase::~DnsPendingTableTestCase ()
 {
-  // A wide variety of test macros are available in src/core/test.h
-  NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
-  // Use this one for floating point comparisons
-  NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
+}
+
+void
+DnsPendingTableTestCase::DoRun (void)
+{
+  PendingQueryTable table;
+  table.SetCapacity (4);
+  Ipv4Address upstream ("10.1.1.3");
+
+  // One entry stays in flight while many others come and go
+  uint32_t live = table.Allocate ("live.example.jp", RR_TYPE_A, RR_CLASS_IN);
+  table.Get (live).id = 1;
+  table.AddUpstream (live, upstream);
+
+  for (uint32_t n = 0; n < 1000; n++)
+  {
+    std::ostringstream name;
+    name << "host" << n << ".example.jp";
+    uint32_t handle = table.Allocate (name.str (), RR_TYPE_A, RR_CLASS_IN);
+    NS_TEST_ASSERT_MSG_NE (handle, PendingQueryTable::INVALID_HANDLE, "No free entry in round " << n);
+    table.Get (handle).id = 2 + n;
+    table.AddUpstream (handle, upstream);
+    NS_TEST_ASSERT_MSG_EQ (table.Find (2 + n, name.str (), upstream), handle, "Reply not matched in round " << n);
+    NS_TEST_ASSERT_MSG_EQ (table.FindQuestion (name.str (), RR_TYPE_A, RR_CLASS_IN), handle, "Question not found");
+    table.Release (handle);
+    NS_TEST_ASSERT_MSG_EQ (table.Find (2 + n, name.str (), upstream),
+                           PendingQueryTable::INVALID_HANDLE,
+                           "Released entry still matched");
+  }
+
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 1, "Wrong number of entries in use");
+  NS_TEST_ASSERT_MSG_EQ (table.Find (1, "live.example.jp", upstream), live, "Live entry lost by a rebuild");
+  NS_TEST_ASSERT_MSG_EQ (table.FindQuestion ("live.example.jp", RR_TYPE_A, RR_CLASS_IN), live, "Live question lost");
+
+  // A full table refuses new entries instead of growing
+  for (uint32_t n = 1; n < 4; n++)
+  {
+    table.Allocate ("full.example.jp", RR_TYPE_A, RR_CLASS_IN);
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.Allocate ("more.example.jp", RR_TYPE_A, RR_CLASS_IN),
+                         PendingQueryTable::INVALID_HANDLE,
+                         "A full table accepted an entry");
+  table.Clear ();
+}
+
+// A role serving zone data answers names it holds, refers names below
+// its zone cuts and denies the rest
+class DnsZoneRoleTestCase : public TestCase
+{
+public:
+  DnsZoneRoleTestCase (BindServer::ServerType type, const std::string& role);
+  virtual ~DnsZoneRoleTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  BindServer::ServerType m_type;
+};
+
+DnsZoneRoleTestCase::DnsZoneRoleTestCase (BindServer::ServerType type, const std::string& role)
+  : TestCase (role + " server answers, refers and denies from its zone data"),
+    m_type (type)
+{
+}
+
+DnsZoneRoleTestCase::~DnsZoneRoleTestCase ()
+{
+}
+
+void
+DnsZoneRoleTestCase::DoRun (void)
+{
+  DnsTestNetwork network (2);
+
+  BindServerHelper bindServer (m_type);
+  bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (network.GetAddress (1)));
+  ApplicationContainer apps = bindServer.Install (network.GetNode (1));
+  bindServer.AddNSRecord (apps.Get (0), "www.test.jp", 3600, RR_CLASS_IN, RR_TYPE_A, "192.0.2.7");
+  bindServer.AddNSRecord (apps.Get (0), ".example.jp", 86400, RR_CLASS_IN, RR_TYPE_A, "10.1.1.100");
+
+  DnsTestProbe probe (network.GetNode (0));
+  probe.Ask (Seconds (1), network.GetAddress (1), 1, "www.test.jp", RR_TYPE_A);
+  probe.Ask (Seconds (2), network.GetAddress (1), 2, "www.example.jp", RR_TYPE_A);
+  probe.Ask (Seconds (3), network.GetAddress (1), 3, "www.missing.org", RR_TYPE_A);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  DNSHeader reply;
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (1, reply), true, "No reply to a name of the zone");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetQRbit (), false, "The reply is marked as a query");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetAAbit (), true, "The answer is not authoritative");
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (reply.GetRcode ()), 0, "Wrong RCODE of the answer");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetAnCount (), 1, "Wrong answer count");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetAnswerList ().front ().GetRData<RR_TYPE_A> (),
+                         Ipv4Address ("192.0.2.7"),
+                         "Wrong answer");
+
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (2, reply), true, "No reply to a name below a zone cut");
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (reply.GetRcode ()), 0, "Wrong RCODE of the referral");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetAnCount (), 0, "The referral has answers");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetNsCount (), 1, "Wrong NS record count of the referral");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetArCount (), 1, "Wrong glue count of the referral");
+  const ResourceRecordHeader& nsRecord = reply.GetNsRecordList ().front ();
+  const ResourceRecordHeader& glue = reply.GetArList ().front ();
+  NS_TEST_ASSERT_MSG_EQ (nsRecord.GetName (), ".example.jp", "Referral to the wrong zone");
+  NS_TEST_ASSERT_MSG_EQ (glue.GetName (), nsRecord.GetRData<RR_TYPE_NS> (), "The glue is not for the name server");
+  NS_TEST_ASSERT_MSG_EQ (glue.GetRData<RR_TYPE_A> (), Ipv4Address ("10.1.1.100"), "Wrong glue address");
+
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (3, reply), true, "No reply to a missing name");
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (reply.GetRcode ()), 3, "A missing name is not NXDOMAIN");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetAnCount (), 0, "NXDOMAIN with answers");
+
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (apps.Get (0), "Queries"), 3, "Wrong query count");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (apps.Get (0), "Replies"), 3, "Wrong reply count");
+
+  Simulator::Destroy ();
+}
+
+// An Authoritative server answers a repeated question from its packet
+// cache, although it rotates its records after every answer
+class DnsPacketCacheTestCase : public TestCase
+{
+public:
+  DnsPacketCacheTestCase ();
+  virtual ~DnsPacketCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DnsPacketCacheTestCase::DnsPacketCacheTestCase ()
+  : TestCase ("Authoritative server answers repeated questions from the packet cache, rotated")
+{
+}
+
+DnsPacketCacheTestCase::~DnsPacketCacheTestCase ()
+{
+}
+
+void
+DnsPacketCacheTestCase::DoRun (void)
+{
+  DnsTestNetwork network (2);
+
+  BindServerHelper bindServer (BindServer::AUTH_SERVER);
+  bindServer.SetAttribute ("SetServerAddress", Ipv4AddressValue (network.GetAddress (1)));
+  ApplicationContainer apps = bindServer.Install (network.GetNode (1));
+  bindServer.AddNSRecord (apps.Get (0), "www.test.jp", 3600, RR_CLASS_IN, RR_TYPE_A, "192.0.2.1");
+  bindServer.AddNSRecord (apps.Get (0), "www.test.jp", 3600, RR_CLASS_IN, RR_TYPE_A, "192.0.2.2");
+  bindServer.AddNSRecord (apps.Get (0), "mail.test.jp", 3600, RR_CLASS_IN, RR_TYPE_A, "192.0.2.3");
+
+  DnsTestProbe probe (network.GetNode (0));
+  probe.Ask (Seconds (1), network.GetAddress (1), 1, "www.test.jp", RR_TYPE_A);
+  probe.Ask (Seconds (2), network.GetAddress (1), 2, "www.test.jp", RR_TYPE_A, true);
+  probe.Ask (Seconds (3), network.GetAddress (1), 3, "www.test.jp", RR_TYPE_A);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  DNSHeader first;
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (1, first), true, "No reply to the first query");
+  NS_TEST_ASSERT_MSG_EQ (first.GetAnCount (), 2, "Wrong answer count of the first reply");
+  NS_TEST_ASSERT_MSG_EQ (first.GetRDbit (), false, "The first reply did not echo the RD bit");
+
+  DNSHeader second;
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (2, second), true, "No reply to the repeated query");
+  NS_TEST_ASSERT_MSG_EQ (second.GetId (), 2, "The cached reply kept the old transaction ID");
+  NS_TEST_ASSERT_MSG_EQ (second.GetRDbit (), true, "The cached reply kept the old RD bit");
+  NS_TEST_ASSERT_MSG_EQ (second.GetAnCount (), 2, "Wrong answer count of the cached reply");
+  NS_TEST_ASSERT_MSG_NE (second.GetAnswerList ().front ().GetRData (),
+                         first.GetAnswerList ().front ().GetRData (),
+                         "The cached reply was not rotated");
+
+  // Two records come back to the first order on the next hit
+  DNSHeader third;
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (3, third), true, "No reply to the third query");
+  NS_TEST_ASSERT_MSG_EQ (third.GetRDbit (), false, "The cached reply kept the old RD bit");
+  NS_TEST_ASSERT_MSG_EQ (third.GetAnswerList ().front ().GetRData (),
+                         first.GetAnswerList ().front ().GetRData (),
+                         "The cached reply was not rotated back");
+
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (apps.Get (0), "CacheMisses"), 1, "The first query did not build a response");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (apps.Get (0), "CacheHits"), 2, "The repeated queries missed the packet cache");
+
+  Simulator::Destroy ();
+}
+
+// The Local server resolves through the hierarchy and caches the answers
+// and the zone cuts on the way
+class DnsLocalServerTestCase : public TestCase
+{
+public:
+  DnsLocalServerTestCase ();
+  virtual ~DnsLocalServerTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DnsLocalServerTestCase::DnsLocalServerTestCase ()
+  : TestCase ("Local server resolves iteratively and caches answers and zone cuts")
+{
+}
+
+DnsLocalServerTestCase::~DnsLocalServerTestCase ()
+{
+}
+
+void
+DnsLocalServerTestCase::DoRun (void)
+{
+  DnsTestHierarchy hierarchy (0);
+  Ptr<BindServer> local = hierarchy.GetLocal ();
+  hierarchy.Ask (Seconds (1), "www.example.jp");
+  hierarchy.Ask (Seconds (3), "www.example.jp");
+  hierarchy.Ask (Seconds (5), "mail.example.jp");
+  hierarchy.Ask (Seconds (7), "www.missing.jp");
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (hierarchy.GetOutcomes ().size (), 1, "The first query was not answered");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (local, "UpstreamQueries"), 3, "Not resolved through Root, TLD and Auth");
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (hierarchy.GetOutcomes ().size (), 2, "The repeated query was not answered");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (local, "UpstreamQueries"), 3, "The repeated query went upstream");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (local, "CacheHits"), 1, "The repeated query missed the cache");
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (hierarchy.GetOutcomes ().size (), 3, "The query in the same zone was not answered");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (local, "UpstreamQueries"), 4, "The cached zone cut was not used");
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  const std::vector<DnsQueryOutcome>& outcomes = hierarchy.GetOutcomes ();
+  NS_TEST_ASSERT_MSG_EQ (outcomes.size (), 4, "The query for a missing name was not answered");
+  for (uint32_t n = 0; n < 3; n++)
+  {
+    NS_TEST_ASSERT_MSG_EQ (outcomes[n].answered, true, "Query " << n << " timed out");
+    NS_TEST_ASSERT_MSG_EQ (uint32_t (outcomes[n].rcode), 0, "Query " << n << " failed");
+  }
+  NS_TEST_ASSERT_MSG_EQ (outcomes[3].qName, "www.missing.jp", "Outcomes out of order");
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (outcomes[3].rcode), 3, "A missing name is not NXDOMAIN");
+
+  Simulator::Destroy ();
+}
+
+// A truncated upstream reply makes the Local server repeat the query once
+// over TCP, and the full answer reaches the client
+class DnsTruncatedReplyTestCase : public TestCase
+{
+public:
+  DnsTruncatedReplyTestCase ();
+  virtual ~DnsTruncatedReplyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DnsTruncatedReplyTestCase::DnsTruncatedReplyTestCase ()
+  : TestCase ("Local server retries a truncated upstream reply over TCP")
+{
+}
+
+DnsTruncatedReplyTestCase::~DnsTruncatedReplyTestCase ()
+{
+}
+
+void
+DnsTruncatedReplyTestCase::DoRun (void)
+{
+  enum
+  {
+    PROBE = 0,
+    LOCAL,
+    AUTH,
+    NODES
+  };
+  DnsTestNetwork network (NODES);
+
+  // The Local server starts its resolutions at the Authoritative server
+  BindServerHelper localHelper (BindServer::LOCAL_SERVER);
+  localHelper.SetAttribute ("SetRecursiveSupport", EnumValue (BindServer::RA_AVAILABLE));
+  localHelper.SetAttribute ("SetServerAddress", Ipv4AddressValue (network.GetAddress (LOCAL)));
+  localHelper.SetAttribute ("RootServerAddress", Ipv4AddressValue (network.GetAddress (AUTH)));
+  Ptr<Application> local = localHelper.Install (network.GetNode (LOCAL)).Get (0);
+
+  // Eight addresses of a name do not fit in 100 bytes
+  BindServerHelper authHelper (BindServer::AUTH_SERVER);
+  authHelper.SetAttribute ("SetServerAddress", Ipv4AddressValue (network.GetAddress (AUTH)));
+  authHelper.SetAttribute ("MaxUdpPayloadSize", UintegerValue (100));
+  Ptr<Application> auth = authHelper.Install (network.GetNode (AUTH)).Get (0);
+  for (uint32_t n = 1; n <= 8; n++)
+  {
+    std::ostringstream address;
+    address << "192.0.2." << n;
+    authHelper.AddNSRecord (auth, "big.test.jp", 3600, RR_CLASS_IN, RR_TYPE_A, address.str ());
+  }
+
+  DnsTestProbe probe (network.GetNode (PROBE));
+  probe.Ask (Seconds (1), network.GetAddress (LOCAL), 1, "big.test.jp", RR_TYPE_A);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  DNSHeader reply;
+  NS_TEST_ASSERT_MSG_EQ (probe.GetReply (1, reply), true, "No reply to the client");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetTCbit (), false, "The client got a truncated reply");
+  NS_TEST_ASSERT_MSG_EQ (uint32_t (reply.GetRcode ()), 0, "Wrong RCODE");
+  NS_TEST_ASSERT_MSG_EQ (reply.GetAnCount (), 1, "Wrong answer count");
+
+  // One query over UDP and one retry over TCP, and nothing retransmitted
+  // over UDP while the retry was under way
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (local, "UpstreamQueries"), 2, "Not one UDP query and one TCP retry");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (auth, "Replies"), 2, "The Authoritative server did not reply twice");
+  NS_TEST_ASSERT_MSG_EQ (GetCounter (local, "UnmatchedResponses"), 0, "The TCP reply matched no resolution");
+
+  Simulator::Destroy ();
+}
+
+// Performance budget: scheduler events spent on the expiry of cached records
+class DnsCacheEventBudgetTestCase : public TestCase
+{
+public:
+  DnsCacheEventBudgetTestCase ();
+  virtual ~DnsCacheEventBudgetTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DnsCacheEventBudgetTestCase::DnsCacheEventBudgetTestCase ()
+  : TestCase ("Budget: scheduler events per cached record")
+{
+}
+
+DnsCacheEventBudgetTestCase::~DnsCacheEventBudgetTestCase ()
+{
+}
+
+void
+DnsCacheEventBudgetTestCase::DoRun (void)
+{
+  const uint32_t records = 10000;
+
+  SRVTable table;
+  for (uint32_t n = 0; n < records; n++)
+  {
+    std::ostringstream name;
+    name << "host" << n << ".example.jp";
+    table.AddRecord (name.str (), RR_CLASS_IN, RR_TYPE_A, 1 + n % 60, "192.0.2.1");
+  }
+
+  uint64_t events = Simulator::GetEventCount ();
+  Simulator::Run ();
+  events = Simulator::GetEventCount () - events;
+
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 0, "Records left after every TTL passed");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (double (events) / records,
+                               MAX_EVENTS_PER_CACHED_RECORD,
+                               "Cache expiry exceeds its event budget: " << events << " events for " << records
+                                                                         << " records");
+
+  table.DoDispose ();
+  Simulator::Destroy ();
+}
+
+// Performance budget: work of the Local server per answered query, both
+// for misses below a cached zone cut and for cache hits
+class DnsQueryBudgetTestCase : public TestCase
+{
+public:
+  DnsQueryBudgetTestCase ();
+  virtual ~DnsQueryBudgetTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Work done while a batch of queries was answered
+  struct Cost
+  {
+    uint32_t answered;
+    double upstream;
+    double events;
+    double packets;
+  };
+
+  Cost Measure (DnsTestHierarchy& hierarchy, Time duration) const;
+};
+
+DnsQueryBudgetTestCase::DnsQueryBudgetTestCase ()
+  : TestCase ("Budget: upstream queries, scheduler events and packets per answered query")
+{
+}
+
+DnsQueryBudgetTestCase::~DnsQueryBudgetTestCase ()
+{
+}
+
+DnsQueryBudgetTestCase::Cost
+DnsQueryBudgetTestCase::Measure (DnsTestHierarchy& hierarchy, Time duration) const
+{
+  uint64_t answered = hierarchy.GetOutcomes ().size ();
+  uint64_t upstream = GetCounter (hierarchy.GetLocal (), "UpstreamQueries");
+  uint64_t events = Simulator::GetEventCount ();
+  uint64_t packets = GetPacketCount ();
+
+  Simulator::Stop (duration);
+  Simulator::Run ();
+
+  Cost cost;
+  cost.answered = hierarchy.GetOutcomes ().size () - answered;
+  double count = cost.answered == 0 ? 1 : cost.answered;
+  cost.upstream = (GetCounter (hierarchy.GetLocal (), "UpstreamQueries") - upstream) / count;
+  cost.events = (Simulator::GetEventCount () - events) / count;
+  // Less the packet created to read the count
+  cost.packets = (GetPacketCount () - packets - 1) / count;
+  return cost;
+}
+
+void
+DnsQueryBudgetTestCase::DoRun (void)
+{
+  const uint32_t hosts = 200;
+  DnsTestHierarchy hierarchy (hosts);
+
+  // The first query fills the delegation cache and the ARP caches. The
+  // measured windows outlast the timeouts scheduled for their queries.
+  hierarchy.Ask (Seconds (1), "host0.example.jp");
+  for (uint32_t n = 1; n < hosts; n++)
+  {
+    std::ostringstream name;
+    name << "host" << n << ".example.jp";
+    hierarchy.Ask (Seconds (5) + MilliSeconds (10 * n), name.str ());
+    hierarchy.Ask (Seconds (15) + MilliSeconds (10 * n), name.str ());
+  }
+  Simulator::Stop (Seconds (5));
+  Simulator::Run ();
+
+  Cost miss = Measure (hierarchy, Seconds (10));
+  NS_TEST_ASSERT_MSG_EQ (miss.answered, hosts - 1, "Not every miss was answered");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (miss.upstream, MAX_UPSTREAM_PER_MISS, "Upstream queries per miss over budget");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (miss.events, MAX_EVENTS_PER_MISS, "Scheduler events per miss over budget");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (miss.packets, MAX_PACKETS_PER_MISS, "Packets per miss over budget");
+
+  Cost hit = Measure (hierarchy, Seconds (10));
+  NS_TEST_ASSERT_MSG_EQ (hit.answered, hosts - 1, "Not every hit was answered");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (hit.upstream, MAX_UPSTREAM_PER_HIT, "Upstream queries per hit over budget");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (hit.events, MAX_EVENTS_PER_HIT, "Scheduler events per hit over budget");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (hit.packets, MAX_PACKETS_PER_HIT, "Packets per hit over budget");
+
+  Simulator::Destroy ();
 }
 
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
@@ -59,8 +1044,21 @@ public:
 DnsTestSuite::DnsTestSuite ()
   : TestSuite ("dns", UNIT)
 {
-  // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
-  AddTestCase (new DnsTestCase1, TestCase::QUICK);
+  AddTestCase (new DnsHeaderRoundTripTestCase, TestCase::QUICK);
+  AddTestCase (new DnsSrvTableLookupTestCase, TestCase::QUICK);
+  AddTestCase (new DnsSrvTableExpiryTestCase, TestCase::QUICK);
+  AddTestCase (new DnsPendingTableTestCase, TestCase::QUICK);
+  AddTestCase (new DnsZoneRoleTestCase (BindServer::ROOT_SERVER, "Root"), TestCase::QUICK);
+  AddTestCase (new DnsZoneRoleTestCase (BindServer::TLD_SERVER, "TLD"), TestCase::QUICK);
+  AddTestCase (new DnsZoneRoleTestCase (BindServer::ISP_SERVER, "ISP"), TestCase::QUICK);
+  AddTestCase (new DnsZoneRoleTestCase (BindServer::AUTH_SERVER, "Authoritative"), TestCase::QUICK);
+  AddTestCase (new DnsPacketCacheTestCase, TestCase::QUICK);
+  AddTestCase (new DnsLocalServerTestCase, TestCase::QUICK);
+  AddTestCase (new DnsTruncatedReplyTestCase, TestCase::QUICK);
+
+  // Performance budgets; run with --fullness=EXTENSIVE
+  AddTestCase (new DnsCacheEventBudgetTestCase, TestCase::EXTENSIVE);
+  AddTestCase (new DnsQueryBudgetTestCase, TestCase::EXTENSIVE);
 }
 
 // Do not forget to allocate an instance of this TestSuite